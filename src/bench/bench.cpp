@@ -0,0 +1,158 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "commons/json/json_spirit_value.h"
+#include "commons/json/json_spirit_writer_template.h"
+#include "commons/util/util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <regex>
+
+using namespace json_spirit;
+
+static std::atomic<uint64_t> nAllocations(0);
+static std::atomic<uint64_t> nAllocatedBytes(0);
+static std::atomic<uint64_t> nLiveBytes(0);
+
+// The size of an allocation is kept in front of it for operator delete to count it out, over a
+// prefix that keeps the alignment of malloc()
+static const size_t ALLOC_PREFIX = 16;
+
+void *operator new(size_t size) {
+    nAllocations.fetch_add(1, std::memory_order_relaxed);
+    nAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (char *p = (char *)malloc(size + ALLOC_PREFIX)) {
+        *(size_t *)p = size;
+        nLiveBytes.fetch_add(size, std::memory_order_relaxed);
+        return p + ALLOC_PREFIX;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    if (p == nullptr)
+        return;
+    char *pAlloc = (char *)p - ALLOC_PREFIX;
+    nLiveBytes.fetch_sub(*(size_t *)pAlloc, std::memory_order_relaxed);
+    free(pAlloc);
+}
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+namespace benchmark {
+
+uint64_t GetAllocations() { return nAllocations.load(std::memory_order_relaxed); }
+
+uint64_t GetAllocatedBytes() { return nAllocatedBytes.load(std::memory_order_relaxed); }
+
+uint64_t GetLiveBytes() { return nLiveBytes.load(std::memory_order_relaxed); }
+
+bool State::UpdateTimer() {
+    Clock::time_point now = Clock::now();
+    if (count == 0) {
+        beginTime = lastTime = now;
+    } else {
+        if (now - beginTime >= minTime) {
+            lastTime = now;
+            return false;
+        }
+
+        // read the clock less often while a batch takes less than 1/16 of the run
+        if ((now - lastTime) * 16 < minTime)
+            countMask = countMask * 2 + 1;
+        lastTime = now;
+    }
+
+    ++count;
+    return true;
+}
+
+void CheckFailed(const char *pszCond, const char *pszFile, int32_t nLine) {
+    fprintf(stderr, "%s:%d: bench check failed: %s\n", pszFile, nLine, pszCond);
+    abort();
+}
+
+double State::GetNanosPerOp() const {
+    if (count == 0)
+        return 0;
+    return std::chrono::duration<double, std::nano>(lastTime - beginTime).count() / count;
+}
+
+double BenchResult::Median() const {
+    size_t size = nanosPerOp.size();
+    if (size % 2 == 1)
+        return nanosPerOp[size / 2];
+    return (nanosPerOp[size / 2 - 1] + nanosPerOp[size / 2]) / 2;
+}
+
+std::map<std::string, BenchFunction> &BenchRunner::Benchmarks() {
+    static std::map<std::string, BenchFunction> benchmarks;
+    return benchmarks;
+}
+
+BenchRunner::BenchRunner(const std::string &name, BenchFunction func) { Benchmarks().emplace(name, func); }
+
+std::vector<BenchResult> BenchRunner::RunAll(const std::string &filter, int64_t minTimeMs, int32_t repeat) {
+    std::regex reFilter(filter);
+    std::vector<BenchResult> results;
+    for (const auto &item : Benchmarks()) {
+        if (!std::regex_match(item.first, reFilter))
+            continue;
+
+        BenchResult result;
+        result.name = item.first;
+        for (int32_t i = 0; i < repeat; i++) {
+            State state{std::chrono::milliseconds(minTimeMs)};
+            item.second(state);
+            result.iterations += state.GetIterations();
+            result.nanosPerOp.push_back(state.GetNanosPerOp());
+        }
+        std::sort(result.nanosPerOp.begin(), result.nanosPerOp.end());
+        results.push_back(result);
+    }
+    return results;
+}
+
+std::string FormatCsv(const std::vector<BenchResult> &results) {
+    std::string csv = "name,runs,iterations,min_ns,median_ns,max_ns,ops_per_sec\n";
+    for (const auto &result : results) {
+        double median = result.Median();
+        csv += strprintf("%s,%u,%u,%.1f,%.1f,%.1f,%.0f\n", result.name, result.nanosPerOp.size(), result.iterations,
+                         result.Min(), median, result.Max(), median > 0 ? 1e9 / median : 0);
+    }
+    return csv;
+}
+
+std::string FormatJson(const std::vector<BenchResult> &results, const std::map<std::string, std::string> &context) {
+    Object contextObj;
+    for (const auto &item : context)
+        contextObj.push_back(Pair(item.first, item.second));
+
+    Array benchmarks;
+    for (const auto &result : results) {
+        double median = result.Median();
+        Object obj;
+        obj.push_back(Pair("name",        result.name));
+        obj.push_back(Pair("runs",        (int64_t)result.nanosPerOp.size()));
+        obj.push_back(Pair("iterations",  (int64_t)result.iterations));
+        obj.push_back(Pair("min_ns",      result.Min()));
+        obj.push_back(Pair("median_ns",   median));
+        obj.push_back(Pair("max_ns",      result.Max()));
+        obj.push_back(Pair("ops_per_sec", median > 0 ? 1e9 / median : 0.0));
+        benchmarks.push_back(obj);
+    }
+
+    Object root;
+    root.push_back(Pair("context",    contextObj));
+    root.push_back(Pair("benchmarks", benchmarks));
+    return write_string(Value(root), true) + "\n";
+}
+
+}  // namespace benchmark
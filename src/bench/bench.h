@@ -0,0 +1,112 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Microbenchmarks of bench_coin.
+ *
+ * A benchmark is a function registered with BENCHMARK(name), which loops on
+ * State::KeepRunning() around the code it measures:
+ *
+ *     static void Hash160_33b(benchmark::State &state) {
+ *         while (state.KeepRunning())
+ *             Hash160(data);
+ *     }
+ *     BENCHMARK(Hash160_33b);
+ *
+ * Every benchmark is run several times, each run loops for at least the minimum
+ * time; the clock is read every 2^n iterations only, n growing while a batch is
+ * much shorter than the run.
+ */
+namespace benchmark {
+
+typedef std::chrono::steady_clock Clock;
+
+class State {
+public:
+    explicit State(Clock::duration minTimeIn) : minTime(minTimeIn) {}
+
+    bool KeepRunning() {
+        if ((count & countMask) != 0) {
+            ++count;
+            return true;
+        }
+        return UpdateTimer();
+    }
+
+    uint64_t GetIterations() const { return count; }
+    double GetNanosPerOp() const;
+
+private:
+    bool UpdateTimer();
+
+private:
+    Clock::duration minTime;
+    Clock::time_point beginTime;
+    Clock::time_point lastTime;
+    uint64_t count     = 0;
+    uint64_t countMask = 0;
+};
+
+typedef std::function<void(State &)> BenchFunction;
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations = 0;  // of all the runs
+    std::vector<double> nanosPerOp;  // one per run, sorted
+
+    double Min() const { return nanosPerOp.front(); }
+    double Max() const { return nanosPerOp.back(); }
+    double Median() const;
+};
+
+class BenchRunner {
+public:
+    BenchRunner(const std::string &name, BenchFunction func);
+
+    // Run the benchmarks whose name matches filter (a regex), each one repeat times
+    static std::vector<BenchResult> RunAll(const std::string &filter, int64_t minTimeMs, int32_t repeat);
+
+    static const std::map<std::string, BenchFunction> &GetBenchmarks() { return Benchmarks(); }
+
+private:
+    static std::map<std::string, BenchFunction> &Benchmarks();
+};
+
+// Allocations made through operator new by bench_coin since it started, and their bytes. The
+// counters are global, a benchmark reads their difference over the code it measures.
+uint64_t GetAllocations();
+uint64_t GetAllocatedBytes();
+// Bytes allocated through operator new and not deleted yet
+uint64_t GetLiveBytes();
+
+// Report a failed BENCH_CHECK() and abort
+[[noreturn]] void CheckFailed(const char *pszCond, const char *pszFile, int32_t nLine);
+
+// Write the results as CSV, one line per benchmark after the header
+std::string FormatCsv(const std::vector<BenchResult> &results);
+// Write the results as a JSON document, with the context of the run
+std::string FormatJson(const std::vector<BenchResult> &results, const std::map<std::string, std::string> &context);
+
+}  // namespace benchmark
+
+#define BENCHMARK(n) static benchmark::BenchRunner bench_runner_##n(#n, n);
+
+/** Check the result of the measured code, unlike assert() it is not compiled out by NDEBUG */
+#define BENCH_CHECK(cond)                                              \
+    do {                                                               \
+        if (!(cond))                                                   \
+            benchmark::CheckFailed(#cond, __FILE__, __LINE__);         \
+    } while (0)
+
+#endif  // BENCH_BENCH_H
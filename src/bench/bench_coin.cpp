@@ -0,0 +1,83 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "config/chainparams.h"
+#include "crypto/sha256.h"
+#include "entities/key.h"
+#include "commons/util/util.h"
+
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <thread>
+
+static const char *DEFAULT_BENCH_FILTER = ".*";
+static const int64_t DEFAULT_BENCH_MIN_TIME_MS = 100;
+static const int32_t DEFAULT_BENCH_REPEAT = 5;
+
+static std::string HelpMessage() {
+    std::string strUsage = "Usage: bench_coin [options]\n\nOptions:\n";
+    strUsage += "  -?                    " + _("This help message") + "\n";
+    strUsage += "  -list                 " + _("List the benchmarks and exit") + "\n";
+    strUsage += "  -filter=<regex>       " + strprintf(_("Run the benchmarks whose name matches the regex (default: %s)"), DEFAULT_BENCH_FILTER) + "\n";
+    strUsage += "  -format=<fmt>         " + _("Output format, csv or json (default: csv)") + "\n";
+    strUsage += "  -mintime=<n>          " + strprintf(_("Minimum time of a run of a benchmark, in milliseconds (default: %d)"), DEFAULT_BENCH_MIN_TIME_MS) + "\n";
+    strUsage += "  -repeat=<n>           " + strprintf(_("Number of runs of every benchmark (default: %d)"), DEFAULT_BENCH_REPEAT) + "\n";
+    return strUsage;
+}
+
+int main(int argc, char *argv[]) {
+    CBaseParams::ParseParameters(argc, argv);
+    if (CBaseParams::IsArgCount("-?") || CBaseParams::IsArgCount("-help")) {
+        std::cout << HelpMessage();
+        return 0;
+    }
+
+    if (CBaseParams::IsArgCount("-list")) {
+        for (const auto &item : benchmark::BenchRunner::GetBenchmarks())
+            std::cout << item.first << "\n";
+        return 0;
+    }
+
+    std::string format = CBaseParams::GetArg("-format", "csv");
+    if (format != "csv" && format != "json") {
+        std::cerr << "Error: unknown format " << format << "\n";
+        return 1;
+    }
+
+    std::string filter = CBaseParams::GetArg("-filter", DEFAULT_BENCH_FILTER);
+    int64_t minTimeMs  = std::max<int64_t>(CBaseParams::GetArg("-mintime", DEFAULT_BENCH_MIN_TIME_MS), 1);
+    int32_t repeat     = std::max<int64_t>(CBaseParams::GetArg("-repeat", DEFAULT_BENCH_REPEAT), 1);
+
+    std::string sha256Impl = SHA256AutoDetect();
+    ECC_Start();
+    std::unique_ptr<ECCVerifyHandle> handle = std::make_unique<ECCVerifyHandle>();
+
+    std::vector<benchmark::BenchResult> results;
+    try {
+        results = benchmark::BenchRunner::RunAll(filter, minTimeMs, repeat);
+    } catch (const std::regex_error &e) {
+        std::cerr << "Error: invalid filter " << filter << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    if (format == "json") {
+        std::map<std::string, std::string> context = {
+            {"version", FormatFullVersion()},
+            {"sha256", sha256Impl},
+            {"cores", std::to_string(std::thread::hardware_concurrency())},
+            {"min_time_ms", std::to_string(minTimeMs)},
+            {"repeat", std::to_string(repeat)},
+        };
+        std::cout << benchmark::FormatJson(results, context);
+    } else {
+        std::cout << benchmark::FormatCsv(results);
+    }
+
+    handle.reset();
+    ECC_Stop();
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "commons/random.h"
+#include "p2p/compactblock.h"
+#include "tx/blockrewardtx.h"
+#include "tx/cointransfertx.h"
+#include "tx/txserializer.h"
+
+#include <cstdio>
+
+using namespace std;
+
+// A block of BLOCK_TXS transfers, the mempool of the receiver has a share of them and
+// MEMPOOL_OTHER_TXS txs which did not make it into the block
+static const uint32_t BLOCK_TXS         = 2000;
+static const uint32_t MEMPOOL_OTHER_TXS = 1000;
+
+static std::shared_ptr<CBaseTx> MakeTransferTx(uint32_t n) {
+    return std::make_shared<CBaseCoinTransferTx>(CRegID(1000000 + n / 8, n % 8), CRegID(100, 1), 1000 + n % 100,
+                                                  GetRand(1000000) + 1, 10000, "");
+}
+
+static vector<std::shared_ptr<CBaseTx>> GetTxs(const CBlock &block, const vector<uint32_t> &indexes) {
+    vector<std::shared_ptr<CBaseTx>> txs;
+    for (auto index : indexes)
+        txs.push_back(block.vptx[index]);
+    return txs;
+}
+
+// Rebuild the block from a compact block as the receiver does, with percent of its txs
+// in the mempool and the others from a getblocktxn. The bytes the compact block and the
+// round trip take, against those of the full block, are written to stderr once per run.
+static void CompactBlockRebuild(benchmark::State &state, uint32_t percent) {
+    vector<std::shared_ptr<CBaseTx>> txs, others;
+    for (uint32_t i = 0; i < BLOCK_TXS; i++)
+        txs.push_back(MakeTransferTx(i));
+    for (uint32_t i = 0; i < MEMPOOL_OTHER_TXS; i++)
+        others.push_back(MakeTransferTx(BLOCK_TXS + i));
+
+    CBlock block;
+    block.SetHeight(1000);
+    block.SetTime(GetTime());
+    block.SetPrevBlockHash(GetRandHash());
+    block.vptx.push_back(std::make_shared<CBlockRewardTx>(CRegID(100, 1).GetRegIdRaw(), 0, 1000));
+    block.vptx.insert(block.vptx.end(), txs.begin(), txs.end());
+    block.SetMerkleRootHash(block.BuildMerkleTree());
+
+    // as the receiver gets it
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CCompactBlock(block, GetRand(std::numeric_limits<uint64_t>::max()));
+    CCompactBlock cmpctblock;
+    ss >> cmpctblock;
+
+    uint32_t known = BLOCK_TXS * percent / 100;
+    bool fReported = false;
+    while (state.KeepRunning()) {
+        CPartialBlock partialBlock;
+        BENCH_CHECK(partialBlock.InitData(cmpctblock) == CPartialBlock::READ_OK);
+        for (uint32_t i = 0; i < known; i++)
+            partialBlock.AddAvailableTx(txs[i]->GetHash(), txs[i]);
+        for (const auto &pBaseTx : others)
+            partialBlock.AddAvailableTx(pBaseTx->GetHash(), pBaseTx);
+
+        vector<uint32_t> missing;
+        partialBlock.GetMissingIndexes(missing);
+        BENCH_CHECK(missing.size() == BLOCK_TXS - known);
+
+        CBlock rebuilt;
+        BENCH_CHECK(partialBlock.FillBlock(rebuilt, GetTxs(block, missing)) == CPartialBlock::READ_OK);
+        BENCH_CHECK(rebuilt.GetHash() == block.GetHash());
+
+        if (!fReported) {
+            CBlockTxnRequest request;
+            request.indexes = missing;
+            CBlockTxn response;
+            response.txs        = GetTxs(block, missing);
+            size_t compactBytes = ::GetSerializeSize(cmpctblock, SER_NETWORK, PROTOCOL_VERSION);
+            if (!missing.empty())
+                compactBytes += ::GetSerializeSize(request, SER_NETWORK, PROTOCOL_VERSION) +
+                                ::GetSerializeSize(response, SER_NETWORK, PROTOCOL_VERSION);
+
+            fprintf(stderr, "block of %u txs, %u%% in mempool: %u prefilled, %u from mempool, %u requested, "
+                            "%u bytes compact vs %u full\n", BLOCK_TXS + 1, percent,
+                    partialBlock.nPrefilledTxs, partialBlock.nAvailableTxs,
+                    (uint32_t)missing.size(), (uint32_t)compactBytes,
+                    (uint32_t)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+            fReported = true;
+        }
+    }
+}
+
+static void CompactBlockRebuild_100(benchmark::State &state) { CompactBlockRebuild(state, 100); }
+static void CompactBlockRebuild_99(benchmark::State &state) { CompactBlockRebuild(state, 99); }
+static void CompactBlockRebuild_90(benchmark::State &state) { CompactBlockRebuild(state, 90); }
+static void CompactBlockRebuild_50(benchmark::State &state) { CompactBlockRebuild(state, 50); }
+static void CompactBlockRebuild_0(benchmark::State &state) { CompactBlockRebuild(state, 0); }
+
+BENCHMARK(CompactBlockRebuild_100);
+BENCHMARK(CompactBlockRebuild_99);
+BENCHMARK(CompactBlockRebuild_90);
+BENCHMARK(CompactBlockRebuild_50);
+BENCHMARK(CompactBlockRebuild_0);
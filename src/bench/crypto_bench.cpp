@@ -0,0 +1,262 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "commons/random.h"
+#include "crypto/hash.h"
+#include "crypto/siphash.h"
+#include "entities/key.h"
+#include "persistence/block.h"
+#include "sigcache.h"
+#include "wallet/crypter.h"
+
+#include <functional>
+#include <random>
+
+using namespace std;
+
+static void HashWriter_32b(benchmark::State &state) {
+    uint256 data = GetRandHash();
+    while (state.KeepRunning()) {
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << data;
+        data = ss.GetHash();
+    }
+}
+
+static void HashWriter_1MB(benchmark::State &state) {
+    vector<uint8_t> data(1 << 20, 0x5a);
+    while (state.KeepRunning()) {
+        CHashWriter ss(SER_GETHASH, 0);
+        ss.write((const char *)data.data(), data.size());
+        data[0] = ss.GetHash().begin()[0];
+    }
+}
+
+static void Hash160_33b(benchmark::State &state) {
+    vector<uint8_t> data(33, 0x02);
+    while (state.KeepRunning()) {
+        uint160 hash = Hash160(data);
+        data[1] = hash.begin()[0];
+    }
+}
+
+static void MerkleTreeBench(benchmark::State &state, size_t count,
+                            std::function<uint256(vector<uint256> &)> computeFunc) {
+    vector<uint256> leaves;
+    for (size_t i = 0; i < count; i++)
+        leaves.push_back(GetRandHash());
+
+    while (state.KeepRunning()) {
+        vector<uint256> tree = leaves;
+        computeFunc(tree);
+    }
+}
+
+static void MerkleTree_1000(benchmark::State &state) { MerkleTreeBench(state, 1000, ComputeMerkleTree); }
+static void MerkleTree_10000(benchmark::State &state) { MerkleTreeBench(state, 10000, ComputeMerkleTree); }
+static void MerkleTree_50000(benchmark::State &state) { MerkleTreeBench(state, 50000, ComputeMerkleTree); }
+static void MerkleTreePairwise_1000(benchmark::State &state) {
+    MerkleTreeBench(state, 1000, ComputeMerkleTreePairwise);
+}
+static void MerkleTreePairwise_10000(benchmark::State &state) {
+    MerkleTreeBench(state, 10000, ComputeMerkleTreePairwise);
+}
+static void MerkleTreePairwise_50000(benchmark::State &state) {
+    MerkleTreeBench(state, 50000, ComputeMerkleTreePairwise);
+}
+
+static void KeySign(benchmark::State &state) {
+    CKey key;
+    key.MakeNewKey();
+    uint256 hash = GetRandHash();
+    vector<uint8_t> signature;
+    while (state.KeepRunning()) {
+        key.Sign(hash, signature);
+        hash.begin()[0]++;
+    }
+}
+
+static void PubKeyVerify(benchmark::State &state) {
+    CKey key;
+    key.MakeNewKey();
+    CPubKey pubKey = key.GetPubKey();
+    uint256 hash   = GetRandHash();
+    vector<uint8_t> signature;
+    key.Sign(hash, signature);
+    while (state.KeepRunning()) {
+        bool valid = pubKey.Verify(hash, signature);
+        BENCH_CHECK(valid);
+    }
+}
+
+// Signers of the verified signatures: a few producers and busy accounts sign most txs, the
+// signer is drawn with a Zipf(1) distribution
+struct ZipfSignatures {
+    static const size_t KEYS = 2000;
+
+    vector<CPubKey> pubKeys;
+    vector<uint256> hashes;
+    vector<vector<uint8_t>> signatures;
+    vector<size_t> order;
+
+    ZipfSignatures() {
+        vector<double> weights;
+        for (size_t i = 0; i < KEYS; i++) {
+            CKey key;
+            key.MakeNewKey();
+            hashes.push_back(GetRandHash());
+            signatures.emplace_back();
+            key.Sign(hashes.back(), signatures.back());
+            pubKeys.push_back(key.GetPubKey());
+            weights.push_back(1.0 / (i + 1));
+        }
+
+        std::mt19937 rng(42);
+        std::discrete_distribution<size_t> signer(weights.begin(), weights.end());
+        for (size_t i = 0; i < 16 * KEYS; i++)
+            order.push_back(signer(rng));
+    }
+};
+
+static void PubKeyVerifyZipfBench(benchmark::State &state, uint32_t cacheSize) {
+    ZipfSignatures sigs;
+    ECC_SetPubKeyCacheSize(cacheSize);
+
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        size_t i   = sigs.order[n++ % sigs.order.size()];
+        bool valid = sigs.pubKeys[i].Verify(sigs.hashes[i], sigs.signatures[i]);
+        BENCH_CHECK(valid);
+    }
+
+    ECC_SetPubKeyCacheSize(DEFAULT_PUBKEY_CACHE_SIZE);
+}
+
+static void PubKeyVerifyZipf_NoCache(benchmark::State &state) { PubKeyVerifyZipfBench(state, 0); }
+static void PubKeyVerifyZipf_Cache(benchmark::State &state) {
+    PubKeyVerifyZipfBench(state, DEFAULT_PUBKEY_CACHE_SIZE);
+}
+
+static void PubKeyRecoverCompact(benchmark::State &state) {
+    CKey key;
+    key.MakeNewKey();
+    uint256 hash = GetRandHash();
+    vector<uint8_t> signature;
+    key.SignCompact(hash, signature);
+    CPubKey pubKey;
+    while (state.KeepRunning()) {
+        bool recovered = pubKey.RecoverCompact(hash, signature);
+        BENCH_CHECK(recovered);
+    }
+}
+
+// Signature cache entries, the signature bytes only need to be distinct
+struct SigCacheEntries {
+    vector<uint256> hashes;
+    vector<uint8_t> signature;
+    CPubKey pubKey;
+
+    explicit SigCacheEntries(size_t count) : signature(71, 0x30) {
+        CKey key;
+        key.MakeNewKey();
+        pubKey = key.GetPubKey();
+        for (size_t i = 0; i < count; i++)
+            hashes.push_back(GetRandHash());
+    }
+};
+
+static void SigCacheGet(benchmark::State &state) {
+    CSignatureCache cache;
+    cache.Setup(DEFAULT_MAX_SIG_CACHE_SIZE << 20);
+    SigCacheEntries entries(4096);
+    for (const auto &hash : entries.hashes)
+        cache.Set(hash, entries.signature, entries.pubKey);
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        bool hit = cache.Get(entries.hashes[i++ & 4095], entries.signature, entries.pubKey);
+        BENCH_CHECK(hit);
+    }
+}
+
+static void SigCacheSet(benchmark::State &state) {
+    CSignatureCache cache;
+    cache.Setup(DEFAULT_MAX_SIG_CACHE_SIZE << 20);
+    SigCacheEntries entries(4096);
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        // a new entry every time, evicting once the cache is full
+        uint256 &hash = entries.hashes[i++ & 4095];
+        hash.begin()[0]++;
+        cache.Set(hash, entries.signature, entries.pubKey);
+    }
+}
+
+static void WalletEncryptSecret(benchmark::State &state) {
+    CKeyingMaterial masterKey(WALLET_CRYPTO_KEY_SIZE);
+    GetRandBytes(&masterKey[0], WALLET_CRYPTO_KEY_SIZE);
+    CKeyingMaterial secret(32);
+    GetRandBytes(&secret[0], 32);
+    uint256 iv = GetRandHash();
+
+    vector<uint8_t> ciphertext;
+    while (state.KeepRunning()) {
+        bool encrypted = EncryptSecret(masterKey, secret, iv, ciphertext);
+        BENCH_CHECK(encrypted);
+    }
+}
+
+static void WalletDecryptSecret(benchmark::State &state) {
+    CKeyingMaterial masterKey(WALLET_CRYPTO_KEY_SIZE);
+    GetRandBytes(&masterKey[0], WALLET_CRYPTO_KEY_SIZE);
+    CKeyingMaterial secret(32);
+    GetRandBytes(&secret[0], 32);
+    uint256 iv = GetRandHash();
+    vector<uint8_t> ciphertext;
+    EncryptSecret(masterKey, secret, iv, ciphertext);
+
+    CKeyingMaterial plaintext;
+    while (state.KeepRunning()) {
+        bool decrypted = DecryptSecret(masterKey, ciphertext, iv, plaintext);
+        BENCH_CHECK(decrypted);
+    }
+}
+
+static void SipHash_32b(benchmark::State &state) {
+    uint256 value = GetRandHash();
+    uint64_t k0 = 0x0706050403020100ULL, k1 = 0x0F0E0D0C0B0A0908ULL;
+    while (state.KeepRunning())
+        k0 = SipHashUint256(k0, k1, value);
+}
+
+static void SipHasher_72b(benchmark::State &state) {
+    vector<uint8_t> data(72, 0x30);
+    uint64_t k0 = 0x0706050403020100ULL, k1 = 0x0F0E0D0C0B0A0908ULL;
+    while (state.KeepRunning())
+        k0 = CSipHasher(k0, k1).Write(data.data(), data.size()).Finalize();
+}
+
+BENCHMARK(HashWriter_32b);
+BENCHMARK(HashWriter_1MB);
+BENCHMARK(Hash160_33b);
+BENCHMARK(MerkleTree_1000);
+BENCHMARK(MerkleTree_10000);
+BENCHMARK(MerkleTree_50000);
+BENCHMARK(MerkleTreePairwise_1000);
+BENCHMARK(MerkleTreePairwise_10000);
+BENCHMARK(MerkleTreePairwise_50000);
+BENCHMARK(KeySign);
+BENCHMARK(PubKeyVerify);
+BENCHMARK(PubKeyVerifyZipf_NoCache);
+BENCHMARK(PubKeyVerifyZipf_Cache);
+BENCHMARK(PubKeyRecoverCompact);
+BENCHMARK(SigCacheGet);
+BENCHMARK(SigCacheSet);
+BENCHMARK(WalletEncryptSecret);
+BENCHMARK(WalletDecryptSecret);
+BENCHMARK(SipHash_32b);
+BENCHMARK(SipHasher_72b);
@@ -0,0 +1,113 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "commons/hasher.h"
+#include "commons/random.h"
+#include "entities/id.h"
+#include "entities/key.h"
+
+#include <map>
+#include <unordered_map>
+
+using namespace std;
+
+static const size_t LOOKUP_KEYS    = 100000;
+// Keys a peer may craft against CUint256Hasher: the 8 bytes it returns are the same
+static const size_t COLLISION_KEYS = 5000;
+
+static vector<uint256> RandomKeys(size_t count) {
+    vector<uint256> keys;
+    for (size_t i = 0; i < count; i++)
+        keys.push_back(GetRandHash());
+    return keys;
+}
+
+static vector<uint256> CollidingKeys(size_t count) {
+    vector<uint256> keys = RandomKeys(count);
+    for (auto &key : keys)
+        memset(key.begin(), 0, 8);
+    return keys;
+}
+
+template <typename Map>
+static void LookupBench(benchmark::State &state, const vector<uint256> &keys) {
+    Map map;
+    for (const auto &key : keys)
+        map.emplace(key, 1);
+
+    size_t i = 0;
+    uint64_t found = 0;
+    while (state.KeepRunning())
+        found += map.count(keys[i++ % keys.size()]);
+    BENCH_CHECK(found > 0);
+}
+
+template <typename Map>
+static void InsertBench(benchmark::State &state, const vector<uint256> &keys) {
+    while (state.KeepRunning()) {
+        Map map;
+        for (const auto &key : keys)
+            map.emplace(key, 1);
+    }
+}
+
+static void Uint256Lookup_OrderedMap(benchmark::State &state) {
+    LookupBench<map<uint256, int>>(state, RandomKeys(LOOKUP_KEYS));
+}
+
+static void Uint256Lookup_CheapHasher(benchmark::State &state) {
+    LookupBench<unordered_map<uint256, int, CUint256Hasher>>(state, RandomKeys(LOOKUP_KEYS));
+}
+
+static void Uint256Lookup_SaltedHasher(benchmark::State &state) {
+    LookupBench<unordered_map<uint256, int, CSaltedUint256Hasher>>(state, RandomKeys(LOOKUP_KEYS));
+}
+
+static void Uint256Collisions_CheapHasher(benchmark::State &state) {
+    InsertBench<unordered_map<uint256, int, CUint256Hasher>>(state, CollidingKeys(COLLISION_KEYS));
+}
+
+static void Uint256Collisions_SaltedHasher(benchmark::State &state) {
+    InsertBench<unordered_map<uint256, int, CSaltedUint256Hasher>>(state, CollidingKeys(COLLISION_KEYS));
+}
+
+static void KeyIDLookup_SaltedHasher(benchmark::State &state) {
+    unordered_map<CKeyID, int, CSaltedKeyIDHasher> map;
+    vector<CKeyID> keys;
+    for (const auto &hash : RandomKeys(LOOKUP_KEYS)) {
+        keys.push_back(CKeyID(Hash160(hash.begin(), hash.end())));
+        map.emplace(keys.back(), 1);
+    }
+
+    size_t i = 0;
+    uint64_t found = 0;
+    while (state.KeepRunning())
+        found += map.count(keys[i++ % keys.size()]);
+    BENCH_CHECK(found > 0);
+}
+
+static void RegIDLookup_SaltedHasher(benchmark::State &state) {
+    unordered_map<CRegID, int, CSaltedRegIDHasher> map;
+    vector<CRegID> keys;
+    for (uint32_t i = 0; i < LOOKUP_KEYS; i++) {
+        keys.emplace_back(1000000 + i / 8, i % 8);
+        map.emplace(keys.back(), 1);
+    }
+
+    size_t i = 0;
+    uint64_t found = 0;
+    while (state.KeepRunning())
+        found += map.count(keys[i++ % keys.size()]);
+    BENCH_CHECK(found > 0);
+}
+
+BENCHMARK(Uint256Lookup_OrderedMap);
+BENCHMARK(Uint256Lookup_CheapHasher);
+BENCHMARK(Uint256Lookup_SaltedHasher);
+BENCHMARK(Uint256Collisions_CheapHasher);
+BENCHMARK(Uint256Collisions_SaltedHasher);
+BENCHMARK(KeyIDLookup_SaltedHasher);
+BENCHMARK(RegIDLookup_SaltedHasher);
@@ -0,0 +1,137 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "main.h"
+#include "tx/blockrewardtx.h"
+#include "tx/cointransfertx.h"
+#include "tx/txmempool.h"
+
+#include <cstdio>
+
+using namespace std;
+
+// Txs of distinct senders, signed once, accepted into the mempool
+static const uint32_t MEMPOOL_BENCH_TXS = 1000;
+
+// A chain tip produced by a regid, over an in-memory db holding the funded senders of the txs
+struct MemPoolBenchSetup {
+    CCacheDBManager *pSavedCdMan;
+    vector<uint256> hashes;
+    vector<CBlockIndex> indexes;
+    vector<std::shared_ptr<CBaseTx>> txs;
+
+    MemPoolBenchSetup() {
+        pSavedCdMan = pCdMan;
+        pCdMan      = new CCacheDBManager(false, true);
+
+        // long enough for the fuel rate
+        uint32_t count = DEFAULT_BURN_BLOCK_SIZE + 2;
+        int32_t height = SysCfg().GetVer2ForkHeight() + 100;
+        hashes.resize(count);
+        indexes.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            hashes[i]             = GetRandHash();
+            indexes[i].pBlockHash = &hashes[i];
+            indexes[i].pprev      = i > 0 ? &indexes[i - 1] : nullptr;
+            indexes[i].height     = height - count + 1 + i;
+            indexes[i].nTime      = 1600000000 + i * 3;
+            indexes[i].nFuelRate  = INIT_FUEL_RATE;
+            indexes[i].nFuelFee   = 0;
+        }
+
+        CBlock block;
+        block.SetHeight(height);
+        block.vptx.push_back(std::make_shared<CUCoinBlockRewardTx>(CUserID(CRegID(100, 1)),
+                                                                   map<TokenSymbol, uint64_t>(), height));
+
+        for (uint32_t i = 0; i < MEMPOOL_BENCH_TXS; i++) {
+            CKey key;
+            key.MakeNewKey();
+            CAccount account(key.GetPubKey().GetKeyId(), key.GetPubKey());
+            ReceiptList receipts;
+            account.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, 100 * COIN, ReceiptType::TRANSFER_ACTUAL_COINS,
+                                   receipts);
+            pCdMan->pAccountCache->SaveAccount(account);
+
+            CKey toKey;
+            toKey.MakeNewKey();
+            auto spTx = std::make_shared<CBaseCoinTransferTx>(CUserID(key.GetPubKey()),
+                                                              CUserID(toKey.GetPubKey().GetKeyId()), height + 1, COIN,
+                                                              COIN / 10, "");
+            key.Sign(spTx->GetHash(), spTx->signature);
+            txs.push_back(spTx);
+        }
+
+        LOCK2(cs_main, mempool.cs);
+        chainActive.SetTip(&indexes.back(), &block);
+        chainActive.tip_block = block;  // SetTip() keeps the block only when the chain had a fork point
+        mempool.Clear();
+    }
+
+    ~MemPoolBenchSetup() {
+        {
+            LOCK2(cs_main, mempool.cs);
+            mempool.Clear();
+            mempool.cw.reset();
+            chainActive.SetTip(nullptr, nullptr);
+        }
+        delete pCdMan;
+        pCdMan = pSavedCdMan;
+    }
+
+    void AcceptAll() {
+        LOCK(cs_main);
+        for (const auto &spTx : txs) {
+            CValidationState state;
+            BENCH_CHECK(AcceptToMemoryPool(mempool, state, spTx, false, false));
+        }
+    }
+};
+
+// The txs accepted into an empty mempool, then dropped. The allocations per accepted tx are
+// written to stderr once per run.
+static void MemPoolAccept(benchmark::State &state) {
+    MemPoolBenchSetup setup;
+    bool fReported = false;
+    while (state.KeepRunning()) {
+        uint64_t nStart = benchmark::GetAllocations();
+        setup.AcceptAll();
+        uint64_t nAccepted = benchmark::GetAllocations() - nStart;
+        BENCH_CHECK(mempool.Size() == MEMPOOL_BENCH_TXS);
+
+        if (!fReported) {
+            fprintf(stderr, "accept of %u txs: %.1f allocations per tx\n", MEMPOOL_BENCH_TXS,
+                    (double)nAccepted / MEMPOOL_BENCH_TXS);
+            fReported = true;
+        }
+
+        LOCK(mempool.cs);
+        mempool.Clear();
+    }
+}
+
+// The txs executed again in the mempool view, as on a new tip. The allocations per tx of a
+// rescan are written to stderr once per run.
+static void MemPoolRescan(benchmark::State &state) {
+    MemPoolBenchSetup setup;
+    setup.AcceptAll();
+    bool fReported = false;
+    while (state.KeepRunning()) {
+        uint64_t nStart = benchmark::GetAllocations();
+        mempool.ReScanMemPoolTx();
+        uint64_t nRescanned = benchmark::GetAllocations() - nStart;
+        BENCH_CHECK(mempool.Size() == MEMPOOL_BENCH_TXS);
+
+        if (!fReported) {
+            fprintf(stderr, "rescan of %u txs: %.1f allocations per tx\n", MEMPOOL_BENCH_TXS,
+                    (double)nRescanned / MEMPOOL_BENCH_TXS);
+            fReported = true;
+        }
+    }
+}
+
+BENCHMARK(MemPoolAccept);
+BENCHMARK(MemPoolRescan);
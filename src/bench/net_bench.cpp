@@ -0,0 +1,512 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "commons/random.h"
+#include "main.h"
+#include "net.h"
+#include "p2p/chainmessage.h"
+#include "p2p/node.h"
+#include "p2p/relaycache.h"
+#include "p2p/socketevents.h"
+#include "tx/cointransfertx.h"
+#include "tx/txserializer.h"
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+
+using namespace std;
+
+// Peers connected over socket pairs, one of them gets a byte on every pass while the
+// others stay idle: the cost of a socket thread pass divided by the peers is the CPU
+// spent per connection.
+struct Peers {
+    vector<unique_ptr<CNode>> nodes;
+    vector<SOCKET> remotes;
+
+    explicit Peers(size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            int fds[2];
+            int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+            BENCH_CHECK(ret == 0);
+            // the remote ends go above FD_SETSIZE, select() only needs the peers below it
+            SOCKET hRemote = fcntl(fds[1], F_DUPFD, FD_SETSIZE);
+            BENCH_CHECK(hRemote != INVALID_SOCKET);
+            close(fds[1]);
+            fds[1] = hRemote;
+            fcntl(fds[0], F_SETFL, O_NONBLOCK);
+            nodes.emplace_back(new CNode(fds[0], CAddress(), "", true));
+            remotes.push_back(fds[1]);
+        }
+    }
+
+    ~Peers() {
+        for (auto hSocket : remotes)
+            closesocket(hSocket);
+    }
+
+    CNode *Poke(size_t i) {
+        CNode *pNode = nodes[i % nodes.size()].get();
+        ssize_t nBytes = send(remotes[i % nodes.size()], "x", 1, MSG_NOSIGNAL);
+        BENCH_CHECK(nBytes == 1);
+        return pNode;
+    }
+};
+
+static void Drain(CNode *pNode) {
+    char ch;
+    ssize_t nBytes = recv(pNode->hSocket, &ch, 1, MSG_DONTWAIT);
+    BENCH_CHECK(nBytes == 1);
+}
+
+// What SocketHandlerSelect() does for the peers on every pass
+static void SelectPass(benchmark::State &state, size_t count) {
+    Peers peers(count);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        CNode *pPoked = peers.Poke(i++);
+
+        fd_set fdsetRecv, fdsetSend, fdsetError;
+        FD_ZERO(&fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        SOCKET hSocketMax = 0;
+        for (const auto &spNode : peers.nodes) {
+            CNode *pNode = spNode.get();
+            FD_SET(pNode->hSocket, &fdsetError);
+            hSocketMax = max(hSocketMax, pNode->hSocket);
+            {
+                TRY_LOCK(pNode->cs_vSend, lockSend);
+                if (lockSend && !pNode->vSendMsg.empty()) {
+                    FD_SET(pNode->hSocket, &fdsetSend);
+                    continue;
+                }
+            }
+            TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+            if (lockRecv)
+                FD_SET(pNode->hSocket, &fdsetRecv);
+        }
+
+        struct timeval timeout = {0, 50000};
+        int32_t nSelect = select(hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        BENCH_CHECK(nSelect == 1);
+        for (const auto &spNode : peers.nodes) {
+            if (FD_ISSET(spNode->hSocket, &fdsetRecv))
+                Drain(spNode.get());
+        }
+        BENCH_CHECK(pPoked->hSocket != INVALID_SOCKET);
+    }
+}
+
+static void SocketPass_Select_100(benchmark::State &state) { SelectPass(state, 100); }
+static void SocketPass_Select_1000(benchmark::State &state) { SelectPass(state, 1000); }
+
+BENCHMARK(SocketPass_Select_100);
+BENCHMARK(SocketPass_Select_1000);
+
+#ifdef HAVE_SYS_EPOLL_H
+// What SocketHandlerEpoll() does for the peers on every pass
+static void EpollPass(benchmark::State &state, size_t count) {
+    Peers peers(count);
+    CSocketEvents events;
+    bool fInit = events.Init("epoll");
+    BENCH_CHECK(fInit);
+    for (const auto &spNode : peers.nodes)
+        events.AddNode(spNode.get());
+
+    size_t i = 0;
+    vector<CSocketEvents::Event> ready;
+    while (state.KeepRunning()) {
+        CNode *pPoked = peers.Poke(i++);
+
+        ready.clear();
+        int32_t nReady = events.Wait(50, ready);
+        BENCH_CHECK(nReady == 1 && ready[0].pNode == pPoked);
+        TRY_LOCK(pPoked->cs_vRecvMsg, lockRecv);
+        if (lockRecv)
+            Drain(pPoked);
+    }
+}
+
+static void SocketPass_Epoll_100(benchmark::State &state) { EpollPass(state, 100); }
+static void SocketPass_Epoll_1000(benchmark::State &state) { EpollPass(state, 1000); }
+// beyond FD_SETSIZE, needs a descriptor limit above 10000
+static void SocketPass_Epoll_5000(benchmark::State &state) { EpollPass(state, 5000); }
+
+BENCHMARK(SocketPass_Epoll_100);
+BENCHMARK(SocketPass_Epoll_1000);
+BENCHMARK(SocketPass_Epoll_5000);
+#endif
+
+// Latency a hop adds between a complete message and the message handler running: the
+// handler slept up to MESSAGE_HANDLER_INTERVAL_MS before, half of it on average
+static void MessageHandlerWakeup(benchmark::State &state) {
+    std::atomic<bool> fStop{false};
+    std::atomic<uint64_t> nPasses{0};
+    std::thread handler([&]() {
+        while (!fStop) {
+            WaitMessageHandler(0, MESSAGE_HANDLER_INTERVAL_MS);
+            nPasses++;
+        }
+    });
+
+    // let the handler go to sleep
+    MilliSleep(10);
+    while (state.KeepRunning()) {
+        uint64_t nPassed = nPasses;
+        WakeMessageHandler(0);
+        while (nPasses == nPassed)
+            std::this_thread::yield();
+    }
+
+    fStop = true;
+    WakeMessageHandler(0);
+    handler.join();
+}
+
+BENCHMARK(MessageHandlerWakeup);
+
+// A block of BROADCAST_BLOCK_TXS txs pushed to BROADCAST_PEERS peers, serialized and framed for
+// every peer by PushMessage(), or once and shared by PushSharedMessage(). The peers have no
+// socket, the messages stay in their send queues until the broadcast is over. The allocations
+// and their bytes per broadcast are written to stderr once per run.
+static const size_t BROADCAST_PEERS       = 128;
+static const uint32_t BROADCAST_BLOCK_TXS = 2000;
+
+struct BroadcastPeers {
+    vector<unique_ptr<CNode>> nodes;
+
+    BroadcastPeers() {
+        for (size_t i = 0; i < BROADCAST_PEERS; i++) {
+            struct in_addr ip;
+            ip.s_addr = htonl(0x0a000001 + i);
+            nodes.emplace_back(new CNode(INVALID_SOCKET, CAddress(CService(CNetAddr(ip), 8920)), "", true));
+            nodes.back()->nVersion = PROTOCOL_VERSION;
+        }
+    }
+
+    size_t Clear() {
+        size_t nQueued = 0;
+        for (const auto &spNode : nodes) {
+            LOCK(spNode->cs_vSend);
+            nQueued += spNode->vSendMsg.size();
+            while (!spNode->vSendMsg.empty())
+                spNode->vSendMsg.PopFront();
+            spNode->nSendSize = 0;
+        }
+        return nQueued;
+    }
+};
+
+template <typename PushFunc>
+static void BlockBroadcast(benchmark::State &state, const char *pszName, PushFunc push) {
+    CBlock block;
+    block.SetHeight(1);
+    for (uint32_t n = 0; n < BROADCAST_BLOCK_TXS; n++)
+        block.vptx.push_back(std::make_shared<CBaseCoinTransferTx>(CRegID(1000000 + n / 8, n % 8), CRegID(100, 1),
+                                                                   1000 + n % 100, GetRand(1000000) + 1, 10000, ""));
+    size_t nBlockSize = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+
+    BroadcastPeers peers;
+    bool fReported = false;
+    while (state.KeepRunning()) {
+        uint64_t nAllocations = benchmark::GetAllocations();
+        uint64_t nBytes       = benchmark::GetAllocatedBytes();
+        push(peers, block);
+        nAllocations = benchmark::GetAllocations() - nAllocations;
+        nBytes       = benchmark::GetAllocatedBytes() - nBytes;
+        BENCH_CHECK(peers.Clear() == BROADCAST_PEERS);
+
+        if (!fReported) {
+            fprintf(stderr, "%s of a %u byte block to %u peers: %u allocations, %.1f MB allocated\n", pszName,
+                    (uint32_t)nBlockSize, (uint32_t)BROADCAST_PEERS, (uint32_t)nAllocations, nBytes / 1e6);
+            fReported = true;
+        }
+    }
+}
+
+static void BlockBroadcast_PushMessage(benchmark::State &state) {
+    BlockBroadcast(state, "PushMessage", [](BroadcastPeers &peers, const CBlock &block) {
+        for (const auto &spNode : peers.nodes)
+            spNode->PushMessage(NetMsgType::BLOCK, block);
+    });
+}
+
+static void BlockBroadcast_PushSharedMessage(benchmark::State &state) {
+    BlockBroadcast(state, "PushSharedMessage", [](BroadcastPeers &peers, const CBlock &block) {
+        CSharedNetMessage spMessage = MakeSharedNetMessage(NetMsgType::BLOCK, block);
+        for (const auto &spNode : peers.nodes)
+            spNode->PushSharedMessage(spMessage);
+    });
+}
+
+BENCHMARK(BlockBroadcast_PushMessage);
+BENCHMARK(BlockBroadcast_PushSharedMessage);
+
+// IBD_PEERS peers syncing from us, each asks for the same IBD_BLOCKS blocks written by
+// WriteBlockToDisk(). ProcessGetData() used to read every block into a CBlock and
+// serialize it again holding cs_main, it now serves the block message of
+// GetRawBlockMessage(), cs_main is only taken to look the block up. The blocks do not fit
+// in the raw block cache, every pass reads each of them from disk again, once for the
+// peers asking for it at about the same time.
+static const size_t IBD_PEERS      = 8;
+static const size_t IBD_BLOCKS     = 400;
+static const size_t IBD_BLOCK_TXS  = 2000;
+
+// The blocks in the block files of a temporary data dir
+struct BlockFile {
+    boost::filesystem::path dataDir;
+    vector<pair<uint256, CDiskBlockPos>> blocks;
+
+    BlockFile() {
+        dataDir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        boost::filesystem::create_directories(dataDir);
+        SysCfg().SoftSetArgCover("-datadir", dataDir.string());
+        ClearDatadirCache();
+
+        CDiskBlockPos pos(0, 0);
+        for (size_t i = 0; i < IBD_BLOCKS; i++) {
+            CBlock block;
+            block.SetHeight(i + 1);
+            block.SetPrevBlockHash(GetRandHash());
+            for (uint32_t n = 0; n < IBD_BLOCK_TXS; n++)
+                block.vptx.push_back(std::make_shared<CBaseCoinTransferTx>(
+                    CRegID(1000000 + n / 8, n % 8), CRegID(100, 1), 1000 + n % 100, GetRand(1000000) + 1, 10000, ""));
+            block.SetMerkleRootHash(block.BuildMerkleTree());
+
+            bool ret = WriteBlockToDisk(block, pos);
+            BENCH_CHECK(ret);
+            blocks.emplace_back(block.GetHash(), pos);
+            pos.nPos += ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+        }
+    }
+
+    ~BlockFile() {
+        CBaseParams::EraseArg("-datadir");
+        ClearDatadirCache();
+        boost::filesystem::remove_all(dataDir);
+    }
+};
+
+// The blocks of the block file in the block index, the last one is the tip
+struct BlockIndex {
+    vector<unique_ptr<CBlockIndex>> indexes;
+
+    explicit BlockIndex(const BlockFile &blockFile) {
+        LOCK(cs_main);
+        for (const auto &item : blockFile.blocks) {
+            CBlockIndex *pIndex = new CBlockIndex();
+            pIndex->pBlockHash  = &mapBlockIndex.emplace(item.first, pIndex).first->first;
+            pIndex->pprev       = indexes.empty() ? nullptr : indexes.back().get();
+            pIndex->height      = indexes.size() + 1;
+            pIndex->nStatus    |= BLOCK_HAVE_DATA;
+            pIndex->nFile       = item.second.nFile;
+            pIndex->nDataPos    = item.second.nPos;
+            indexes.emplace_back(pIndex);
+        }
+        CBlock tipBlock;
+        chainActive.SetTip(indexes.back().get(), &tipBlock);
+    }
+
+    ~BlockIndex() {
+        LOCK(cs_main);
+        chainActive.SetTip(nullptr, nullptr);
+        for (const auto &spIndex : indexes)
+            mapBlockIndex.erase(spIndex->GetBlockHash());
+    }
+};
+
+// Every peer asks for all the blocks at once, they are served to the peers in parallel as
+// the message handler workers do. The bytes queued are written to stderr once per run.
+static void IbdServe(benchmark::State &state, const char *pszName, std::function<void(CNode *)> serve) {
+    BlockFile blockFile;
+    BlockIndex blockIndex(blockFile);
+    // the queues of the peers are not sent, they take all the blocks
+    SysCfg().SoftSetArgCover("-maxsendbuffer", "1000000");
+
+    vector<unique_ptr<CNode>> nodes;
+    for (size_t p = 0; p < IBD_PEERS; p++) {
+        struct in_addr ip;
+        ip.s_addr = htonl(0x0a000001 + p);
+        nodes.emplace_back(new CNode(INVALID_SOCKET, CAddress(CService(CNetAddr(ip), 8920)), "", true));
+        nodes.back()->nVersion = PROTOCOL_VERSION;
+    }
+
+    bool fReported = false;
+    while (state.KeepRunning()) {
+        for (const auto &spNode : nodes) {
+            for (const auto &item : blockFile.blocks)
+                spNode->vRecvGetData.push_back(CInv(MSG_BLOCK, item.first));
+        }
+
+        vector<std::thread> peers;
+        for (const auto &spNode : nodes)
+            peers.emplace_back(serve, spNode.get());
+        for (auto &peer : peers)
+            peer.join();
+
+        size_t nBytes = 0;
+        for (const auto &spNode : nodes) {
+            LOCK(spNode->cs_vSend);
+            BENCH_CHECK(spNode->vRecvGetData.empty() && spNode->vSendMsg.size() == IBD_BLOCKS);
+            nBytes += spNode->nSendSize;
+            while (!spNode->vSendMsg.empty())
+                spNode->vSendMsg.PopFront();
+            spNode->nSendSize = 0;
+        }
+        if (!fReported) {
+            fprintf(stderr, "%s: %u blocks to %u peers, %.1f MB queued\n", pszName, (uint32_t)IBD_BLOCKS,
+                    (uint32_t)IBD_PEERS, nBytes / 1e6);
+            fReported = true;
+        }
+    }
+
+    CBaseParams::EraseArg("-maxsendbuffer");
+}
+
+// The former ProcessGetData() path: each block read into a CBlock and serialized again
+// for every peer, holding cs_main
+static void IbdServe_Deserialize(benchmark::State &state) {
+    IbdServe(state, "deserialize", [](CNode *pNode) {
+        for (const auto &inv : pNode->vRecvGetData) {
+            LOCK(cs_main);
+            CBlock block;
+            bool ret = ReadBlockFromDisk(mapBlockIndex[inv.hash], block);
+            BENCH_CHECK(ret && block.GetHash() == inv.hash);
+            pNode->PushMessage(NetMsgType::BLOCK, block);
+        }
+        pNode->vRecvGetData.clear();
+    });
+}
+
+static void IbdServe_GetData(benchmark::State &state) {
+    IbdServe(state, "ProcessGetData", [](CNode *pNode) {
+        ProcessGetData(pNode);
+    });
+}
+
+BENCHMARK(IbdServe_Deserialize);
+BENCHMARK(IbdServe_GetData);
+
+// RELAY_TX_RATE txs relayed a second, an iteration is one second of it. Peer p asks for
+// the txs relayed p * RELAY_ASK_DELAY seconds before, the late peers stand for the slow
+// ones. mapRelay kept the message of every tx for 15 minutes, 4.5 million txs at this rate,
+// in a map ordered by inv. The relay cache keeps them within -maxrelaycache in a salted
+// hash map. The hits, the entries kept and the heap they hold are written to stderr at the
+// end of each run.
+static const size_t RELAY_TX_RATE   = 5000;
+static const size_t RELAY_PEERS     = 8;
+static const int64_t RELAY_ASK_DELAY = 10;
+
+static vector<std::shared_ptr<CBaseTx>> MakeRelayTxs() {
+    vector<std::shared_ptr<CBaseTx>> txs;
+    for (uint32_t n = 0; n < RELAY_TX_RATE; n++)
+        txs.push_back(std::make_shared<CBaseCoinTransferTx>(CRegID(1000000 + n / 8, n % 8), CRegID(100, 1),
+                                                            1000 + n % 100, GetRand(1000000) + 1, 10000, ""));
+    return txs;
+}
+
+// Framed as RelayTransaction() frames it
+static CSharedNetMessage MakeTxMessage(const std::shared_ptr<CBaseTx> &pBaseTx) {
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss.reserve(1000);
+    ss << pBaseTx;
+    return MakeSharedNetMessage(NetMsgType::TX, ss);
+}
+
+// relay keeps the message of a tx, get returns it or nullptr, size gives the entries kept
+template <typename RelayFunc, typename GetFunc, typename SizeFunc>
+static void RelayTxs(benchmark::State &state, const char *pszName, RelayFunc relay, GetFunc get, SizeFunc size) {
+    vector<std::shared_ptr<CBaseTx>> txs = MakeRelayTxs();
+    vector<deque<CSharedNetMessage>> queues(RELAY_PEERS);
+    int64_t nTime   = GetTime();
+    uint64_t nCount = 0;
+    uint64_t nHits = 0, nMisses = 0;
+    uint64_t nLiveBytes = benchmark::GetLiveBytes();
+    while (state.KeepRunning()) {
+        SetMockTime(++nTime);
+        for (const auto &pBaseTx : txs) {
+            // a new txid each time, the txs are only there for their bytes
+            uint256 txid;
+            memcpy(txid.begin(), &(++nCount), sizeof(nCount));
+            relay(pBaseTx, txid);
+        }
+        for (size_t p = 0; p < RELAY_PEERS; p++) {
+            // the txids of the second the peer is at
+            uint64_t nLate = p * RELAY_ASK_DELAY * RELAY_TX_RATE;
+            if (nLate >= nCount)
+                continue;
+            for (uint64_t n = nCount - nLate - RELAY_TX_RATE + 1; n <= nCount - nLate; n++) {
+                uint256 txid;
+                memcpy(txid.begin(), &n, sizeof(n));
+                CSharedNetMessage spMessage = get(txid);
+                if (spMessage) {
+                    queues[p].push_back(spMessage);
+                    nHits++;
+                } else {
+                    nMisses++;
+                }
+            }
+        }
+        for (auto &queue : queues)
+            queue.clear();
+    }
+    SetMockTime(0);
+
+    fprintf(stderr, "%s: %u s of %u tx/s, %u entries, %.1f MB held, %.1f%% hits of %u asks\n", pszName,
+            (uint32_t)state.GetIterations(), (uint32_t)RELAY_TX_RATE, (uint32_t)size(),
+            (int64_t)(benchmark::GetLiveBytes() - nLiveBytes) / 1e6, 100.0 * nHits / std::max<uint64_t>(nHits + nMisses, 1),
+            (uint32_t)(nHits + nMisses));
+}
+
+static void TxRelay_MapRelay(benchmark::State &state) {
+    std::mutex csRelay;
+    map<CInv, CSharedNetMessage> mapRelay;
+    deque<pair<int64_t, CInv>> vRelayExpiration;
+    RelayTxs(state, "mapRelay",
+        [&](const std::shared_ptr<CBaseTx> &pBaseTx, const uint256 &txid) {
+            CSharedNetMessage spMessage = MakeTxMessage(pBaseTx);
+            std::lock_guard<std::mutex> lock(csRelay);
+            while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime()) {
+                mapRelay.erase(vRelayExpiration.front().second);
+                vRelayExpiration.pop_front();
+            }
+            CInv inv(MSG_TX, txid);
+            mapRelay.insert(make_pair(inv, spMessage));
+            vRelayExpiration.push_back(make_pair(GetTime() + RELAY_CACHE_EXPIRY, inv));
+        },
+        [&](const uint256 &txid) {
+            std::lock_guard<std::mutex> lock(csRelay);
+            auto it = mapRelay.find(CInv(MSG_TX, txid));
+            return it != mapRelay.end() ? it->second : CSharedNetMessage();
+        },
+        [&]() { return mapRelay.size(); });
+}
+
+static void TxRelay_RelayCache(benchmark::State &state) {
+    CRelayCache cache;
+    RelayTxs(state, "relay cache",
+        [&](const std::shared_ptr<CBaseTx> &pBaseTx, const uint256 &txid) { cache.Add(txid, MakeTxMessage(pBaseTx)); },
+        [&](const uint256 &txid) { return cache.Get(txid); },
+        [&]() {
+            CRelayCache::Stats stats = cache.GetStats();
+            fprintf(stderr, "relay cache: %.1f MB accounted of %.1f MB, %u evictions, %u expirations\n",
+                    stats.nBytes / 1e6, stats.nMaxBytes / 1e6, (uint32_t)stats.nEvictions,
+                    (uint32_t)stats.nExpirations);
+            return stats.nEntries;
+        });
+}
+
+BENCHMARK(TxRelay_MapRelay);
+BENCHMARK(TxRelay_RelayCache);
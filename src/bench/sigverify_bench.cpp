@@ -0,0 +1,119 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "commons/random.h"
+#include "entities/id.h"
+#include "entities/key.h"
+#include "sigverify.h"
+
+#include <unordered_map>
+
+using namespace std;
+
+// Senders of the signed txs, the table stands in for the account cache
+static const size_t TX_SENDERS = 10000;
+
+struct SignedTxs {
+    unordered_map<CRegID, CPubKey, CSaltedRegIDHasher> accounts;
+    vector<CRegID> senders;
+    vector<uint256> hashes;
+    vector<vector<uint8_t>> signatures;
+
+    explicit SignedTxs(bool fCompact) {
+        for (uint32_t i = 0; i < TX_SENDERS; i++) {
+            CKey key;
+            key.MakeNewKey();
+            senders.emplace_back(1000000 + i / 8, i % 8);
+            accounts.emplace(senders.back(), key.GetPubKey());
+            hashes.push_back(GetRandHash());
+            signatures.emplace_back();
+            if (fCompact)
+                key.SignCompact(hashes.back(), signatures.back());
+            else
+                key.Sign(hashes.back(), signatures.back());
+        }
+    }
+};
+
+// Stateful path of a DER signature: the sender pubkey is read before verifying
+static void TxSigVerify_LookupAndVerify(benchmark::State &state) {
+    SignedTxs txs(false);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        size_t n   = i++ % TX_SENDERS;
+        auto it    = txs.accounts.find(txs.senders[n]);
+        bool valid = it != txs.accounts.end() && it->second.Verify(txs.hashes[n], txs.signatures[n]);
+        BENCH_CHECK(valid);
+    }
+}
+
+// Stateless path of a compact signature: the signer is recovered, nothing is read
+static void TxSigVerify_Recover(benchmark::State &state) {
+    SignedTxs txs(true);
+    size_t i = 0;
+    CPubKey pubKey;
+    while (state.KeepRunning()) {
+        size_t n       = i++ % TX_SENDERS;
+        bool recovered = pubKey.RecoverCompact(txs.hashes[n], txs.signatures[n]);
+        BENCH_CHECK(recovered);
+    }
+}
+
+// Both steps of a compact signature verified without the signature cache
+static void TxSigVerify_RecoverAndCompare(benchmark::State &state) {
+    SignedTxs txs(true);
+    size_t i = 0;
+    CPubKey pubKey;
+    while (state.KeepRunning()) {
+        size_t n   = i++ % TX_SENDERS;
+        auto it    = txs.accounts.find(txs.senders[n]);
+        bool valid = pubKey.RecoverCompact(txs.hashes[n], txs.signatures[n]) && it != txs.accounts.end() &&
+                     pubKey.GetKeyId() == it->second.GetKeyId();
+        BENCH_CHECK(valid);
+    }
+}
+
+// A batch of a block through CSigVerifyPool, the signature cache is not set up so every
+// signature is verified for real
+static void SigVerifyPoolBench(benchmark::State &state, int32_t numThreads) {
+    static const size_t BATCH_SIZE = 1000;
+
+    vector<CSigCheck> checks;
+    for (size_t i = 0; i < BATCH_SIZE; i++) {
+        CKey key;
+        key.MakeNewKey();
+        uint256 hash = GetRandHash();
+        vector<uint8_t> signature;
+        key.Sign(hash, signature);
+        checks.emplace_back(hash, signature, key.GetPubKey());
+    }
+
+    boost::thread_group threadGroup;
+    CSigVerifyPool pool;
+    pool.Start(threadGroup, numThreads);
+
+    while (state.KeepRunning()) {
+        bool valid = pool.Verify(checks);
+        BENCH_CHECK(valid);
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+// The workers and the submitting thread, 1 to 16 cores
+static void SigVerifyPool_1000_Threads0(benchmark::State &state) { SigVerifyPoolBench(state, 0); }
+static void SigVerifyPool_1000_Threads3(benchmark::State &state) { SigVerifyPoolBench(state, 3); }
+static void SigVerifyPool_1000_Threads7(benchmark::State &state) { SigVerifyPoolBench(state, 7); }
+static void SigVerifyPool_1000_Threads15(benchmark::State &state) { SigVerifyPoolBench(state, 15); }
+
+BENCHMARK(TxSigVerify_LookupAndVerify);
+BENCHMARK(TxSigVerify_Recover);
+BENCHMARK(TxSigVerify_RecoverAndCompare);
+BENCHMARK(SigVerifyPool_1000_Threads0);
+BENCHMARK(SigVerifyPool_1000_Threads3);
+BENCHMARK(SigVerifyPool_1000_Threads7);
+BENCHMARK(SigVerifyPool_1000_Threads15);
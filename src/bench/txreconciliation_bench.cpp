@@ -0,0 +1,72 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "crypto/hash.h"
+#include "p2p/protocol.h"
+#include "p2p/txreconciliation.h"
+
+#include <cstdio>
+
+using namespace std;
+
+// TXRECON_SET_TXS txs queued on both sides of a reconciliation, and a difference of
+// nDiff txs split between the initiator and the responder. The sketch of a first round
+// is sized for RECON_DEFAULT_Q of the set, the differences stay within it
+static const uint32_t TXRECON_SET_TXS = 2000;
+
+static uint256 MakeTxid(uint32_t n) { return Hash(BEGIN(n), END(n)); }
+
+// A round between two peers, from the reqrecon to the txs both announce once the
+// reconcildiff is in. The bytes of the messages of the round, against those of the invs
+// for the txs of the initiator, are written to stderr once per run.
+static void TxReconRound(benchmark::State &state, uint32_t nDiff) {
+    uint32_t nInitiatorOnly = nDiff - nDiff / 2;
+    uint32_t nResponderOnly = nDiff / 2;
+    bool fReported          = false;
+    while (state.KeepRunning()) {
+        CTxReconState initiator(true, 1111, 2222), responder(false, 2222, 1111);
+        for (uint32_t n = 0; n < TXRECON_SET_TXS; n++) {
+            initiator.AddTx(MakeTxid(n));
+            responder.AddTx(MakeTxid(n));
+        }
+        for (uint32_t n = 0; n < nInitiatorOnly; n++)
+            initiator.AddTx(MakeTxid(TXRECON_SET_TXS + n));
+        for (uint32_t n = 0; n < nResponderOnly; n++)
+            responder.AddTx(MakeTxid(TXRECON_SET_TXS + nInitiatorOnly + n));
+
+        CReconRequest request = initiator.MakeRequest(100);
+        CReconSketch sketch;
+        BENCH_CHECK(responder.ProcessRequest(request, 100, sketch));
+
+        vector<uint256> initiatorTxids, responderTxids;
+        CReconDiff diff;
+        BENCH_CHECK(initiator.ProcessSketch(sketch, initiatorTxids, diff));
+        BENCH_CHECK(diff.fSuccess);
+        BENCH_CHECK(initiatorTxids.size() == nInitiatorOnly);
+        BENCH_CHECK(responder.ProcessDiff(diff, responderTxids));
+        BENCH_CHECK(responderTxids.size() == nResponderOnly);
+
+        if (!fReported) {
+            size_t reconBytes = ::GetSerializeSize(request, SER_NETWORK, PROTOCOL_VERSION) +
+                                ::GetSerializeSize(sketch, SER_NETWORK, PROTOCOL_VERSION) +
+                                ::GetSerializeSize(diff, SER_NETWORK, PROTOCOL_VERSION) +
+                                3 * CMessageHeader::HEADER_SIZE;
+            size_t invBytes = ::GetSerializeSize(vector<CInv>(request.nSetSize), SER_NETWORK, PROTOCOL_VERSION) +
+                              CMessageHeader::HEADER_SIZE;
+            fprintf(stderr, "set of %u txs, difference of %u: %u sketch cells, %u bytes reconciliation vs %u inv\n",
+                    request.nSetSize, nDiff, sketch.GetCellCount(), (uint32_t)reconBytes, (uint32_t)invBytes);
+            fReported = true;
+        }
+    }
+}
+
+static void TxReconRound_10(benchmark::State &state) { TxReconRound(state, 10); }
+static void TxReconRound_100(benchmark::State &state) { TxReconRound(state, 100); }
+static void TxReconRound_250(benchmark::State &state) { TxReconRound(state, 250); }
+
+BENCHMARK(TxReconRound_10);
+BENCHMARK(TxReconRound_100);
+BENCHMARK(TxReconRound_250);
@@ -8,6 +8,11 @@
 #define CHAIN_CHAIN_H
 
 #include "persistence/block.h"
+#include "commons/hasher.h"
+
+#include <unordered_map>
+
+typedef std::unordered_map<uint256, CBlockIndex *, CSaltedUint256Hasher> BlockMap;
 
 /** An in-memory indexed chain of blocks. */
 class CChain {
@@ -48,7 +53,7 @@ public:
     CBlockLocator GetLocator(const CBlockIndex *pIndex = nullptr) const;
 
     /** Find the last common block between this chain and a locator. */
-    CBlockIndex *FindFork(map<uint256, CBlockIndex *> &mapBlockIndex, const CBlockLocator &locator) const;
+    CBlockIndex *FindFork(BlockMap &mapBlockIndex, const CBlockLocator &locator) const;
 
 }; //end of CChain
 
@@ -69,7 +69,7 @@ bool CBloomFilter::IsWithinSizeConstraints() const {
     return vData.size() <= MAX_BLOOM_FILTER_SIZE && nHashFuncs <= MAX_HASH_FUNCS;
 }
 
-bool CBloomFilter::IsRelevantAndUpdate(CBaseTx* pBaseTx, const uint256& hash) {
+bool CBloomFilter::IsRelevantAndUpdate(const CBaseTx* pBaseTx, const uint256& hash) {
     //    bool fFound = false;
     // Match if the filter contains the hash of tx
     //  for finding tx when they appear in a block
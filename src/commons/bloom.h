@@ -78,7 +78,7 @@ public:
     bool IsWithinSizeConstraints() const;
 
     // Also adds any outputs which match the filter to the filter (to match their spending txes)
-    bool IsRelevantAndUpdate(CBaseTx* pBaseTx, const uint256& hash);
+    bool IsRelevantAndUpdate(const CBaseTx* pBaseTx, const uint256& hash);
 
     // Checks for empty and full filters to avoid wasting cpu
     void UpdateEmptyFull();
@@ -0,0 +1,17 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "hasher.h"
+
+#include "commons/random.h"
+
+static CHasherSalt MakeHasherSalt() {
+    uint256 salt = GetRandHash();
+    return {salt.GetUint64(0), salt.GetUint64(1)};
+}
+
+const CHasherSalt &GetHasherSalt() {
+    static const CHasherSalt salt = MakeHasherSalt();
+    return salt;
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COMMONS_HASHER_H
+#define COMMONS_HASHER_H
+
+#include "commons/uint256.h"
+#include "crypto/siphash.h"
+
+/** The SipHash key of the salted hashers, drawn once per process */
+struct CHasherSalt {
+    uint64_t k0;
+    uint64_t k1;
+};
+
+const CHasherSalt &GetHasherSalt();
+
+/**
+ * Hasher of the hash tables keyed on values a peer may choose, like block and tx
+ * hashes: the keyed SipHash-2-4 can not be aimed at one bucket, unlike the low
+ * 64 bits CUint256Hasher returns.
+ *
+ * operator() is left without noexcept, so libstdc++ keeps the hash in the nodes
+ * instead of running SipHash again on every node of a bucket it walks.
+ */
+class CSaltedUint256Hasher {
+public:
+    CSaltedUint256Hasher() : k0(GetHasherSalt().k0), k1(GetHasherSalt().k1) {}
+
+    size_t operator()(const uint256 &hash) const { return SipHashUint256(k0, k1, hash); }
+
+private:
+    uint64_t k0, k1;
+};
+
+// Also the hasher of CKeyID
+class CSaltedUint160Hasher {
+public:
+    CSaltedUint160Hasher() : k0(GetHasherSalt().k0), k1(GetHasherSalt().k1) {}
+
+    size_t operator()(const uint160 &hash) const {
+        return CSipHasher(k0, k1)
+            .Write(hash.GetUint64(0))
+            .Write(hash.GetUint64(1))
+            .Write(hash.begin() + 16, 4)
+            .Finalize();
+    }
+
+private:
+    uint64_t k0, k1;
+};
+
+#endif  // COMMONS_HASHER_H
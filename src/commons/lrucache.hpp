@@ -3,6 +3,10 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#ifndef COMMONS_LRUCACHE_HPP
+#define COMMONS_LRUCACHE_HPP
+
+#include <functional>
 #include <unordered_map>
 #include <list>
 
@@ -149,12 +153,14 @@ private:
             // remove the last element.
             const auto &lastData = queue.back();
             curr_size -= GetItemSize(lastData);
-            queue.pop_back();
             index.erase( lastData.first );
+            queue.pop_back();
         }
     }
 
     inline uint32_t GetItemSize(const Item &item) {
         return size_func == nullptr ? 1 : size_func(item);
     }
-};
\ No newline at end of file
+};
+
+#endif  // COMMONS_LRUCACHE_HPP
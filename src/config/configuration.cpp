@@ -88,6 +88,11 @@ uint32_t G_CONFIG_TABLE::GetVer3ForkHeight(const NET_TYPE type) const {
     return nVer3ForkHeight[type];
 }
 
+uint32_t G_CONFIG_TABLE::GetVer4ForkHeight(const NET_TYPE type) const {
+    assert(type >= 0 && type < 3);
+    return nVer4ForkHeight[type];
+}
+
 vector<uint32_t> G_CONFIG_TABLE::GetSeedNodeIP() const { return pnSeed; }
 
 uint8_t* G_CONFIG_TABLE::GetMagicNumber(const NET_TYPE type) const {
@@ -278,3 +283,9 @@ uint32_t G_CONFIG_TABLE::nVer3ForkHeight[3] {
     11776688,   // mainnet, estimate block time: 2020-07-20 10:10:08
     5756220,    // testnet, estimate block time: 2020-06-04 10:00:00
     500};       // regtest
+
+// Block height to enable feature fork version, INT32_MAX until it is scheduled
+uint32_t G_CONFIG_TABLE::nVer4ForkHeight[3] {
+    INT32_MAX,  // mainnet, not scheduled yet
+    INT32_MAX,  // testnet, not scheduled yet
+    600};       // regtest
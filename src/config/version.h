@@ -54,6 +54,7 @@ enum FeatureForkVersionEnum {
     MAJOR_VER_R1 = 10001, // Release 1.0
     MAJOR_VER_R2 = 10002, // Release 2.0: StableCoin Release (2019-06-30)
     MAJOR_VER_R3 = 10003, // Release 3.0: HU Release (2019-11-11)
+    MAJOR_VER_R4 = 10004, // Release 4.0: recoverable tx signatures
 };
 
 #endif // COIN_VERSION_H
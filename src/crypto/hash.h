@@ -10,6 +10,7 @@
 #include "commons/uint256.h"
 #include "commons/util/util.h"
 #include "config/version.h"
+#include "crypto/sha256.h"
 
 #include <openssl/ripemd.h>
 #include <openssl/sha.h>
@@ -18,21 +19,24 @@
 
 using namespace std;
 
+// All the SHA256 hashing goes through CSHA256, which uses the implementation picked by SHA256AutoDetect()
+
 template <typename T1>
 inline uint256 Hash(const T1 pbegin, const T1 pend) {
     static uint8_t pblank[1];
     uint256 hash1;
-    SHA256((pbegin == pend ? pblank : (uint8_t *)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]),
-           (uint8_t *)&hash1);
+    CSHA256()
+        .Write((pbegin == pend ? pblank : (uint8_t *)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]))
+        .Finalize((uint8_t *)&hash1);
     uint256 hash2;
-    SHA256((uint8_t *)&hash1, sizeof(hash1), (uint8_t *)&hash2);
+    CSHA256().Write((uint8_t *)&hash1, sizeof(hash1)).Finalize((uint8_t *)&hash2);
     return hash2;
 }
 
 inline uint256 HashOnce(const unsigned char *data, size_t size) {
     uint256 hash;
     if (data != nullptr && size > 0)
-        SHA256(data, size, (uint8_t *)&hash);
+        CSHA256().Write(data, size).Finalize((uint8_t *)&hash);
     return hash;
 }
 
@@ -42,27 +46,27 @@ inline uint256 HashOnce(const void *data, size_t size) {
 
 class CHashWriter {
 private:
-    SHA256_CTX ctx;
+    CSHA256 ctx;
 
 public:
     int32_t nType;
     int32_t nVersion;
 
-    void Init() { SHA256_Init(&ctx); }
+    void Init() { ctx.Reset(); }
 
-    CHashWriter(int32_t nTypeIn, int32_t nVersionIn) : nType(nTypeIn), nVersion(nVersionIn) { Init(); }
+    CHashWriter(int32_t nTypeIn, int32_t nVersionIn) : nType(nTypeIn), nVersion(nVersionIn) {}
 
     CHashWriter &write(const char *pch, size_t size) {
-        SHA256_Update(&ctx, pch, size);
+        ctx.Write((const uint8_t *)pch, size);
         return (*this);
     }
 
     // invalidates the object
     uint256 GetHash() {
         uint256 hash1;
-        SHA256_Final((uint8_t *)&hash1, &ctx);
+        ctx.Finalize((uint8_t *)&hash1);
         uint256 hash2;
-        SHA256((uint8_t *)&hash1, sizeof(hash1), (uint8_t *)&hash2);
+        CSHA256().Write((uint8_t *)&hash1, sizeof(hash1)).Finalize((uint8_t *)&hash2);
         return hash2;
     }
 
@@ -78,15 +82,12 @@ template <typename T1, typename T2>
 inline uint256 Hash(const T1 p1begin, const T1 p1end, const T2 p2begin, const T2 p2end) {
     static uint8_t pblank[1];
     uint256 hash1;
-    SHA256_CTX ctx;
-    SHA256_Init(&ctx);
-    SHA256_Update(&ctx, (p1begin == p1end ? pblank : (uint8_t *)&p1begin[0]),
-                  (p1end - p1begin) * sizeof(p1begin[0]));
-    SHA256_Update(&ctx, (p2begin == p2end ? pblank : (uint8_t *)&p2begin[0]),
-                  (p2end - p2begin) * sizeof(p2begin[0]));
-    SHA256_Final((uint8_t *)&hash1, &ctx);
+    CSHA256()
+        .Write((p1begin == p1end ? pblank : (uint8_t *)&p1begin[0]), (p1end - p1begin) * sizeof(p1begin[0]))
+        .Write((p2begin == p2end ? pblank : (uint8_t *)&p2begin[0]), (p2end - p2begin) * sizeof(p2begin[0]))
+        .Finalize((uint8_t *)&hash1);
     uint256 hash2;
-    SHA256((uint8_t *)&hash1, sizeof(hash1), (uint8_t *)&hash2);
+    CSHA256().Write((uint8_t *)&hash1, sizeof(hash1)).Finalize((uint8_t *)&hash2);
     return hash2;
 }
 
@@ -95,17 +96,13 @@ inline uint256 Hash(const T1 p1begin, const T1 p1end, const T2 p2begin, const T2
                     const T3 p3end) {
     static uint8_t pblank[1];
     uint256 hash1;
-    SHA256_CTX ctx;
-    SHA256_Init(&ctx);
-    SHA256_Update(&ctx, (p1begin == p1end ? pblank : (uint8_t *)&p1begin[0]),
-                  (p1end - p1begin) * sizeof(p1begin[0]));
-    SHA256_Update(&ctx, (p2begin == p2end ? pblank : (uint8_t *)&p2begin[0]),
-                  (p2end - p2begin) * sizeof(p2begin[0]));
-    SHA256_Update(&ctx, (p3begin == p3end ? pblank : (uint8_t *)&p3begin[0]),
-                  (p3end - p3begin) * sizeof(p3begin[0]));
-    SHA256_Final((uint8_t *)&hash1, &ctx);
+    CSHA256()
+        .Write((p1begin == p1end ? pblank : (uint8_t *)&p1begin[0]), (p1end - p1begin) * sizeof(p1begin[0]))
+        .Write((p2begin == p2end ? pblank : (uint8_t *)&p2begin[0]), (p2end - p2begin) * sizeof(p2begin[0]))
+        .Write((p3begin == p3end ? pblank : (uint8_t *)&p3begin[0]), (p3end - p3begin) * sizeof(p3begin[0]))
+        .Finalize((uint8_t *)&hash1);
     uint256 hash2;
-    SHA256((uint8_t *)&hash1, sizeof(hash1), (uint8_t *)&hash2);
+    CSHA256().Write((uint8_t *)&hash1, sizeof(hash1)).Finalize((uint8_t *)&hash2);
     return hash2;
 }
 
@@ -125,8 +122,9 @@ template <typename T1>
 inline uint160 Hash160(const T1 pbegin, const T1 pend) {
     static uint8_t pblank[1];
     uint256 hash1;
-    SHA256((pbegin == pend ? pblank : (uint8_t *)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]),
-           (uint8_t *)&hash1);
+    CSHA256()
+        .Write((pbegin == pend ? pblank : (uint8_t *)&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]))
+        .Finalize((uint8_t *)&hash1);
     uint160 hash2;
     RIPEMD160((uint8_t *)&hash1, sizeof(hash1), (uint8_t *)&hash2);
     return hash2;
@@ -634,6 +634,16 @@ std::string SHA256AutoDetect()
 #endif
 #endif
 
+    // Fall back to the generic implementation if an accelerated one does not hash correctly on this cpu
+    if (ret != "standard" && !SelfTest()) {
+        Transform = sha256::Transform;
+        TransformD64 = sha256::TransformD64;
+        TransformD64_2way = nullptr;
+        TransformD64_4way = nullptr;
+        TransformD64_8way = nullptr;
+        ret = "standard(" + ret + " failed self-test)";
+    }
+
     assert(SelfTest());
     return ret;
 }
@@ -102,6 +102,16 @@ private:
     friend class CRegIDKey;
 };
 
+class CSaltedRegIDHasher {
+public:
+    CSaltedRegIDHasher() : k0(GetHasherSalt().k0), k1(GetHasherSalt().k1) {}
+
+    size_t operator()(const CRegID &regid) const { return CSipHasher(k0, k1).Write(regid.GetIntValue()).Finalize(); }
+
+private:
+    uint64_t k0, k1;
+};
+
 class CRegIDKey {
 public:
     CRegID regid;
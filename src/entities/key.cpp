@@ -11,13 +11,98 @@
 #include "commons/base58.h"
 #include "commons/common.h"
 #include "commons/random.h"
+#include "commons/lrucache.hpp"
 #include "crypto/hash.h"
+#include "crypto/siphash.h"
 #include "lax_der_parsing.h"
 #include "lax_der_privatekey_parsing.h"
 
+#include <atomic>
+#include <mutex>
+
 static secp256k1_context *secp256k1_context_verify = nullptr;
 static secp256k1_context *secp256k1_context_sign   = nullptr;
 
+/**
+ * Parsed public keys for CPubKey::Verify(). Parsing a compressed key decompresses the point,
+ * which costs as much as a good part of the verification, and the same account and producer
+ * keys sign over and over. The keys are hashed with a random salt, peers choose them.
+ */
+class CPubKeyCacheHasher {
+public:
+    size_t operator()(const CPubKey &key) const {
+        const CHasherSalt &salt = GetHasherSalt();
+        return CSipHasher(salt.k0, salt.k1).Write(key.begin(), key.size()).Finalize();
+    }
+};
+
+class CPubKeyCache {
+private:
+    static const uint32_t SHARDS = 16;
+
+    struct Shard {
+        std::mutex mtx;
+        CLruCache<CPubKey, secp256k1_pubkey, CPubKeyCacheHasher> cache{DEFAULT_PUBKEY_CACHE_SIZE / SHARDS};
+    };
+
+public:
+    bool Parse(const CPubKey &key, secp256k1_pubkey &pubkey) {
+        if (nMaxSize == 0)
+            return secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, key.begin(), key.size());
+
+        Shard &shard = shards[CPubKeyCacheHasher()(key) % SHARDS];
+        {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            const secp256k1_pubkey *pCached = shard.cache.Get(key);
+            if (pCached != nullptr) {
+                pubkey = *pCached;
+                nHits++;
+                return true;
+            }
+        }
+
+        nMisses++;
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, key.begin(), key.size()))
+            return false;
+
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        shard.cache.Insert(key, pubkey);
+        return true;
+    }
+
+    void SetMaxSize(uint32_t nMaxSizeIn) {
+        nMaxSize = nMaxSizeIn;
+        for (auto &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            shard.cache.SetMaxSize((nMaxSizeIn + SHARDS - 1) / SHARDS);
+        }
+    }
+
+    CPubKeyCacheStats GetStats() {
+        CPubKeyCacheStats stats;
+        stats.capacity = nMaxSize;
+        stats.hits     = nHits;
+        stats.misses   = nMisses;
+        for (auto &shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            stats.count += shard.cache.GetSize();
+        }
+        return stats;
+    }
+
+private:
+    Shard shards[SHARDS];
+    std::atomic<uint32_t> nMaxSize{DEFAULT_PUBKEY_CACHE_SIZE};
+    std::atomic<uint64_t> nHits{0};
+    std::atomic<uint64_t> nMisses{0};
+};
+
+static CPubKeyCache pubKeyCache;
+
+void ECC_SetPubKeyCacheSize(uint32_t nMaxSize) { pubKeyCache.SetMaxSize(nMaxSize); }
+
+CPubKeyCacheStats ECC_GetPubKeyCacheStats() { return pubKeyCache.GetStats(); }
+
 // Check that the sig has a low R value and will be less than 71 bytes
 bool SigHasLowR(const secp256k1_ecdsa_signature *sig) {
     uint8_t compact_sig[64];
@@ -197,7 +282,7 @@ bool CPubKey::Verify(const uint256 &hash, const vector<uint8_t> &vchSig) const {
 
     secp256k1_pubkey pubkey;
     secp256k1_ecdsa_signature sig;
-    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, vch, size())) {
+    if (!pubKeyCache.Parse(*this, pubkey)) {
         return false;
     }
     if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
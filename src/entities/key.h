@@ -11,6 +11,7 @@
 #include "commons/uint256.h"
 #include "commons/util/util.h"
 #include "crypto/hash.h"
+#include "commons/hasher.h"
 
 #include <secp256k1.h>
 #include <secp256k1_recovery.h>
@@ -36,6 +37,8 @@ public:
     string ToAddress() const;
 };
 
+typedef CSaltedUint160Hasher CSaltedKeyIDHasher;
+
 /** An encapsulated public key. */
 class CPubKey {
 public:
@@ -209,6 +212,12 @@ public:
     // Recover a public key from a compact signature.
     bool RecoverCompact(const uint256 &hash, const vector<uint8_t> &vchSig);
 
+    // Whether vchSig has the layout of a compact signature of a compressed key, a DER
+    // signature starts with 0x30 and can not be mistaken for one.
+    static bool IsCompactSignature(const vector<uint8_t> &vchSig) {
+        return vchSig.size() == COMPACT_SIGNATURE_SIZE && vchSig[0] >= 31 && vchSig[0] <= 34;
+    }
+
     // Turn this public key into an uncompressed public key.
     bool Decompress();
 
@@ -429,6 +438,20 @@ public:
     ~ECCVerifyHandle();
 };
 
+/** Default max number of parsed public keys cached by CPubKey::Verify(), -pubkeycachesize */
+static const uint32_t DEFAULT_PUBKEY_CACHE_SIZE = 100000;
+
+struct CPubKeyCacheStats {
+    uint64_t count    = 0;
+    uint64_t capacity = 0;
+    uint64_t hits     = 0;
+    uint64_t misses   = 0;
+};
+
+/** Resize the cache of parsed public keys used by CPubKey::Verify(), 0 disables it */
+void ECC_SetPubKeyCacheSize(uint32_t nMaxSize);
+CPubKeyCacheStats ECC_GetPubKeyCacheStats();
+
 /** Initialize the elliptic curve support. May not be called twice without calling ECC_Stop first.
  */
 void ECC_Start();
@@ -11,6 +11,7 @@
 #include "logging.h"
 #include "init.h"
 #include "config/configuration.h"
+#include "crypto/sha256.h"
 #include "p2p/addrman.h"
 
 #include "rpc/core/rpcserver.h"
@@ -21,6 +22,8 @@
 #include "miner/miner.h"
 #include "net.h"
 #include "p2p/node.h"
+#include "p2p/txadmission.h"
+#include "sigverify.h"
 #include "persistence/blockdb.h"
 #include "persistence/accountdb.h"
 #include "persistence/txdb.h"
@@ -242,7 +245,10 @@ string HelpMessage() {
     strUsage += "  -listen                " + _("Accept connections from outside (default: 1 if no -proxy or -connect)") + "\n";
     strUsage += "  -maxconnections=<n>    " + _("Maintain at most <n> connections to peers (default: 125)") + "\n";
     strUsage += "  -maxreceivebuffer=<n>  " + _("Maximum per-connection receive buffer, <n>*1000 bytes (default: 5000)") + "\n";
-    strUsage += "  -maxsendbuffer=<n>     " + _("Maximum per-connection send buffer, <n>*1000 bytes (default: 1000)") + "\n";
+    strUsage += "  -maxsendbuffer=<n>     " + _("Maximum per-connection send buffer of the blocks, <n>*1000 bytes, the txs get half of it and the addresses a tenth (default: 1000)") + "\n";
+    strUsage += "  -maxrelaycache=<n>     " + _("Keep at most <n> MB of the txs relayed in the last 15 minutes for the peers asking for them (default: 32)") + "\n";
+    strUsage += "  -txreconciliation      " + _("Announce the txs by set reconciliation to the peers supporting it, in full invs to a few outbound peers only (default: 1)") + "\n";
+    strUsage += "  -maxuploadrate=<n>     " + _("Cap the upload to all the peers at <n> KB/s, consensus messages are not held back, 0 for no cap (default: 0)") + "\n";
     strUsage += "  -onion=<ip:port>       " + _("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: -proxy)") + "\n";
     strUsage += "  -onlynet=<net>         " + _("Only connect to nodes in network <net> (IPv4, IPv6 or Tor)") + "\n";
     strUsage += "  -port=<port>           " + _("Listen for connections on <port> (default: 8333 or testnet: 18333)") + "\n";
@@ -250,7 +256,11 @@ string HelpMessage() {
     strUsage += "  -ipserver=<server>     " + _("IP Reporting Service") + "\n";
     strUsage += "  -seednode=<ip>         " + _("Connect to a node to retrieve peer addresses, and disconnect") + "\n";
     strUsage += "  -socks=<n>             " + _("Select SOCKS version for -proxy (4 or 5, default: 5)") + "\n";
+    strUsage += "  -socketevents=<mode>   " + strprintf(_("Socket readiness notification, epoll (Linux) or select (default: %s)"), DEFAULT_SOCKET_EVENTS) + "\n";
     strUsage += "  -timeout=<n>           " + _("Specify connection timeout in milliseconds (default: 5000)") + "\n";
+    strUsage += "  -msghandlerthreads=<n> " + strprintf(_("Number of threads processing the messages of peers, each peer is served by one of them (default: %d, max: %d)"), DEFAULT_MESSAGE_HANDLER_THREADS, MAX_MESSAGE_HANDLER_THREADS) + "\n";
+    strUsage += "  -txadmission           " + _("Admit txs received from peers in batches, with their signatures pre-verified in parallel (default: 1)") + "\n";
+    strUsage += "  -sigverifythreads=<n>  " + strprintf(_("Number of signature verification threads (0 = verify on the calling thread, default: cores - 1, max: %d)"), MAX_SIG_VERIFY_THREADS) + "\n";
 #ifdef USE_UPNP
 #if USE_UPNP
     strUsage += "  -upnp                  " + _("Use UPnP to map the listening port (default: 1 when listening)") + "\n";
@@ -292,7 +302,8 @@ string HelpMessage() {
     strUsage += "  -logtimestamps         " + _("Prepend debug output with timestamp (default: 1)") + "\n";
     if (SysCfg().GetBoolArg("-help-debug", false)) {
         strUsage += "  -limitfreerelay=<n>    " + _("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:15)") + "\n";
-        strUsage += "  -maxsigcachesize=<n>   " + _("Limit size of signature cache to <n> entries (default: 50000)") + "\n";
+        strUsage += "  -maxsigcachesize=<n>   " + strprintf(_("Limit size of signature cache to <n> MB (was a number of entries before), 0 to disable (default: %d, maximum: %d)"), DEFAULT_MAX_SIG_CACHE_SIZE, MAX_MAX_SIG_CACHE_SIZE) + "\n";
+        strUsage += "  -pubkeycachesize=<n>   " + strprintf(_("Number of parsed public keys kept for signature verification, 0 to disable (default: %u)"), DEFAULT_PUBKEY_CACHE_SIZE) + "\n";
     }
     strUsage += "  -logprinttoconsole     " + _("Send trace/debug info to console instead of debug.log file") + "\n";
     if (SysCfg().GetBoolArg("-help-debug", false)) {
@@ -309,6 +320,7 @@ string HelpMessage() {
 
     strUsage += "\n" + _("Block creation options:") + "\n";
     strUsage += "  -blockmaxsize=<n>      " + strprintf(_("Set maximum block size in bytes (default: %d)"), DEFAULT_BLOCK_MAX_SIZE) + "\n";
+    strUsage += "  -blocktemplate         " + strprintf(_("Keep the next block template packed between the producer slots (default: %u)"), DEFAULT_BLOCK_TEMPLATE) + "\n";
 
     strUsage += "\n" + _("RPC server options:") + "\n";
     strUsage += "  -rpcserver             " + _("Accept command line and JSON-RPC commands") + "\n";
@@ -474,6 +486,8 @@ bool AppInit(boost::thread_group &threadGroup) {
     if (!ECC_InitSanityCheck())
         return fprintf(stderr, "Elliptic curve cryptography sanity check failure. Aborting.");
 
+    LogPrint(BCLog::INFO, "Using the '%s' SHA256 implementation\n", SHA256AutoDetect());
+
     //register wasm routes for native inline_transaction dispatch
     wasm_load_native_modules_and_register_routes();
 
@@ -530,10 +544,17 @@ bool AppInit(boost::thread_group &threadGroup) {
     SysCfg().SetGenBlock(SysCfg().GetBoolArg("-genblock", false));
     SysCfg().SetForcedConfirmBlock(SysCfg().GetBoolArg("-forcedconfirmblock", false));
 
-    // Make sure enough file descriptors are available
+    string strSocketEvents = SysCfg().GetArg("-socketevents", DEFAULT_SOCKET_EVENTS);
+    if (!socketEvents.Init(strSocketEvents))
+        return InitError(strprintf(_("Unsupported -socketevents mode: %s"), strSocketEvents));
+
+    // Make sure enough file descriptors are available, select() can not watch descriptors
+    // beyond FD_SETSIZE while epoll is only bound by the descriptor limit
     int32_t nBind   = max((int32_t)SysCfg().IsArgCount("-bind"), 1);
     nMaxConnections = SysCfg().GetArg("-maxconnections", 125);
-    nMaxConnections = max(min(nMaxConnections, (int32_t)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS)), 0);
+    if (!socketEvents.IsEpoll())
+        nMaxConnections = min(nMaxConnections, (int32_t)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS));
+    nMaxConnections = max(nMaxConnections, 0);
     int32_t nFD     = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -544,6 +565,18 @@ bool AppInit(boost::thread_group &threadGroup) {
     SysCfg().SetBenchMark(SysCfg().GetBoolArg("-benchmark", false));
     mempool.SetSanityCheck(SysCfg().GetBoolArg("-checkmempool", RegTest()));
 
+    int64_t nSigCacheSize = std::max<int64_t>(SysCfg().GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE), 0);
+    if (nSigCacheSize > MAX_MAX_SIG_CACHE_SIZE) {
+        LogPrint(BCLog::INFO, "Warning: -maxsigcachesize=%d exceeds %d, the size is in MB now, not in entries\n",
+                 nSigCacheSize, MAX_MAX_SIG_CACHE_SIZE);
+        nSigCacheSize = MAX_MAX_SIG_CACHE_SIZE;
+    }
+    signatureCache.Setup(nSigCacheSize << 20);
+    LogPrint(BCLog::INFO, "Using %d MB for the signature cache, %u entries\n", nSigCacheSize,
+             signatureCache.GetStats().capacity);
+    ECC_SetPubKeyCacheSize(std::max<int64_t>(SysCfg().GetArg("-pubkeycachesize", DEFAULT_PUBKEY_CACHE_SIZE), 0));
+    StartSigVerifyPool(threadGroup);
+
     setvbuf(stdout, nullptr, _IOLBF, 0);
 
     string strDataDir = GetDataDir().string();
@@ -580,7 +613,8 @@ bool AppInit(boost::thread_group &threadGroup) {
     LogPrint(BCLog::INFO, "Startup time: %s\n", DateTimeStrFormat("%Y-%m-%d %H:%M:%S", GetTime()));
     LogPrint(BCLog::INFO, "Default data directory %s\n", GetDefaultDataDir().string());
     LogPrint(BCLog::INFO, "Using data directory %s\n", strDataDir);
-    LogPrint(BCLog::INFO, "Using at most %i connections (%i file descriptors available)\n", nMaxConnections, nFD);
+    LogPrint(BCLog::INFO, "Using at most %i connections (%i file descriptors available, %s socket events)\n",
+             nMaxConnections, nFD, strSocketEvents);
 
     RegisterNodeSignals(GetNodeSignals());
 
@@ -794,7 +828,7 @@ bool AppInit(boost::thread_group &threadGroup) {
     if (SysCfg().IsArgCount("-printblock")) {
         string strMatch = SysCfg().GetArg("-printblock", "");
         int32_t nFound  = 0;
-        for (map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
+        for (BlockMap::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
             uint256 hash = (*mi).first;
             if (strncmp(hash.ToString().c_str(), strMatch.c_str(), strMatch.size()) == 0) {
                 CBlockIndex *pIndex = (*mi).second;
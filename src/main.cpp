@@ -28,6 +28,7 @@
 #include "chain/blockdelegates.h"
 #include "persistence/blockundo.h"
 #include "tx/txserializer.h"
+#include "sigverify.h"
 
 #include <sstream>
 #include <algorithm>
@@ -50,7 +51,7 @@ using namespace boost;
 CCacheDBManager *pCdMan = nullptr;
 CCriticalSection cs_main;
 CTxMemPool mempool;
-map<uint256, CBlockIndex *> mapBlockIndex;
+BlockMap mapBlockIndex;
 int32_t nSyncTipHeight = 0;
 string publicIp;
 map<uint256/* blockhash */, std::shared_ptr<CCacheWrapper>> mapForkCache;
@@ -219,6 +220,10 @@ bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signatu
         return false;
     }
 
+    // a compact signature is never a valid DER one, and the cache may hold it with its recovered signer
+    if (CPubKey::IsCompactSignature(signature))
+        return false;
+
     if (signatureCache.Get(sigHash, signature, pubKey))
         return true;
 
@@ -232,10 +237,38 @@ bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signatu
     return true;
 }
 
-bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
+bool RecoverSignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, CPubKey &pubKey) {
+    if (!CPubKey::IsCompactSignature(signature))
+        return false;
+
+    {
+        auto bm = MAKE_BENCHMARK("execute pubkey recover");
+        if (!pubKey.RecoverCompact(sigHash, signature) || !pubKey.IsValid())
+            return false;
+    }
+
+    signatureCache.Set(sigHash, signature, pubKey);
+    return true;
+}
+
+bool VerifyCompactSignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey) {
+    if (!CPubKey::IsCompactSignature(signature))
+        return false;
+
+    // hit when the signer was recovered by the pre-verification
+    if (signatureCache.Get(sigHash, signature, pubKey))
+        return true;
+
+    CPubKey recoveredKey;
+    return RecoverSignature(sigHash, signature, recoveredKey) && recoveredKey.GetKeyId() == pubKey.GetKeyId();
+}
+
+bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, const std::shared_ptr<CBaseTx> &spBaseTx,
                         bool fLimitFree, bool fRejectInsaneFee) {
     AssertLockHeld(cs_main);
 
+    CBaseTx *pBaseTx = spBaseTx.get();
+
     auto bm = MAKE_BENCHMARK("AcceptToMemoryPool");
     // is it already in the memory pool?
     uint256 hash = pBaseTx->GetHash();
@@ -271,7 +304,7 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
             return ERRORMSG("AcceptToMemoryPool() : CheckBaseTx/CheckTx failed, txid: %s", hash.GetHex());
     }
 
-    CTxMemPoolEntry entry(pBaseTx, GetTime(), newHeight);
+    CTxMemPoolEntry entry(spBaseTx, GetTime(), newHeight);
     auto nFees = std::get<1>(entry.GetFees());
     auto nSize = entry.GetTxSize();
     // Continuously rate-limit free trx
@@ -300,7 +333,7 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
     if (fRejectInsaneFee && nFees > SysCfg().GetMaxFee())
         return ERRORMSG("AcceptToMemoryPool() : txid: %s pay insane fees, %d > %d", hash.GetHex(), nFees, SysCfg().GetMaxFee());
 
-    return pool.AddUnchecked(hash, entry, state);
+    return pool.AddUnchecked(hash, *pBaseTx, entry, state);
 }
 
 int32_t GetTxConfirmHeight(const uint256 &hash, CBlockDBCache &blockCache) {
@@ -323,14 +356,14 @@ int32_t GetTxConfirmHeight(const uint256 &hash, CBlockDBCache &blockCache) {
 }
 
 // Return transaction in tx, and if it was found inside a block, its hash is placed in blockHash
-bool GetTransaction(std::shared_ptr<CBaseTx> &pBaseTx, const uint256 &hash, CBlockDBCache &blockCache,
+bool GetTransaction(std::shared_ptr<const CBaseTx> &pBaseTx, const uint256 &hash, CBlockDBCache &blockCache,
                     bool bSearchMemPool) {
     {
         LOCK(cs_main);
         {
             if (bSearchMemPool == true) {
                 pBaseTx = mempool.Lookup(hash);
-                if (pBaseTx.get())
+                if (pBaseTx)
                     return true;
             }
         }
@@ -340,13 +373,15 @@ bool GetTransaction(std::shared_ptr<CBaseTx> &pBaseTx, const uint256 &hash, CBlo
             if (blockCache.ReadTxIndex(hash, diskTxPos)) {
                 CAutoFile file(OpenBlockFile(diskTxPos, true), SER_DISK, CLIENT_VERSION);
                 CBlockHeader header;
+                std::shared_ptr<CBaseTx> spDiskTx;
                 try {
                     file >> header;
                     fseek(file, diskTxPos.nTxOffset, SEEK_CUR);
-                    file >> pBaseTx;
+                    file >> spDiskTx;
                 } catch (std::exception &e) {
                     return ERRORMSG("Deserialize or I/O error - %s", e.what());
                 }
+                pBaseTx = spDiskTx;
                 return true;
             }
         }
@@ -593,7 +628,7 @@ bool ReconsiderBlock(CValidationState &state, CBlockIndex *pIndex, bool children
     AssertLockHeld(cs_main);
 
     // Remove the invalidity flag from this block and all its descendants.
-    map<uint256, CBlockIndex *>::const_iterator it = mapBlockIndex.begin();
+    BlockMap::const_iterator it = mapBlockIndex.begin();
     int32_t height                                    = pIndex->height;
     if (children) {
         while (it != mapBlockIndex.end()) {
@@ -984,6 +1019,48 @@ static bool ComputeVoteStakingInterestAndRevokeVotes(const uint256& blockHash, c
     return true;
 }
 
+/**
+ * Verify the signatures of the block txs on the signature verification pool before they are executed one by one.
+ * The signers are resolved against the state before the block, a tx whose signer only shows up within the block is
+ * left to its execution. The results are not used, the valid signatures land in the signature cache and the serial
+ * execution finds them there.
+ */
+static void PreVerifyBlockSignatures(const CBlock &block, CCacheWrapper &cw) {
+    if (GetFeatureForkVersion(block.GetHeight()) < MAJOR_VER_R2 || sigVerifyPool.GetThreads() == 0)
+        return;
+
+    auto bm = MAKE_BENCHMARK("pre-verify block signatures");
+    bool fRecover = GetFeatureForkVersion(block.GetHeight()) >= MAJOR_VER_R4;
+    vector<CSigCheck> checks;
+    checks.reserve(block.vptx.size());
+    for (size_t index = 1; index < block.vptx.size(); ++index) {
+        const auto &pBaseTx = block.vptx[index];
+        if (pBaseTx->signature.empty())
+            continue;
+
+        // the signer of a compact signature is recovered without reading its account
+        if (fRecover && CPubKey::IsCompactSignature(pBaseTx->signature)) {
+            checks.emplace_back(pBaseTx->GetHash(), pBaseTx->signature);
+            continue;
+        }
+
+        CPubKey pubKey;
+        if (pBaseTx->txUid.is<CPubKey>()) {
+            pubKey = pBaseTx->txUid.get<CPubKey>();
+        } else if (pBaseTx->txUid.is<CRegID>()) {
+            CAccount account;
+            if (cw.accountCache.GetAccount(pBaseTx->txUid, account))
+                pubKey = account.owner_pubkey;
+        }
+
+        if (pubKey.IsValid())
+            checks.emplace_back(pBaseTx->GetHash(), pBaseTx->signature, pubKey);
+    }
+
+    vector<bool> results;
+    sigVerifyPool.VerifyEach(checks, results);
+}
+
 bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck) {
     AssertLockHeld(cs_main);
 
@@ -1051,6 +1128,8 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     const auto &bpRegid = GetBlockBpRegid(block);
 
     if (block.vptx.size() > 1) {
+        PreVerifyBlockSignatures(block, cw);
+
         assert(mapBlockIndex.count(cw.blockCache.GetBestBlockHash()));
         int32_t curHeight     = mapBlockIndex[cw.blockCache.GetBestBlockHash()]->height;
         int32_t validHeight   = SysCfg().GetTxCacheHeight();
@@ -1378,10 +1457,10 @@ bool DisconnectTip(CValidationState &state) {
     UpdateTip(pNewTipIndex, block);
     // Resurrect mempool transactions from the disconnected block.
     for (const auto &pTx : block.vptx) {
-        list<std::shared_ptr<CBaseTx> > removed;
+        list<std::shared_ptr<const CBaseTx> > removed;
         CValidationState stateDummy;
         if (!pTx->IsRelayForbidden()) {
-            if (!AcceptToMemoryPool(mempool, stateDummy, pTx.get(), false)) {
+            if (!AcceptToMemoryPool(mempool, stateDummy, pTx, false)) {
                 mempool.Remove(pTx.get(), removed, true);
             }
         } else {
@@ -1429,9 +1508,7 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
     // Update chainActive & related variables.
     UpdateTip(pIndexNew, block);
 
-    for (auto &pTxItem : block.vptx) {
-        mempool.memPoolTxs.erase(pTxItem->GetHash());
-    }
+    mempool.RemoveForBlock(block.vptx);
     return true;
 }
 
@@ -1606,10 +1683,10 @@ bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos
         LOCK(cs_nBlockSequenceId);
         pIndexNew->nSequenceId = nBlockSequenceId++;
     }
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
+    BlockMap::iterator mi = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
     // LogPrint(BCLog::INFO, "in map hash:%s map size:%d\n", hash.GetHex(), mapBlockIndex.size());
     pIndexNew->pBlockHash                        = &((*mi).first);
-    map<uint256, CBlockIndex *>::iterator miPrev = mapBlockIndex.find(block.GetPrevBlockHash());
+    BlockMap::iterator miPrev = mapBlockIndex.find(block.GetPrevBlockHash());
     if (miPrev != mapBlockIndex.end()) {
         pIndexNew->pprev  = (*miPrev).second;
         pIndexNew->height = pIndexNew->pprev->height + 1;
@@ -1905,7 +1982,7 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
     CBlockIndex *pPrevBlockIndex = nullptr;
     int32_t height = 0;
     if (block.GetHeight() != 0 || blockHash != SysCfg().GetGenesisBlockHash()) {
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(block.GetPrevBlockHash());
+        BlockMap::iterator mi = mapBlockIndex.find(block.GetPrevBlockHash());
         if (mi == mapBlockIndex.end())
             return state.DoS(10, ERRORMSG("[%d] prev block not found", blockHeight), 0, "bad-prevblk");
 
@@ -1965,11 +2042,24 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp, boo
     CBlockIndex* pTip = chainActive.Tip();
     if (pTip->GetBlockHash() == blockHash) {
         {
+            // a produced block goes to every peer, frame it once for all of them, as a
+            // compact block to the peers taking it
+            CSharedNetMessage spBlockMessage, spCompactBlockMessage;
+
             LOCK(cs_vNodes);
             for (auto pNode : vNodes) {
                 //p2p_xiaoyu_20191116
                 if (mining) {
-                    pNode->PushMessage(NetMsgType::BLOCK, block);
+                    if (pNode->fCompactBlocks) {
+                        if (!spCompactBlockMessage)
+                            spCompactBlockMessage = MakeSharedNetMessage(NetMsgType::CMPCTBLOCK,
+                                CCompactBlock(block, GetRand(std::numeric_limits<uint64_t>::max())));
+                        pNode->PushSharedMessage(spCompactBlockMessage);
+                    } else {
+                        if (!spBlockMessage)
+                            spBlockMessage = MakeSharedNetMessage(NetMsgType::BLOCK, block);
+                        pNode->PushSharedMessage(spBlockMessage);
+                    }
                     continue;
                 }
                 if (chainActive.Height() > (pNode->nStartingHeight != -1 ? pNode->nStartingHeight - 2000 : 0))
@@ -2440,7 +2530,7 @@ void PrintBlockTree() {
     AssertLockHeld(cs_main);
     // pre-compute tree structure
     map<CBlockIndex *, vector<CBlockIndex *> > mapNext;
-    for (map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
+    for (BlockMap::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
         CBlockIndex *pIndex = (*mi).second;
         mapNext[pIndex->pprev].push_back(pIndex);
     }
@@ -2621,7 +2711,7 @@ class CMainCleanup {
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        map<uint256, CBlockIndex *>::iterator it1 = mapBlockIndex.begin();
+        BlockMap::iterator it1 = mapBlockIndex.begin();
         for (; it1 != mapBlockIndex.end(); it1++)
             delete (*it1).second;
         mapBlockIndex.clear();
@@ -43,7 +43,7 @@ extern CChainActive chainActive;
 extern CSignatureCache signatureCache;
 
 extern CTxMemPool mempool;
-extern map<uint256, CBlockIndex *> mapBlockIndex;
+extern BlockMap mapBlockIndex;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
 extern const string strMessageMagic;
@@ -86,7 +86,7 @@ void ThreadScriptCheck();
 /** Format a string that describes several potential problems detected by the core */
 string GetWarnings(string strFor);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
-bool GetTransaction(std::shared_ptr<CBaseTx> &pBaseTx, const uint256 &hash, CBlockDBCache &blockCache, bool bSearchMempool = true);
+bool GetTransaction(std::shared_ptr<const CBaseTx> &pBaseTx, const uint256 &hash, CBlockDBCache &blockCache, bool bSearchMempool = true);
 /** Retrieve a transaction height comfirmed in block*/
 int32_t GetTxConfirmHeight(const uint256 &hash, CBlockDBCache &blockCache);
 
@@ -98,9 +98,13 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 void Misbehaving(NodeId nodeid, int32_t howmuch);
 
 bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey);
+/** Recover the signer of a compact signature, the recovered key is added to the signature cache */
+bool RecoverSignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, CPubKey &pubKey);
+/** Check a compact signature by comparing the key id of the recovered signer with the one of pubKey */
+bool VerifyCompactSignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey);
 
 /** (try to) add transaction to memory pool **/
-bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
+bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, const std::shared_ptr<CBaseTx> &spBaseTx,
                         bool fLimitFree, bool fRejectInsaneFee = false);
 
 struct CNodeStateStats {
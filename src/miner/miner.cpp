@@ -86,24 +86,37 @@ uint32_t GetElementForBurn(CBlockIndex *pIndex) {
 }
 
 // Sort transactions by priority and fee to decide priority orders to process transactions.
+// The fee per kb of a tx is counted together with its unconfirmed ancestors of the same sender, so that
+// a low fee tx is not left behind the higher fee txs depending on it.
 void GetPriorityTx(CCacheWrapper &cw, int32_t height, set<TxPriority> &txPriorities, const int32_t nFuelRate) {
-    static TokenSymbol feeSymbol;
-    static uint64_t fee    = 0;
-    static uint32_t txSize = 0;
-    static double feePerKb = 0;
-    static double priority = 0;
-
-    for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.memPoolTxs.begin(); mi != mempool.memPoolTxs.end(); ++mi) {
-        CBaseTx *pBaseTx = mi->second.GetTransaction().get();
-        if (!pBaseTx->IsBlockRewardTx() && !pCdMan->pTxCache->HasTx(pBaseTx->GetHash())) {
-            feeSymbol = std::get<0>(mi->second.GetFees());
-            fee       = std::get<1>(mi->second.GetFees());
-            txSize    = mi->second.GetTxSize();
-            feePerKb  = double(fee - pBaseTx->GetFuelFee(cw, height, nFuelRate)) / txSize * 1000.0;
-            priority  = mi->second.GetPriority();
-
-            txPriorities.emplace(TxPriority(priority, feePerKb, mi->second.GetTransaction()));
-        }
+    auto AddTxPriority = [&](const CTxMemPoolEntry &entry, double &packageFee, uint64_t &packageSize) {
+        const CBaseTx *pBaseTx = entry.GetTransaction().get();
+        if (pBaseTx->IsBlockRewardTx() || pCdMan->pTxCache->HasTx(entry.GetHash()))
+            return;
+
+        uint64_t fee = std::get<1>(entry.GetFees());
+        packageFee += double(fee - pBaseTx->GetFuelFee(cw, height, nFuelRate));
+        packageSize += entry.GetTxSize();
+        double feePerKb = packageFee / packageSize * 1000.0;
+
+        txPriorities.emplace(TxPriority(entry.GetPriority(), feePerKb, entry.GetTransaction()));
+    };
+
+    for (const auto &item : mempool.senderTxs) {
+        double packageFee    = 0;
+        uint64_t packageSize = 0;
+        for (const auto &seqTx : item.second)
+            AddTxPriority(mempool.memPoolTxs.at(seqTx.second), packageFee, packageSize);
+    }
+
+    // txs whose sender is unknown to the mempool view
+    for (const auto &item : mempool.memPoolTxs) {
+        if (!item.second.GetSenderKeyId().IsNull())
+            continue;
+
+        double packageFee    = 0;
+        uint64_t packageSize = 0;
+        AddTxPriority(item.second, packageFee, packageSize);
     }
 }
 
@@ -321,7 +334,9 @@ static bool CreateNewBlockForPreStableCoinRelease(Miner &miner, CCacheWrapper &c
 
         // Collect transactions into the block.
         for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
-            CBaseTx *pBaseTx = itor->baseTx.get();
+            // the mempool tx is shared and executed by the mempool only, a copy of it is executed
+            std::shared_ptr<CBaseTx> spBaseTx = itor->baseTx->GetNewInstance();
+            CBaseTx *pBaseTx = spBaseTx.get();
 
             uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
             if (totalBlockSize + txSize >= nBlockMaxSize) {
@@ -375,7 +390,7 @@ static bool CreateNewBlockForPreStableCoinRelease(Miner &miner, CCacheWrapper &c
 
             ++index;
 
-            pBlock->vptx.push_back(itor->baseTx);
+            pBlock->vptx.push_back(spBaseTx);
 
             LogPrint(BCLog::DEBUG, "miner's total fuel fee:%d, tx fuel fee:%d, fuel:%d, fuelRate:%d, txid:%s\n",
                     totalFuelFee, fuelFee, pBaseTx->fuel, fuelRate, pBaseTx->GetHash().GetHex());
@@ -422,145 +437,419 @@ static bool CreateStableCoinGenesisBlock(std::unique_ptr<CBlock> &pBlock) {
     return true;
 }
 
-static bool CreateNewBlockForStableCoinRelease(int64_t startMiningMs, Miner &miner, CCacheWrapper &cwIn, std::unique_ptr<CBlock> &pBlock) {
-    pBlock->vptx.push_back(std::make_shared<CUCoinBlockRewardTx>());
+static CBlockTemplate blockTemplate;
+static CCriticalSection cs_blockTemplate;
+
+// Txs whose execution reads the block time, they bind the template to the block time they were packed with
+static bool IsBlockTimeTx(const CBaseTx &tx) {
+    switch (tx.nTxType) {
+        case DELEGATE_VOTE_TX:
+        case LCONTRACT_INVOKE_TX:
+        case UCONTRACT_INVOKE_TX:
+        case UNIVERSAL_TX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static boost::mutex mtxBlockTemplate;
+static boost::condition_variable condBlockTemplate;
+static bool fBlockTemplateWake = false;
+
+void WakeBlockTemplate() {
+    {
+        boost::unique_lock<boost::mutex> lock(mtxBlockTemplate);
+        fBlockTemplateWake = true;
+    }
+    condBlockTemplate.notify_one();
+}
+
+static void WaitBlockTemplate(int64_t timeoutMs) {
+    boost::unique_lock<boost::mutex> lock(mtxBlockTemplate);
+    if (!fBlockTemplateWake)
+        condBlockTemplate.timed_wait(lock, boost::posix_time::milliseconds(timeoutMs));
+    fBlockTemplateWake = false;
+}
+
+// Publish the slot the miner thread waits for to the block template updater
+static void SetBlockTemplateSlot(const CBlockIndex *pPrevIndex, int64_t slotTime) {
+    bool fNewSlot;
+    {
+        LOCK(cs_blockTemplate);
+        fNewSlot = blockTemplate.SetSlot(pPrevIndex, slotTime);
+    }
+    if (fNewSlot)
+        WakeBlockTemplate();
+}
+
+void CBlockTemplate::SetNull() {
+    pIndexPrev = nullptr;
+    prevBlockHash.SetNull();
+    height           = 0;
+    templateSlotTime = 0;
+    blockTime        = 0;
+    prevBlockTime    = 0;
+    minerRegid.Clear();
+    fuelRate      = 0;
+    blockMaxSize  = 0;
+    spCW          = nullptr;
+    vptx.clear();
+    txids.clear();
+    pendingTxs.clear();
+    mempoolSequence = 0;
+    spPriceMedianTx = nullptr;
+    spForceSettleTx = nullptr;
+    fMedianPacked   = false;
+    failedFeedTxids.clear();
+    failedTxids.clear();
+    failedTxidsByKeyId.clear();
+    totalBlockSize = 0;
+    totalFuel      = 0;
+    totalFees      = 0;
+    totalFuelFee   = 0;
+    rewards.clear();
+    fBlockTimeUsed = false;
+}
+
+bool CBlockTemplate::IsMatch(const CBlockIndex *pIndexPrev, int64_t slotTimeIn, const CRegID &minerRegidIn) const {
+    return !IsNull() && prevBlockHash == pIndexPrev->GetBlockHash() && templateSlotTime == slotTimeIn &&
+           minerRegid == minerRegidIn;
+}
+
+bool CBlockTemplate::SetBlockTime(uint32_t blockTimeIn) {
+    if (fBlockTimeUsed && blockTime != blockTimeIn)
+        return false;
+
+    blockTime = blockTimeIn;
+    return true;
+}
+
+bool CBlockTemplate::SetSlot(const CBlockIndex *pIndexPrev, int64_t slotTimeIn) {
+    if (slotPrevBlockHash == pIndexPrev->GetBlockHash() && slotTime == slotTimeIn)
+        return false;
+
+    slotPrevBlockHash = pIndexPrev->GetBlockHash();
+    slotHeight        = pIndexPrev->height + 1;
+    slotTime          = slotTimeIn;
+    fSlotChecked      = false;
+    fOnDuty           = false;
+    slotMinerRegid.Clear();
+    return true;
+}
+
+bool CBlockTemplate::Reset(CBlockIndex *pIndexPrevIn, int64_t slotTimeIn, uint32_t blockTimeIn,
+                           const CRegID &minerRegidIn) {
+    CRegID regid = minerRegidIn;  // it may be minerRegid itself, which SetNull() clears
+    SetNull();
+
+    pIndexPrev    = pIndexPrevIn;
+    prevBlockHash = pIndexPrev->GetBlockHash();
+    height           = pIndexPrev->height + 1;
+    templateSlotTime = slotTimeIn;
+    blockTime        = blockTimeIn;
+    prevBlockTime    = pIndexPrev->GetBlockTime();
+    minerRegid       = regid;
+    fuelRate         = GetElementForBurn(pIndexPrev);
+    spCW             = std::make_shared<CCacheWrapper>(pCdMan);
+    rewards          = { {SYMB::WICC, 0}, {SYMB::WUSD, 0} };
 
     // Largest block you're willing to create:
-    uint32_t nBlockMaxSize = SysCfg().GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
+    blockMaxSize = SysCfg().GetArg("-blockmaxsize", DEFAULT_BLOCK_MAX_SIZE);
     // Limit to between 1K and MAX_BLOCK_SIZE-1K for sanity:
-    nBlockMaxSize = std::max<uint32_t>(1000, std::min<uint32_t>((MAX_BLOCK_SIZE - 1000), nBlockMaxSize));
+    blockMaxSize = std::max<uint32_t>(1000, std::min<uint32_t>((MAX_BLOCK_SIZE - 1000), blockMaxSize));
 
-    // Collect memory pool transactions into the block
-    {
-        LOCK2(cs_main, mempool.cs);
+    CBlock block;
+    block.vptx.push_back(std::make_shared<CUCoinBlockRewardTx>());
+    totalBlockSize = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
 
-        CBlockIndex *pIndexPrev            = chainActive.Tip();
-        uint32_t blockTime                 = pBlock->GetTime();
-        int32_t height                     = pIndexPrev->height + 1;
-        int32_t index                      = 0; // 0: block reward tx
-        uint32_t fuelRate                  = GetElementForBurn(pIndexPrev);
-        uint64_t totalBlockSize            = ::GetSerializeSize(*pBlock, SER_NETWORK, PROTOCOL_VERSION);
-        uint64_t totalFuel              = 0;
-        uint64_t totalFees                 = 0;
-        uint64_t totalFuelFee              = 0;
-        map<TokenSymbol, uint64_t> rewards = { {SYMB::WICC, 0}, {SYMB::WUSD, 0} };
+    // The median prices are calculated when the tx is packed, after the price feed txs of the block.
+    spPriceMedianTx = std::make_shared<CBlockPriceMedianTx>(height);
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(cwIn, height, txPriorities, fuelRate);
+    if (GetFeatureForkVersion(height) >= MAJOR_VER_R3) {
+        auto spCdpForceSettleInterestTx = std::make_shared<CCDPInterestForceSettleTx>(height);
+        if (!GetSettledInterestCdps(*spCW, height, spCdpForceSettleInterestTx->cdp_list))
+            return ERRORMSG("GetSettledInterestCdps error");
 
-        // Push block price median transaction into queue.
-        txPriorities.emplace(TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height)));
+        if (!spCdpForceSettleInterestTx->cdp_list.empty()) {
+            LogPrint(BCLog::MINER, "create CCDPInterestForceSettleTx to block! tx=%s\n",
+                    spCdpForceSettleInterestTx->ToString(spCW->accountCache));
 
-        if (GetFeatureForkVersion(height) >= MAJOR_VER_R3) {
-            auto spCdpForceSettleInterestTx = std::make_shared<CCDPInterestForceSettleTx>(height);
-            if (!GetSettledInterestCdps(cwIn, height, spCdpForceSettleInterestTx->cdp_list)) {
-                return ERRORMSG("GetSettledInterestCdps error");
-            }
-            if (!spCdpForceSettleInterestTx->cdp_list.empty()) {
-                txPriorities.emplace(TxPriority(TRANSACTION_PRIORITY_CEILING, 0, spCdpForceSettleInterestTx));
+            spForceSettleTx = spCdpForceSettleInterestTx;
+        }
+    }
 
-                LogPrint(BCLog::MINER, "create CCDPInterestForceSettleTx to block! tx=%s\n",
-                        spCdpForceSettleInterestTx->ToString(cwIn.accountCache));
-            }
+    // Queue the mempool txs by priority. The price feed txs go before the median tx, the force settle tx
+    // after it.
+    set<TxPriority> txPriorities;
+    GetPriorityTx(*spCW, height, txPriorities, fuelRate);
+    txPriorities.emplace(TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, spPriceMedianTx));
+    if (spForceSettleTx)
+        txPriorities.emplace(TxPriority(TRANSACTION_PRIORITY_CEILING, 0, spForceSettleTx));
+
+    for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor)
+        pendingTxs.push_back(itor->baseTx);
+    mempoolSequence = mempool.GetLastSequence();
+
+    LogPrint(BCLog::MINER, "[%d] reset block template, block_time=%u, miner_regid=%s, queued_tx_count=%u\n",
+            height, blockTime, minerRegid.ToString(), pendingTxs.size());
+
+    return true;
+}
+
+void CBlockTemplate::QueueNewTxs() {
+    AssertLockHeld(mempool.cs);
+
+    for (auto it = mempool.arrivalTxs.upper_bound(mempoolSequence); it != mempool.arrivalTxs.end(); ++it) {
+        const auto &spBaseTx = mempool.memPoolTxs.at(it->second).GetTransaction();
+        if (!spBaseTx->IsBlockRewardTx())
+            pendingTxs.push_back(spBaseTx);
+    }
+    mempoolSequence = mempool.GetLastSequence();
+}
+
+bool CBlockTemplate::IsPacked(const std::shared_ptr<const CBaseTx> &spBaseTx) const {
+    // the hash of the median tx is only known once its prices are calculated
+    if (spBaseTx == spPriceMedianTx)
+        return fMedianPacked;
+
+    return txids.count(spBaseTx->GetHash()) > 0;
+}
+
+bool CBlockTemplate::IsSystemTx(const std::shared_ptr<const CBaseTx> &spBaseTx) const {
+    return spBaseTx == spPriceMedianTx || spBaseTx == spForceSettleTx;
+}
+
+std::shared_ptr<CBaseTx> CBlockTemplate::GetExecutableTx(const std::shared_ptr<const CBaseTx> &spBaseTx) const {
+    if (spBaseTx == spPriceMedianTx)
+        return spPriceMedianTx;
+    if (spBaseTx == spForceSettleTx)
+        return spForceSettleTx;
+
+    return spBaseTx->GetNewInstance();
+}
+
+bool CBlockTemplate::PackMempoolTxs(int64_t startMiningMs, int64_t deadlineMs, uint32_t &count) {
+    count = 0;
+    QueueNewTxs();
+
+    while (!pendingTxs.empty()) {
+        std::shared_ptr<const CBaseTx> spTx = pendingTxs.front();
+        if (IsPacked(spTx) || (!IsSystemTx(spTx) && !mempool.memPoolTxs.count(spTx->GetHash()))) {
+            // packed as an ancestor already, or gone from the mempool since it was queued
+            pendingTxs.pop_front();
+            continue;
         }
 
-        LogPrint(BCLog::MINER, "Got %lu trx(s), sorted by priority\n", txPriorities.size());
+        if (fMedianPacked && spTx->IsPriceFeedTx() && !failedFeedTxids.count(spTx->GetHash())) {
+            // the median has to include the new price feed tx, queue the mempool again and start over
+            LogPrint(BCLog::MINER, "[%d] price feed tx %s after the median tx, rebuild block template\n", height,
+                    spTx->GetHash().GetHex());
+            if (!Reset(pIndexPrev, templateSlotTime, blockTime, minerRegid))
+                return false;
 
-        // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
+            continue;
+        }
 
-            if (!CheckPackBlockTime(startMiningMs, height)) {
-                LogPrint(BCLog::MINER, "[%d] no time left to pack more tx, ignore! start_ms=%lld, tx_count=%u\n",
-                        height, startMiningMs, pBlock->vptx.size());
-                break;
-            }
+        if (startMiningMs > 0 && !CheckPackBlockTime(startMiningMs, height)) {
+            LogPrint(BCLog::MINER, "[%d] no time left to pack more tx, ignore! start_ms=%lld, tx_count=%u\n",
+                    height, startMiningMs, vptx.size() + 1);
+            return true;
+        }
 
-            CBaseTx *pBaseTx = itor->baseTx.get();
+        if (deadlineMs > 0 && GetTimeMillis() > deadlineMs)
+            return true;
 
-            uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
-            if (totalBlockSize + txSize >= nBlockMaxSize) {
-                LogPrint(BCLog::MINER, "Exceed max block size, txid: %s\n", pBaseTx->GetHash().GetHex());
+        pendingTxs.pop_front();
+
+        // the earlier txs of the same sender go first, the tx may depend on them
+        vector<std::shared_ptr<const CBaseTx>> package;
+        if (!IsSystemTx(spTx))
+            mempool.GetSenderAncestors(spTx->GetHash(), package);
+        package.push_back(spTx);
 
+        for (const auto &spBaseTx : package) {
+            if (IsPacked(spBaseTx) || failedTxids.count(spBaseTx->GetHash()))
                 continue;
+
+            // a price feed tx which failed before the median can not go after it
+            if (fMedianPacked && spBaseTx->IsPriceFeedTx())
+                continue;
+
+            std::shared_ptr<CBaseTx> spExecTx = GetExecutableTx(spBaseTx);
+            if (PackTx(spExecTx)) {
+                ++count;
+                RetryFailedTxs(spExecTx);
+            } else if (spBaseTx == spPriceMedianTx) {
+                // a block must have the median tx
+                return ERRORMSG("pack block price median tx error");
+            } else {
+                AddFailedTx(spExecTx);
+                if (!fMedianPacked && spBaseTx->IsPriceFeedTx())
+                    failedFeedTxids.insert(spBaseTx->GetHash());
             }
+        }
+    }
 
-            auto spCW = std::make_shared<CCacheWrapper>(&cwIn);
+    return true;
+}
 
-            try {
-                auto bm = MAKE_BENCHMARK("execute tx in mining block");
-                CValidationState state;
+void CBlockTemplate::AddFailedTx(const std::shared_ptr<CBaseTx> &spBaseTx) {
+    failedTxids.insert(spBaseTx->GetHash());
 
-                pBaseTx->nFuelRate = fuelRate;
+    set<CKeyID> keyIds;
+    if (!spBaseTx->GetInvolvedKeyIds(*spCW, keyIds))
+        return;
 
-                // Special case for price median tx,
-                if (pBaseTx->IsPriceMedianTx()) {
-                    CBlockPriceMedianTx *pPriceMedianTx = (CBlockPriceMedianTx *)itor->baseTx.get();
-                    if (!spCW->ppCache.CalcMedianPrices(*spCW, height, pPriceMedianTx->median_prices))
-                        return ERRORMSG("calculate block median prices error");
-                }
+    for (const auto &keyId : keyIds)
+        failedTxidsByKeyId[keyId].insert(spBaseTx->GetHash());
+}
 
-                LogPrint(BCLog::MINER, "begin to pack trx: %s\n", pBaseTx->ToString(spCW->accountCache));
+void CBlockTemplate::RetryFailedTxs(const std::shared_ptr<CBaseTx> &spBaseTx) {
+    if (failedTxidsByKeyId.empty())
+        return;
 
-                uint32_t prevBlockTime = pIndexPrev->GetBlockTime();
-                CTxExecuteContext context(height, index + 1, fuelRate, blockTime, prevBlockTime,
-                                          miner.account.regid, spCW.get(), &state,
-                                          TxExecuteContextType::PRODUCE_BLOCK);
+    set<CKeyID> keyIds;
+    spBaseTx->GetInvolvedKeyIds(*spCW, keyIds);
+    for (const auto &keyId : keyIds) {
+        auto it = failedTxidsByKeyId.find(keyId);
+        if (it == failedTxidsByKeyId.end())
+            continue;
 
-                if (!pBaseTx->CheckAndExecuteTx(context)) {
-                    LogPrint(BCLog::MINER, "failed to check/exec tx: %s\n", pBaseTx->ToString(spCW->accountCache));
+        for (const auto &txid : it->second) {
+            if (failedTxids.erase(txid) == 0)
+                continue;
 
-                    pCdMan->pLogCache->SetExecuteFail(height, pBaseTx->GetHash(), state.GetRejectCode(), state.GetRejectReason());
-                    continue;
-                }
+            auto spFailedTx = mempool.Lookup(txid);
+            if (spFailedTx)
+                pendingTxs.push_back(spFailedTx);
+        }
+        failedTxidsByKeyId.erase(it);
+    }
+}
 
-                // Run step limits
-                if (totalFuel + pBaseTx->fuel >= MAX_BLOCK_FUEL) {
-                    LogPrint(BCLog::MINER, "Exceed max block run steps, txid: %s\n", pBaseTx->GetHash().GetHex());
-                    continue;
-                }
-            } catch (std::exception &e) {
-                LogPrint(BCLog::ERROR, "unexpected exception: %s\n", e.what());
+bool CBlockTemplate::PackTx(const std::shared_ptr<CBaseTx> &spBaseTx) {
+    CBaseTx *pBaseTx = spBaseTx.get();
 
-                continue;
-            }
+    uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+    if (totalBlockSize + txSize >= blockMaxSize) {
+        LogPrint(BCLog::MINER, "Exceed max block size, txid: %s\n", pBaseTx->GetHash().GetHex());
 
-            spCW->Flush();
+        return false;
+    }
 
-            auto fuelFee        = pBaseTx->GetFuelFee(cwIn, height, fuelRate);
-            auto fees_symbol = std::get<0>(pBaseTx->GetFees());
-            auto fees        = std::get<1>(pBaseTx->GetFees());
-            assert(fees_symbol == SYMB::WICC || fees_symbol == SYMB::WUSD);
+    auto spTxCW = std::make_shared<CCacheWrapper>(spCW.get());
 
-            totalBlockSize += txSize;
-            totalFuel += pBaseTx->fuel;
-            totalFuelFee += fuelFee;
-            totalFees += fees;
-            assert(fees >= fuelFee);
-            rewards[fees_symbol] += (fees - fuelFee);
+    try {
+        auto bm = MAKE_BENCHMARK("execute tx in mining block");
+        CValidationState state;
 
-            ++index;
+        pBaseTx->nFuelRate = fuelRate;
 
-            pBlock->vptx.push_back(itor->baseTx);
+        // Special case for price median tx, its median includes the price feed txs packed before it
+        if (pBaseTx->IsPriceMedianTx()) {
+            if (!spTxCW->ppCache.CalcMedianPrices(*spTxCW, height, spPriceMedianTx->median_prices))
+                return ERRORMSG("calculate block median prices error");
 
-            LogPrint(BCLog::DEBUG, "miner total_fuel_fee=%d, tx_fuel_fee=%d, fuel=%d, fuelRate:%d, txid:%s\n",
-                    totalFuelFee, fuelFee, pBaseTx->fuel, fuelRate, pBaseTx->GetHash().GetHex());
+            pBaseTx->GetHash(true);
+        }
+
+        LogPrint(BCLog::MINER, "begin to pack trx: %s\n", pBaseTx->ToString(spTxCW->accountCache));
 
+        CTxExecuteContext context(height, vptx.size() + 1, fuelRate, blockTime, prevBlockTime, minerRegid,
+                                  spTxCW.get(), &state, TxExecuteContextType::PRODUCE_BLOCK);
+
+        if (!pBaseTx->CheckAndExecuteTx(context)) {
+            LogPrint(BCLog::MINER, "failed to check/exec tx: %s\n", pBaseTx->ToString(spTxCW->accountCache));
+
+            pCdMan->pLogCache->SetExecuteFail(height, pBaseTx->GetHash(), state.GetRejectCode(), state.GetRejectReason());
+            return false;
         }
 
-        nLastBlockTx                   = index + 1;
-        nLastBlockSize                 = totalBlockSize;
+        // Run step limits
+        if (totalFuel + pBaseTx->fuel >= MAX_BLOCK_FUEL) {
+            LogPrint(BCLog::MINER, "Exceed max block run steps, txid: %s\n", pBaseTx->GetHash().GetHex());
+            return false;
+        }
+    } catch (std::exception &e) {
+        LogPrint(BCLog::ERROR, "unexpected exception: %s\n", e.what());
 
-        ((CUCoinBlockRewardTx *)pBlock->vptx[0].get())->reward_fees = rewards;
+        return false;
+    }
 
-        // Fill in header
-        pBlock->SetPrevBlockHash(pIndexPrev->GetBlockHash());
-        pBlock->SetNonce(0);
-        pBlock->SetHeight(height);
-        pBlock->SetFuel(totalFuelFee);
-        pBlock->SetFuelRate(fuelRate);
+    spTxCW->Flush();
 
-        LogPrint(BCLog::INFO, "[%d] tx=%d, totalBlockSize=%llu\n", height, index + 1, totalBlockSize);
+    auto fuelFee     = pBaseTx->GetFuelFee(*spCW, height, fuelRate);
+    auto fees_symbol = std::get<0>(pBaseTx->GetFees());
+    auto fees        = std::get<1>(pBaseTx->GetFees());
+    assert(fees_symbol == SYMB::WICC || fees_symbol == SYMB::WUSD);
+
+    totalBlockSize += txSize;
+    totalFuel += pBaseTx->fuel;
+    totalFuelFee += fuelFee;
+    totalFees += fees;
+    assert(fees >= fuelFee);
+    rewards[fees_symbol] += (fees - fuelFee);
+
+    vptx.push_back(spBaseTx);
+    txids.insert(pBaseTx->GetHash());
+    if (spBaseTx == spPriceMedianTx)
+        fMedianPacked = true;
+    if (IsBlockTimeTx(*pBaseTx))
+        fBlockTimeUsed = true;
+
+    LogPrint(BCLog::DEBUG, "miner total_fuel_fee=%d, tx_fuel_fee=%d, fuel=%d, fuelRate:%d, txid:%s\n",
+            totalFuelFee, fuelFee, pBaseTx->fuel, fuelRate, pBaseTx->GetHash().GetHex());
+
+    return true;
+}
+
+void CBlockTemplate::Finalize(CBlock &block) {
+    block.vptx.insert(block.vptx.end(), vptx.begin(), vptx.end());
+
+    nLastBlockTx   = vptx.size() + 1;
+    nLastBlockSize = totalBlockSize;
+
+    ((CUCoinBlockRewardTx *)block.vptx[0].get())->reward_fees = rewards;
+
+    // Fill in header
+    block.SetPrevBlockHash(prevBlockHash);
+    block.SetNonce(0);
+    block.SetHeight(height);
+    block.SetFuel(totalFuelFee);
+    block.SetFuelRate(fuelRate);
+
+    LogPrint(BCLog::INFO, "[%d] tx=%d, totalBlockSize=%llu\n", height, vptx.size() + 1, totalBlockSize);
+}
+
+static bool CreateNewBlockForStableCoinRelease(int64_t startMiningMs, int64_t slotTime, Miner &miner,
+                                               std::unique_ptr<CBlock> &pBlock, MinedBlockInfo &blockInfo) {
+    pBlock->vptx.push_back(std::make_shared<CUCoinBlockRewardTx>());
+
+    // Collect memory pool transactions into the block
+    {
+        LOCK2(cs_main, mempool.cs);
+        LOCK(cs_blockTemplate);
+
+        CBlockIndex *pIndexPrev = chainActive.Tip();
+        if (blockTemplate.IsMatch(pIndexPrev, slotTime, miner.account.regid) &&
+            blockTemplate.SetBlockTime(pBlock->GetTime())) {
+            blockInfo.templateTxCount = blockTemplate.vptx.size();
+        } else if (!blockTemplate.Reset(pIndexPrev, slotTime, pBlock->GetTime(), miner.account.regid)) {
+            blockTemplate.SetNull();
+            return false;
+        }
+
+        if (!blockTemplate.PackMempoolTxs(startMiningMs, 0, blockInfo.slotTxCount)) {
+            blockTemplate.SetNull();
+            return false;
+        }
+
+        LogPrint(BCLog::MINER, "[%d] packed %u trx(s) from block template, %u trx(s) in slot\n",
+                blockTemplate.height, blockInfo.templateTxCount, blockInfo.slotTxCount);
+
+        blockTemplate.Finalize(*pBlock);
+        blockTemplate.SetNull();
     }
 
     return true;
@@ -642,7 +931,8 @@ static bool GetMiner(int64_t startMiningMs, const int32_t blockHeight, Miner &mi
 }
 
 
-static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &miner, const uint32_t totalDelegateNum) {
+static bool ProduceBlock(int64_t startMiningMs, int64_t slotTime, CBlockIndex *pPrevIndex, Miner &miner,
+                         const uint32_t totalDelegateNum) {
     // has done LOCK(cs_main);
     int64_t lastTime    = 0;
     bool success        = false;
@@ -662,6 +952,7 @@ static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &
 
     lastTime  = GetTimeMillis();
     auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
+    miningBlockInfo.SetNull();
 
     pBlock->SetTime(MillisToSecond(startMiningMs));  // set block time first
 
@@ -672,7 +963,7 @@ static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &
         success = CreateNewBlockForPreStableCoinRelease(miner, *spCW, pBlock); // pre-stable coin release
 
     } else {
-        success = CreateNewBlockForStableCoinRelease(startMiningMs, miner, *spCW, pBlock);    // stable coin release
+        success = CreateNewBlockForStableCoinRelease(startMiningMs, slotTime, miner, pBlock, miningBlockInfo);    // stable coin release
     }
 
     if (!success) {
@@ -697,6 +988,9 @@ static bool ProduceBlock(int64_t startMiningMs, CBlockIndex *pPrevIndex, Miner &
         "used_time_ms=%lld\n", blockHeight, minerId.ToString(), pBlock->vptx[0]->GetHash().ToString(),
         GetTimeMillis() - lastTime);
 
+    // slot time used until the block is ready to be relayed
+    miningBlockInfo.usedTimeMs = GetTimeMillis() - startMiningMs;
+
     lastTime = GetTimeMillis();
     success  = CheckWork(pBlock.get());
     if (!success) {
@@ -800,6 +1094,7 @@ void static ThreadBlockProducing(CWallet *pWallet, int32_t targetHeight) {
             int64_t startMiningMs = GetTimeMillis();
             int64_t curMiningTime = MillisToSecond(startMiningMs);
             int64_t curSlotTime = std::max(nextSlotTime, pPrevIndex->GetBlockTime() + GetBlockInterval(blockHeight));
+            SetBlockTemplateSlot(pPrevIndex, curSlotTime);
             if (curMiningTime < curSlotTime) {
                 needSleep = true;
                 continue;
@@ -830,7 +1125,7 @@ void static ThreadBlockProducing(CWallet *pWallet, int32_t targetHeight) {
                     needSleep = false;
                     continue; // need to check and mine again
                 }
-                if (!ProduceBlock(startMiningMs, pPrevIndex, *spMiner,totalDelegateNum)) {
+                if (!ProduceBlock(startMiningMs, curSlotTime, pPrevIndex, *spMiner, totalDelegateNum)) {
                     needSleep = true;
                     continue;
                 }
@@ -846,6 +1141,100 @@ void static ThreadBlockProducing(CWallet *pWallet, int32_t targetHeight) {
     }
 }
 
+// One step of keeping the block template warm for the next slot if it is on duty by this node, true
+// if txs are left to be packed
+static bool UpdateBlockTemplate() {
+    if (SysCfg().IsReindex() || IsInitialBlockDownload())
+        return false;
+
+    uint256 prevBlockHash;
+    int32_t height;
+    int64_t slotTime;
+    bool fSlotChecked;
+    {
+        LOCK(cs_blockTemplate);
+        prevBlockHash = blockTemplate.slotPrevBlockHash;
+        height        = blockTemplate.slotHeight;
+        slotTime      = blockTemplate.slotTime;
+        fSlotChecked  = blockTemplate.fSlotChecked;
+        if (fSlotChecked && !blockTemplate.fOnDuty)
+            return false;
+    }
+    if (slotTime == 0 || height == (int32_t)SysCfg().GetVer2GenesisHeight() ||
+        GetFeatureForkVersion(height) == MAJOR_VER_R1)
+        return false;
+
+    if (!fSlotChecked) {
+        // the miner thread looks the producer of the slot up in the same way when the slot arrives
+        Miner miner;
+        uint32_t totalDelegateNum;
+        bool fOnDuty = GetMiner(slotTime * 1000, height, miner, totalDelegateNum) &&
+                       miner.account.CheckPerms(AccountPermType::PERM_MINE_BLOCK);
+
+        LOCK(cs_blockTemplate);
+        if (blockTemplate.slotPrevBlockHash != prevBlockHash || blockTemplate.slotTime != slotTime)
+            return false;  // a new slot was set meanwhile, it has woken the updater up again
+
+        blockTemplate.fSlotChecked   = true;
+        blockTemplate.fOnDuty        = fOnDuty;
+        blockTemplate.slotMinerRegid = miner.account.regid;
+        if (!fOnDuty)
+            return false;
+    }
+
+    LOCK2(cs_main, mempool.cs);
+    CBlockIndex *pTip = chainActive.Tip();
+    if (pTip == nullptr || pTip->GetBlockHash() != prevBlockHash)
+        return false;  // the miner thread sets the slot on the new tip
+
+    LOCK(cs_blockTemplate);
+    if (!blockTemplate.IsMatch(pTip, slotTime, blockTemplate.slotMinerRegid) &&
+        !blockTemplate.Reset(pTip, slotTime, slotTime, blockTemplate.slotMinerRegid)) {
+        blockTemplate.SetNull();
+        return false;
+    }
+
+    uint32_t count = 0;
+    if (!blockTemplate.PackMempoolTxs(0, GetTimeMillis() + BLOCK_TEMPLATE_UPDATE_TIME_MS, count)) {
+        blockTemplate.SetNull();
+        return false;
+    }
+
+    if (count > 0)
+        LogPrint(BCLog::MINER, "[%d] packed %u trx(s) into block template, tx_count=%u, queued_tx_count=%u\n",
+                height, count, blockTemplate.vptx.size() + 1, blockTemplate.pendingTxs.size());
+
+    return blockTemplate.HasPendingTxs();
+}
+
+void static ThreadBlockTemplate() {
+    LogPrint(BCLog::INFO, "started\n");
+
+    RenameThread("coin-blocktmpl");
+
+    try {
+        while (true) {
+            boost::this_thread::interruption_point();
+
+            // woken up by a new slot from the miner thread or a new mempool tx
+            WaitBlockTemplate(BLOCK_TEMPLATE_WAIT_MS);
+
+            // pack in short steps, and leave cs_main to the block validation and the message handlers in between
+            while (UpdateBlockTemplate()) {
+                boost::this_thread::interruption_point();
+                MilliSleep(BLOCK_TEMPLATE_UPDATE_PAUSE_MS);
+            }
+        }
+    } catch (...) {
+        {
+            LOCK(cs_blockTemplate);
+            blockTemplate.SetNull();
+        }
+        LogPrint(BCLog::INFO, "terminated\n");
+        throw;
+    }
+}
+
 void GenerateProduceBlockThread(bool fGenerate, CWallet *pWallet, int32_t targetHeight) {
     static boost::thread_group *minerThreads = nullptr;
 
@@ -866,6 +1255,8 @@ void GenerateProduceBlockThread(bool fGenerate, CWallet *pWallet, int32_t target
 
     minerThreads = new boost::thread_group();
     minerThreads->create_thread(boost::bind(&ThreadBlockProducing, pWallet, targetHeight));
+    if (SysCfg().GetBoolArg("-blocktemplate", DEFAULT_BLOCK_TEMPLATE))
+        minerThreads->create_thread(&ThreadBlockTemplate);
 }
 
 void MinedBlockInfo::SetNull() {
@@ -878,6 +1269,9 @@ void MinedBlockInfo::SetNull() {
     totalBlockSize = 0;
     hash.SetNull();
     hashPrevBlock.SetNull();
+    templateTxCount = 0;
+    slotTxCount     = 0;
+    usedTimeMs      = 0;
 }
 
 void MinedBlockInfo::Set(const CBlock *pBlock) {
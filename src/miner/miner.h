@@ -7,6 +7,7 @@
 #define COIN_MINER_H
 
 #include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
 #include <set>
@@ -23,11 +24,23 @@ class CWallet;
 class CBaseTx;
 class CAccountDBCache;
 class CAccount;
+class CCacheWrapper;
+class CBlockPriceMedianTx;
+class CCDPInterestForceSettleTx;
 
 #include <cmath>
 
 using namespace std;
 
+/** -blocktemplate default, keep the next block template warm between the producer slots */
+static const bool DEFAULT_BLOCK_TEMPLATE                = true;
+/** Max time of one block template update step holding cs_main, in milliseconds */
+static const int64_t BLOCK_TEMPLATE_UPDATE_TIME_MS      = 10;
+/** Pause between the block template update steps, cs_main is free for the other threads, in milliseconds */
+static const int64_t BLOCK_TEMPLATE_UPDATE_PAUSE_MS     = 40;
+/** Longest wait of the block template updater for a new slot or mempool tx, in milliseconds */
+static const int64_t BLOCK_TEMPLATE_WAIT_MS             = 1000;
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // ThreadBlockProducing
@@ -42,9 +55,9 @@ struct Miner {
 struct TxPriority {
     double priority;
     double feePerKb;
-    std::shared_ptr<CBaseTx> baseTx;
+    std::shared_ptr<const CBaseTx> baseTx;
 
-    TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn)
+    TxPriority(const double priorityIn, const double feePerKbIn, const std::shared_ptr<const CBaseTx> &baseTxIn)
         : priority(priorityIn), feePerKb(feePerKbIn), baseTx(baseTxIn) {}
 
     bool operator<(const TxPriority &other) const {
@@ -60,6 +73,102 @@ struct TxPriority {
     }
 };
 
+// Next block being packed against a staging cache. It is kept warm in the background between the
+// producer slots, so that most of the txs have been executed when the slot arrives. The mempool txs
+// are queued by priority when the template is reset on a new tip or slot, the txs arriving later are
+// queued in arrival order, and the queue is packed in steps of bounded time.
+class CBlockTemplate {
+public:
+    CBlockIndex *pIndexPrev;
+    uint256 prevBlockHash;
+    int32_t height;
+    int64_t templateSlotTime;                   // slot the template is packed for
+    uint32_t blockTime;
+    uint32_t prevBlockTime;
+    CRegID minerRegid;
+    uint32_t fuelRate;
+    uint32_t blockMaxSize;
+
+    std::shared_ptr<CCacheWrapper> spCW;        // staging cache on top of pCdMan
+    vector<std::shared_ptr<CBaseTx>> vptx;      // packed txs, exclude block reward tx, copies of the mempool txs
+    set<uint256> txids;                         // packed txs, not to be executed again
+    deque<std::shared_ptr<const CBaseTx>> pendingTxs; // txs queued to be packed, in packing order
+    uint64_t mempoolSequence;                   // last mempool tx queued
+    // The system txs of the block, packed among the mempool txs by their priorities
+    std::shared_ptr<CBlockPriceMedianTx> spPriceMedianTx;
+    std::shared_ptr<CCDPInterestForceSettleTx> spForceSettleTx;
+    bool fMedianPacked;
+    set<uint256> failedFeedTxids;               // price feed txs failed before the median was packed
+    // Failed txs, queued again once a tx involving one of their accounts is packed. A failed tx whose
+    // accounts are not known waits for the next reset.
+    set<uint256> failedTxids;
+    map<CKeyID, set<uint256>> failedTxidsByKeyId;
+    uint64_t totalBlockSize;
+    uint64_t totalFuel;
+    uint64_t totalFees;
+    uint64_t totalFuelFee;
+    map<TokenSymbol, uint64_t> rewards;
+    bool fBlockTimeUsed;                        // a packed tx read the block time in its execution
+
+    // The next slot, published by the miner thread, and whether this node is on duty for it. They are
+    // kept across the resets of the template.
+    uint256 slotPrevBlockHash;
+    int32_t slotHeight;
+    int64_t slotTime;
+    bool fSlotChecked;                          // the duty of the slot has been looked up
+    bool fOnDuty;
+    CRegID slotMinerRegid;
+
+public:
+    CBlockTemplate() {
+        SetNull();
+        slotPrevBlockHash.SetNull();
+        slotHeight   = 0;
+        slotTime     = 0;
+        fSlotChecked = false;
+        fOnDuty      = false;
+        slotMinerRegid.Clear();
+    }
+
+    // Drop the packed block, the slot is kept
+    void SetNull();
+
+    bool IsNull() const { return spCW == nullptr; }
+
+    bool IsMatch(const CBlockIndex *pIndexPrev, int64_t slotTimeIn, const CRegID &minerRegidIn) const;
+    // Time the block as mined at blockTimeIn, false if a packed tx was executed with another block time
+    bool SetBlockTime(uint32_t blockTimeIn);
+
+    // Set the slot the miner thread waits for, false if it is the same one already
+    bool SetSlot(const CBlockIndex *pIndexPrev, int64_t slotTimeIn);
+
+    // Start a new template on top of pIndexPrev with the system txs of the block, and queue the
+    // mempool txs by priority, need cs_main and mempool.cs
+    bool Reset(CBlockIndex *pIndexPrev, int64_t slotTimeIn, uint32_t blockTimeIn, const CRegID &minerRegidIn);
+    // Queue the txs which arrived in the mempool since the last ones queued, need mempool.cs
+    void QueueNewTxs();
+    // Pack the queued txs until the queue is empty, the slot time is used up from startMiningMs or
+    // deadlineMs is passed, either one 0 to ignore it, need cs_main and mempool.cs. The template is
+    // reset when a price feed tx comes after the median tx was packed; false if that failed.
+    bool PackMempoolTxs(int64_t startMiningMs, int64_t deadlineMs, uint32_t &count);
+    bool HasPendingTxs() const { return !pendingTxs.empty(); }
+    // Move the packed txs into the block which contains the block reward tx only
+    void Finalize(CBlock &block);
+
+private:
+    bool IsPacked(const std::shared_ptr<const CBaseTx> &spBaseTx) const;
+    bool IsSystemTx(const std::shared_ptr<const CBaseTx> &spBaseTx) const;
+    // The mempool txs are shared and executed by the mempool only, a copy of them is executed and packed
+    std::shared_ptr<CBaseTx> GetExecutableTx(const std::shared_ptr<const CBaseTx> &spBaseTx) const;
+    bool PackTx(const std::shared_ptr<CBaseTx> &spBaseTx);
+    void AddFailedTx(const std::shared_ptr<CBaseTx> &spBaseTx);
+    // Queue the failed txs involving an account of the packed tx again
+    void RetryFailedTxs(const std::shared_ptr<CBaseTx> &spBaseTx);
+};
+
+// Wake the block template updater up, on a new mempool tx or slot
+void WakeBlockTemplate();
+
 // mined block info
 class MinedBlockInfo {
 public:
@@ -72,6 +181,9 @@ public:
     uint64_t totalBlockSize;  // block size(bytes)
     uint256 hash;             // block hash
     uint256 hashPrevBlock;    // prev block has
+    uint32_t templateTxCount; // txs packed into the block template before the slot arrived
+    uint32_t slotTxCount;     // txs packed in the slot
+    int64_t usedTimeMs;       // slot time used until the block was signed
 
 public:
     MinedBlockInfo() { SetNull(); }
@@ -9,8 +9,11 @@
 
 #include <map>
 #include <set>
+#include <unordered_map>
 #include "sync.h"
 #include "commons/uint256.h"
+#include "commons/hasher.h"
+#include "entities/id.h"
 #include "miner/pbftlimitmap.h"
 #include "commons/mruset.h"
 #include "entities/vote.h"
@@ -23,10 +26,10 @@ class CBlockFinalityMessage;
 template <typename MsgType>
 class CPBFTMessageMan {
 public:
-    typedef map<CRegID, MsgType> BpMsgMap;
+    typedef unordered_map<CRegID, MsgType, CSaltedRegIDHasher> BpMsgMap;
     CCriticalSection cs_pbftmessage;
 private:
-    CLruCache<uint256, BpMsgMap, CUint256Hasher> blockMessagesMap;
+    CLruCache<uint256, BpMsgMap, CSaltedUint256Hasher> blockMessagesMap;
     mruset<uint256> broadcastedBlockHashSet;
     mruset<MsgType> messageKnown;
 
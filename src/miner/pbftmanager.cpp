@@ -305,9 +305,10 @@ bool CPBFTMan::BroadcastBlockFinality(const CBlockIndex* pTipIndex){
             msg.SetSignature(vSign);
 
             {
+                auto spMessage = MakeSharedNetMessage(NetMsgType::FINALITYBLOCK, msg);
                 LOCK(cs_vNodes);
                 for (auto pNode : vNodes) {
-                    pNode->PushBlockFinalityMessage(msg);
+                    pNode->PushBlockFinalityMessage(msg, spMessage);
                 }
             }
 
@@ -367,9 +368,10 @@ bool CPBFTMan::BroadcastBlockConfirm(const CBlockIndex* pTipIndex) {
             msg.SetSignature(vSign);
 
             {
+                auto spMessage = MakeSharedNetMessage(NetMsgType::CONFIRMBLOCK, msg);
                 LOCK(cs_vNodes);
                 for (auto pNode : vNodes) {
-                    pNode->PushBlockConfirmMessage(msg);
+                    pNode->PushBlockConfirmMessage(msg, spMessage);
                 }
             }
             LogPrint(BCLog::PBFT, "generate and broadcast pbft confirm msg! block=%s, bp=%s\n",
@@ -496,18 +498,20 @@ void CPBFTMan::AfterDisconnectTip(CBlockIndex* pTipIndex) {
 
 bool RelayBlockConfirmMessage(const CBlockConfirmMessage& msg){
 
+    auto spMessage = MakeSharedNetMessage(NetMsgType::CONFIRMBLOCK, msg);
     LOCK(cs_vNodes);
     for(auto node:vNodes){
-        node->PushBlockConfirmMessage(msg);
+        node->PushBlockConfirmMessage(msg, spMessage);
     }
     return true;
 }
 
 bool RelayBlockFinalityMessage(const CBlockFinalityMessage& msg){
 
+    auto spMessage = MakeSharedNetMessage(NetMsgType::FINALITYBLOCK, msg);
     LOCK(cs_vNodes);
     for(auto node:vNodes){
-        node->PushBlockFinalityMessage(msg);
+        node->PushBlockFinalityMessage(msg, spMessage);
     }
     return true;
 }
@@ -15,6 +15,8 @@
 #include "tx/tx.h"
 #include "commons/util/time.h"
 #include "p2p/node.h"
+#include "p2p/relaycache.h"
+#include "p2p/txadmission.h"
 
 #ifdef WIN32
 #include <string.h>
@@ -78,9 +80,6 @@ CNodeSignals& GetNodeSignals() { return g_node_signals; }
 
 vector<CNode*> vNodes;
 CCriticalSection cs_vNodes;
-map<CInv, CDataStream> mapRelay;
-deque<pair<int64_t, CInv> > vRelayExpiration;
-CCriticalSection cs_mapRelay;
 
 
 static deque<string> vOneShots;
@@ -476,306 +475,453 @@ CNode* ConnectNode(CAddress addrConnect, const char* pszDest) {
 
 
 static list<CNode*> vNodesDisconnected;
+// Peers whose socket may have data left to read, or that could not be written to on their
+// last epoll edge. Only used by the socket thread in epoll mode.
+static set<CNode*> setNodesRecvPending;
+static set<CNode*> setNodesSendPending;
 
-void ThreadSocketHandler() {
-    uint32_t nPrevNodeCount = 0;
-    while (true) {
-        //
-        // Disconnect nodes
-        //
-        {
-            LOCK(cs_vNodes);
-            // Disconnect unused nodes
-            vector<CNode*> vNodesCopy = vNodes;
-            for (auto pNode : vNodesCopy) {
-                if (pNode->fDisconnect || (pNode->GetRefCount() <= 0 && pNode->vRecvMsg.empty() &&
-                                           pNode->nSendSize == 0 && pNode->ssSend.empty())) {
-                    // remove from vNodes
-                    vNodes.erase(remove(vNodes.begin(), vNodes.end(), pNode), vNodes.end());
-
-                    // release outbound grant (if any)
-                    pNode->grantOutbound.Release();
-
-                    // close socket and cleanup
-                    pNode->CloseSocketDisconnect();
-                    pNode->Cleanup();
-
-                    // hold in disconnected pool until all refs are released
-                    if (pNode->fNetworkNode || pNode->fInbound)
-                        pNode->Release();
-                    vNodesDisconnected.push_back(pNode);
-                }
+static void DisconnectNodes() {
+    static uint32_t nPrevNodeCount = 0;
+    {
+        LOCK(cs_vNodes);
+        // Disconnect unused nodes
+        vector<CNode*> vNodesCopy = vNodes;
+        for (auto pNode : vNodesCopy) {
+            if (pNode->fDisconnect || (pNode->GetRefCount() <= 0 && pNode->vRecvMsg.empty() &&
+                                       pNode->nSendSize == 0 && pNode->ssSend.empty())) {
+                // remove from vNodes
+                vNodes.erase(remove(vNodes.begin(), vNodes.end(), pNode), vNodes.end());
+
+                // release outbound grant (if any)
+                pNode->grantOutbound.Release();
+
+                // close socket and cleanup
+                pNode->CloseSocketDisconnect();
+                pNode->Cleanup();
+
+                // hold in disconnected pool until all refs are released
+                if (pNode->fNetworkNode || pNode->fInbound)
+                    pNode->Release();
+                vNodesDisconnected.push_back(pNode);
             }
         }
-        {
-            // Delete disconnected nodes
-            list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
-            for (auto pNode : vNodesDisconnectedCopy) {
-                // wait until threads are done using it
-                if (pNode->GetRefCount() <= 0) {
-                    bool fDelete = false;
-                    {
-                        TRY_LOCK(pNode->cs_vSend, lockSend);
-                        if (lockSend) {
-                            TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
-                            if (lockRecv) {
-                                TRY_LOCK(pNode->cs_inventory, lockInv);
-                                if (lockInv)
-                                    fDelete = true;
-                            }
+    }
+    {
+        // Delete disconnected nodes
+        list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
+        for (auto pNode : vNodesDisconnectedCopy) {
+            // wait until threads are done using it
+            if (pNode->GetRefCount() <= 0) {
+                bool fDelete = false;
+                {
+                    TRY_LOCK(pNode->cs_vSend, lockSend);
+                    if (lockSend) {
+                        TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+                        if (lockRecv) {
+                            TRY_LOCK(pNode->cs_inventory, lockInv);
+                            if (lockInv)
+                                fDelete = true;
                         }
                     }
-                    if (fDelete) {
-                        vNodesDisconnected.remove(pNode);
-                        delete pNode;
-                    }
+                }
+                if (fDelete) {
+                    vNodesDisconnected.remove(pNode);
+                    setNodesRecvPending.erase(pNode);
+                    setNodesSendPending.erase(pNode);
+                    delete pNode;
                 }
             }
         }
-        if (vNodes.size() != nPrevNodeCount) {
-            nPrevNodeCount = vNodes.size();
+    }
+    if (vNodes.size() != nPrevNodeCount) {
+        LogPrint(BCLog::INFO, "Connections number changed, %d -> %d\n", nPrevNodeCount, vNodes.size());
 
-            LogPrint(BCLog::INFO, "Connections number changed, %d -> %d\n", nPrevNodeCount, vNodes.size());
-        }
+        nPrevNodeCount = vNodes.size();
+    }
+}
 
-        //
-        // Find which sockets have data to receive
-        //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000;  // frequency to poll pNode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds     = false;
+static void AcceptConnection(SOCKET hListenSocket) {
+    struct sockaddr_storage sockaddr;
+    socklen_t len  = sizeof(sockaddr);
+    SOCKET hSocket = accept(hListenSocket, (struct sockaddr*)&sockaddr, &len);
+    CAddress addr;
+    int32_t nInbound = 0;
 
-        for (auto hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket);
-            have_fds   = true;
-        }
+    if (hSocket != INVALID_SOCKET)
+        if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
+            LogPrint(BCLog::INFO, "Warning: Unknown socket family\n");
+
+    {
+        LOCK(cs_vNodes);
+        for (auto pNode : vNodes)
+            if (pNode->fInbound)
+                nInbound++;
+    }
 
+    if (hSocket == INVALID_SOCKET) {
+        int32_t nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK)
+            LogPrint(BCLog::INFO, "socket[%s] error accept failed: %s\n", addr.ToString(), NetworkErrorString(nErr));
+    } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
+        closesocket(hSocket);
+    } else if (CNode::IsBanned(addr)) {
+        LogPrint(BCLog::INFO, "connection from %s dropped (banned)\n", addr.ToString());
+        closesocket(hSocket);
+    } else {
+        LogPrint(BCLog::NET, "accepted connection %s\n", addr.ToString());
+        CNode* pNode = new CNode(hSocket, addr, "", true);
+        pNode->AddRef();
         {
             LOCK(cs_vNodes);
-            for (auto pNode : vNodes) {
-                if (pNode->hSocket == INVALID_SOCKET)
-                    continue;
+            vNodes.push_back(pNode);
+        }
+    }
+}
 
-                FD_SET(pNode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pNode->hSocket);
-                have_fds   = true;
-
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
-                // * (if neither of the above applies, there is certainly one message
-                //   in the receiver buffer ready to be processed).
-                // Together, that means that at least one of the following is always possible,
-                // so we don't deadlock:
-                // * We send some data.
-                // * We wait for data to be received (and disconnect after timeout).
-                // * We process a message in the buffer (message handler thread).
-                {
-                    TRY_LOCK(pNode->cs_vSend, lockSend);
-                    if (lockSend && !pNode->vSendMsg.empty()) {
+// Read one chunk from the socket of pNode, requires pNode->cs_vRecvMsg.
+// Returns false once the socket is drained or closed.
+static bool SocketRecvData(CNode* pNode) {
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int32_t nBytes = recv(pNode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    if (nBytes > 0) {
+        bool fComplete = false;
+        if (!pNode->ReceiveMsgBytes(pchBuf, nBytes, fComplete))
+            pNode->CloseSocketDisconnect();
+        if (fComplete)
+            WakeMessageHandler(GetMessageHandler(pNode));
+        pNode->nLastRecv = GetTime();
+        pNode->nRecvBytes += nBytes;
+        pNode->RecordBytesRecv(nBytes);
+        // a short read has emptied the socket buffer
+        return nBytes == sizeof(pchBuf) && !pNode->fDisconnect;
+    } else if (nBytes == 0) {
+        // socket closed gracefully
+        if (!pNode->fDisconnect)
+            LogPrint(BCLog::NET, "socket[%s] closed\n", pNode->addr.ToString());
+        pNode->CloseSocketDisconnect();
+    } else if (nBytes < 0) {
+        // error
+        int32_t nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
+            if (!pNode->fDisconnect)
+                LogPrint(BCLog::INFO, "socket[%s] recv error %s\n", pNode->addr.ToString(), NetworkErrorString(nErr));
+            pNode->CloseSocketDisconnect();
+        } else if (nErr == WSAEINTR) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Send what the socket of pNode takes, requires pNode->cs_vSend
+// Returns true if the upload cap held back the rest, it is tried again on the next pass
+static bool SendNodeData(CNode* pNode) {
+    bool fSendFull = pNode->IsSendBufferFull();
+    pNode->SocketSendData();
+    // the message handler holds back the messages of a peer whose send buffer is full
+    if (fSendFull && !pNode->IsSendBufferFull())
+        WakeMessageHandler(GetMessageHandler(pNode));
+
+    return pNode->IsSendHeldBack();
+}
+
+// Whether the receive buffer of pNode has room, or has no complete message to process yet
+static bool CanReceive(CNode* pNode) {
+    return pNode->vRecvMsg.empty() || !pNode->vRecvMsg.front().complete() ||
+           pNode->GetTotalRecvSize() <= ReceiveFloodSize();
+}
+
+static void InactivityCheck(CNode* pNode) {
+    if (pNode->vSendMsg.empty())
+        pNode->nLastSendEmpty = GetTime();
+    // p2p_xiaoyu_20191126
+    // if (GetTime() - pNode->nTimeConnected > 60) {
+    //     if (pNode->nLastRecv == 0 || pNode->nLastSend == 0) {
+    //         LogPrint(BCLog::NET, "socket no message in first 60 seconds, %d %d\n", pNode->nLastRecv != 0,
+    //                  pNode->nLastSend != 0);
+    //         pNode->fDisconnect = true;
+    //     } else if (GetTime() - pNode->nLastSend > 90 * 60 && GetTime() - pNode->nLastSendEmpty > 90 * 60) {
+    //         LogPrint(BCLog::INFO, "socket not sending\n");
+    //         pNode->fDisconnect = true;
+    //     } else if (GetTime() - pNode->nLastRecv > 90 * 60) {
+    //         LogPrint(BCLog::INFO, "socket inactivity timeout\n");
+    //         pNode->fDisconnect = true;
+    //     }
+    // }
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime - pNode->nTimeConnected > DEFAULT_PEER_CONNECT_TIMEOUT)
+    {
+        if (pNode->nLastRecv == 0 || pNode->nLastSend == 0)
+        {
+            LogPrint(BCLog::NET, "socket no message in first %i seconds, %d %d from %d\n", DEFAULT_PEER_CONNECT_TIMEOUT, pNode->nLastRecv != 0, pNode->nLastSend != 0, pNode->GetId());
+            pNode->fDisconnect = true;
+        }
+        else if (nTime - pNode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrint(BCLog::NET, "socket sending timeout: %is\n", nTime - pNode->nLastSend);
+            pNode->fDisconnect = true;
+        }
+        else if (nTime - pNode->nLastRecv > TIMEOUT_INTERVAL )
+        {
+            LogPrint(BCLog::NET, "socket receive timeout: %is\n", nTime - pNode->nLastRecv);
+            pNode->fDisconnect = true;
+        }
+        else if (pNode->nPingNonceSent && pNode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrint(BCLog::NET, "ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pNode->nPingUsecStart));
+            pNode->fDisconnect = true;
+        }
+        else if (!pNode->fSuccessfullyConnected)
+        {
+            LogPrint(BCLog::NET, "version handshake timeout from %d\n", pNode->GetId());
+            pNode->fDisconnect = true;
+        }
+    }
+}
+
+static void SocketHandlerSelect() {
+    DisconnectNodes();
+
+    //
+    // Find which sockets have data to receive
+    //
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = 50000;  // frequency to poll pNode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds     = false;
+
+    for (auto hListenSocket : vhListenSocket) {
+        FD_SET(hListenSocket, &fdsetRecv);
+        hSocketMax = max(hSocketMax, hListenSocket);
+        have_fds   = true;
+    }
+
+    {
+        LOCK(cs_vNodes);
+        for (auto pNode : vNodes) {
+            if (pNode->hSocket == INVALID_SOCKET)
+                continue;
+
+            FD_SET(pNode->hSocket, &fdsetError);
+            hSocketMax = max(hSocketMax, pNode->hSocket);
+            have_fds   = true;
+
+            // Implement the following logic:
+            // * If there is data to send, select() for sending data. As this only
+            //   happens when optimistic write failed, we choose to first drain the
+            //   write buffer in this case before receiving more. This avoids
+            //   needlessly queueing received data, if the remote peer is not themselves
+            //   receiving data. This means properly utilizing TCP flow control signalling.
+            // * Otherwise, if there is no (complete) message in the receive buffer,
+            //   or there is space left in the buffer, select() for receiving data.
+            // * (if neither of the above applies, there is certainly one message
+            //   in the receiver buffer ready to be processed).
+            // Together, that means that at least one of the following is always possible,
+            // so we don't deadlock:
+            // * We send some data.
+            // * We wait for data to be received (and disconnect after timeout).
+            // * We process a message in the buffer (message handler thread).
+            {
+                TRY_LOCK(pNode->cs_vSend, lockSend);
+                if (lockSend && !pNode->vSendMsg.empty()) {
+                    // a socket held back by the upload cap would be writable at once
+                    if (!pNode->IsSendHeldBack())
                         FD_SET(pNode->hSocket, &fdsetSend);
-                        continue;
-                    }
-                }
-                {
-                    TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
-                    if (lockRecv && (pNode->vRecvMsg.empty() || !pNode->vRecvMsg.front().complete() ||
-                                     pNode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pNode->hSocket, &fdsetRecv);
+                    continue;
                 }
             }
+            {
+                TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+                if (lockRecv && CanReceive(pNode))
+                    FD_SET(pNode->hSocket, &fdsetRecv);
+            }
         }
+    }
+
+    int32_t nSelect = select(have_fds ? hSocketMax + 1 : 0, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    boost::this_thread::interruption_point();
 
-        int32_t nSelect = select(have_fds ? hSocketMax + 1 : 0, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (nSelect == SOCKET_ERROR) {
+        if (have_fds) {
+            int32_t nErr = WSAGetLastError();
+            LogPrint(BCLog::INFO, "socket select error %s\n", NetworkErrorString(nErr));
+            for (uint32_t i = 0; i <= hSocketMax; i++)
+                FD_SET(i, &fdsetRecv);
+        }
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        MilliSleep(timeout.tv_usec / 1000);
+    }
+
+    //
+    // Accept new connections
+    //
+    for (auto hListenSocket : vhListenSocket)
+        if (hListenSocket != INVALID_SOCKET && FD_ISSET(hListenSocket, &fdsetRecv))
+            AcceptConnection(hListenSocket);
+
+    //
+    // Service each socket
+    //
+    vector<CNode*> vNodesCopy;
+    {
+        LOCK(cs_vNodes);
+        vNodesCopy = vNodes;
+        for (auto pNode : vNodesCopy)
+            pNode->AddRef();
+    }
+    for (auto pNode : vNodesCopy) {
         boost::this_thread::interruption_point();
 
-        if (nSelect == SOCKET_ERROR) {
-            if (have_fds) {
-                int32_t nErr = WSAGetLastError();
-                LogPrint(BCLog::INFO, "socket select error %s\n", NetworkErrorString(nErr));
-                for (uint32_t i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec / 1000);
+        //
+        // Receive
+        //
+        if (pNode->hSocket == INVALID_SOCKET)
+            continue;
+        if (FD_ISSET(pNode->hSocket, &fdsetRecv) || FD_ISSET(pNode->hSocket, &fdsetError)) {
+            TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+            if (lockRecv)
+                SocketRecvData(pNode);
         }
 
         //
-        // Accept new connections
+        // Send
         //
-        for (auto hListenSocket : vhListenSocket)
-            if (hListenSocket != INVALID_SOCKET && FD_ISSET(hListenSocket, &fdsetRecv)) {
-                struct sockaddr_storage sockaddr;
-                socklen_t len  = sizeof(sockaddr);
-                SOCKET hSocket = accept(hListenSocket, (struct sockaddr*)&sockaddr, &len);
-                CAddress addr;
-                int32_t nInbound = 0;
+        if (pNode->hSocket == INVALID_SOCKET)
+            continue;
+        if (FD_ISSET(pNode->hSocket, &fdsetSend)) {
+            TRY_LOCK(pNode->cs_vSend, lockSend);
+            if (lockSend)
+                SendNodeData(pNode);
+        }
 
-                if (hSocket != INVALID_SOCKET)
-                    if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
-                        LogPrint(BCLog::INFO, "Warning: Unknown socket family\n");
+        //
+        // Inactivity checking
+        //
+        InactivityCheck(pNode);
+    }
 
-                {
-                    LOCK(cs_vNodes);
-                    for (auto pNode : vNodes)
-                        if (pNode->fInbound)
-                            nInbound++;
-                }
+    {
+        LOCK(cs_vNodes);
+        for (auto pNode : vNodesCopy)
+            pNode->Release();
+    }
+}
 
-                if (hSocket == INVALID_SOCKET) {
-                    int32_t nErr = WSAGetLastError();
-                    if (nErr != WSAEWOULDBLOCK)
-                        LogPrint(BCLog::INFO, "socket[%s] error accept failed: %s\n", addr.ToString(), NetworkErrorString(nErr));
-                } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
-                    closesocket(hSocket);
-                } else if (CNode::IsBanned(addr)) {
-                    LogPrint(BCLog::INFO, "connection from %s dropped (banned)\n", addr.ToString());
-                    closesocket(hSocket);
-                } else {
-                    LogPrint(BCLog::NET, "accepted connection %s\n", addr.ToString());
-                    CNode* pNode = new CNode(hSocket, addr, "", true);
-                    pNode->AddRef();
-                    {
-                        LOCK(cs_vNodes);
-                        vNodes.push_back(pNode);
-                    }
-                }
-            }
+static void SocketHandlerEpoll() {
+    static int64_t nLastSweep = 0;
+    // a socket had a full chunk read on the last pass, it is read again without waiting
+    static bool fRecvMore     = false;
+    int64_t nNow = GetTimeMillis();
+    if (nNow - nLastSweep >= SOCKET_SWEEP_INTERVAL_MS) {
+        nLastSweep = nNow;
+        DisconnectNodes();
 
-        //
-        // Service each socket
-        //
-        vector<CNode*> vNodesCopy;
-        {
-            LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (auto pNode : vNodesCopy)
-                pNode->AddRef();
+        LOCK(cs_vNodes);
+        for (auto pNode : vNodes) {
+            if (pNode->hSocket != INVALID_SOCKET)
+                InactivityCheck(pNode);
         }
-        for (auto pNode : vNodesCopy) {
-            boost::this_thread::interruption_point();
+    }
 
-            //
-            // Receive
-            //
-            if (pNode->hSocket == INVALID_SOCKET)
-                continue;
-            if (FD_ISSET(pNode->hSocket, &fdsetRecv) || FD_ISSET(pNode->hSocket, &fdsetError)) {
-                TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
-                if (lockRecv) {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int32_t nBytes = recv(pNode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        if (nBytes > 0) {
-                            if (!pNode->ReceiveMsgBytes(pchBuf, nBytes))
-                                pNode->CloseSocketDisconnect();
-                            pNode->nLastRecv = GetTime();
-                            pNode->nRecvBytes += nBytes;
-                            pNode->RecordBytesRecv(nBytes);
-                        } else if (nBytes == 0) {
-                            // socket closed gracefully
-                            if (!pNode->fDisconnect)
-                                LogPrint(BCLog::NET, "socket[%s] closed\n", pNode->addr.ToString());
-                            pNode->CloseSocketDisconnect();
-                        } else if (nBytes < 0) {
-                            // error
-                            int32_t nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR &&
-                                nErr != WSAEINPROGRESS) {
-                                if (!pNode->fDisconnect)
-                                    LogPrint(BCLog::INFO, "socket[%s] recv error %s\n", pNode->addr.ToString(), NetworkErrorString(nErr));
-                                pNode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
-            }
+    // Nodes are only deleted by DisconnectNodes() on this thread, so the nodes of the events
+    // stay valid until the next pass.
+    // The peers held back by a full receive buffer or a pending send are tried again after
+    // at most SOCKET_SWEEP_INTERVAL_MS, like the select() polling did.
+    vector<CSocketEvents::Event> events;
+    socketEvents.Wait(fRecvMore ? 0 : SOCKET_SWEEP_INTERVAL_MS, events);
+    boost::this_thread::interruption_point();
 
-            //
-            // Send
-            //
-            if (pNode->hSocket == INVALID_SOCKET)
-                continue;
-            if (FD_ISSET(pNode->hSocket, &fdsetSend)) {
-                TRY_LOCK(pNode->cs_vSend, lockSend);
-                if (lockSend)
-                    pNode->SocketSendData();
-            }
+    bool fAccept = false;
+    for (const auto &event : events) {
+        if (event.pNode == nullptr) {
+            fAccept = true;
+            continue;
+        }
+        if (event.fRecv || event.fError)
+            setNodesRecvPending.insert(event.pNode);
+        if (event.fSend)
+            setNodesSendPending.insert(event.pNode);
+    }
 
-            //
-            // Inactivity checking
-            //
-            if (pNode->vSendMsg.empty())
-                pNode->nLastSendEmpty = GetTime();
-            // p2p_xiaoyu_20191126
-            // if (GetTime() - pNode->nTimeConnected > 60) {
-            //     if (pNode->nLastRecv == 0 || pNode->nLastSend == 0) {
-            //         LogPrint(BCLog::NET, "socket no message in first 60 seconds, %d %d\n", pNode->nLastRecv != 0,
-            //                  pNode->nLastSend != 0);
-            //         pNode->fDisconnect = true;
-            //     } else if (GetTime() - pNode->nLastSend > 90 * 60 && GetTime() - pNode->nLastSendEmpty > 90 * 60) {
-            //         LogPrint(BCLog::INFO, "socket not sending\n");
-            //         pNode->fDisconnect = true;
-            //     } else if (GetTime() - pNode->nLastRecv > 90 * 60) {
-            //         LogPrint(BCLog::INFO, "socket inactivity timeout\n");
-            //         pNode->fDisconnect = true;
-            //     }
-            // }
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pNode->nTimeConnected > DEFAULT_PEER_CONNECT_TIMEOUT)
-            {
-                if (pNode->nLastRecv == 0 || pNode->nLastSend == 0)
-                {
-                    LogPrint(BCLog::NET, "socket no message in first %i seconds, %d %d from %d\n", DEFAULT_PEER_CONNECT_TIMEOUT, pNode->nLastRecv != 0, pNode->nLastSend != 0, pNode->GetId());
-                    pNode->fDisconnect = true;
-                }
-                else if (nTime - pNode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrint(BCLog::NET, "socket sending timeout: %is\n", nTime - pNode->nLastSend);
-                    pNode->fDisconnect = true;
-                }
-                else if (nTime - pNode->nLastRecv > TIMEOUT_INTERVAL )
-                {
-                    LogPrint(BCLog::NET, "socket receive timeout: %is\n", nTime - pNode->nLastRecv);
-                    pNode->fDisconnect = true;
-                }
-                else if (pNode->nPingNonceSent && pNode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrint(BCLog::NET, "ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pNode->nPingUsecStart));
-                    pNode->fDisconnect = true;
-                }
-                else if (!pNode->fSuccessfullyConnected)
-                {
-                    LogPrint(BCLog::NET, "version handshake timeout from %d\n", pNode->GetId());
-                    pNode->fDisconnect = true;
-                }
-            }
+    //
+    // Accept new connections, the listening sockets are non blocking
+    //
+    if (fAccept) {
+        for (auto hListenSocket : vhListenSocket)
+            if (hListenSocket != INVALID_SOCKET)
+                AcceptConnection(hListenSocket);
+    }
+
+    //
+    // Send, first so that a peer which does not read does not get more queued
+    //
+    for (auto it = setNodesSendPending.begin(); it != setNodesSendPending.end();) {
+        CNode* pNode = *it;
+        if (pNode->fDisconnect || pNode->hSocket == INVALID_SOCKET) {
+            it = setNodesSendPending.erase(it);
+            continue;
+        }
+
+        TRY_LOCK(pNode->cs_vSend, lockSend);
+        if (lockSend && !SendNodeData(pNode)) {
+            it = setNodesSendPending.erase(it);
+        } else {
+            ++it;
+        }
+    }
 
+    //
+    // Receive, while the send queue is empty and the receive buffer has room, see the
+    // comment in SocketHandlerSelect()
+    //
+    fRecvMore = false;
+    for (auto it = setNodesRecvPending.begin(); it != setNodesRecvPending.end();) {
+        boost::this_thread::interruption_point();
 
+        CNode* pNode = *it;
+        if (pNode->fDisconnect || pNode->hSocket == INVALID_SOCKET) {
+            it = setNodesRecvPending.erase(it);
+            continue;
         }
 
+        bool fPending = true;
         {
-            LOCK(cs_vNodes);
-            for (auto pNode : vNodesCopy)
-                pNode->Release();
+            TRY_LOCK(pNode->cs_vSend, lockSend);
+            if (lockSend && pNode->vSendMsg.empty()) {
+                TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+                if (lockRecv && CanReceive(pNode)) {
+                    fPending = SocketRecvData(pNode);
+                    fRecvMore |= fPending;
+                }
+            }
         }
+
+        if (fPending)
+            ++it;
+        else
+            it = setNodesRecvPending.erase(it);
+    }
+}
+
+void ThreadSocketHandler() {
+    for (auto hListenSocket : vhListenSocket)
+        socketEvents.AddListenSocket(hListenSocket);
+
+    while (true) {
+        if (socketEvents.IsEpoll())
+            SocketHandlerEpoll();
+        else
+            SocketHandlerSelect();
     }
 }
 
@@ -1170,7 +1316,32 @@ void static StartSync(const vector<CNode*>& vNodes) {
     }
 }
 
-void ThreadMessageHandler() {
+static boost::mutex mtxMessageHandler;
+static boost::condition_variable condMessageHandler;
+static bool fMessageHandlerWake[MAX_MESSAGE_HANDLER_THREADS] = {false};
+static int32_t nMessageHandlers = 1;
+
+int32_t GetMessageHandler(const CNode* pNode) { return pNode->GetId() % nMessageHandlers; }
+
+void WakeMessageHandler(int32_t nWorker) {
+    {
+        boost::unique_lock<boost::mutex> lock(mtxMessageHandler);
+        fMessageHandlerWake[nWorker] = true;
+    }
+    condMessageHandler.notify_all();
+}
+
+void WaitMessageHandler(int32_t nWorker, int64_t timeoutMs) {
+    boost::unique_lock<boost::mutex> lock(mtxMessageHandler);
+    if (!fMessageHandlerWake[nWorker])
+        condMessageHandler.timed_wait(lock, boost::posix_time::milliseconds(timeoutMs));
+    fMessageHandlerWake[nWorker] = false;
+}
+
+// Message handler worker nWorker of nWorkers. Each peer is served by the worker of its
+// id only, so its messages and its SendMessages() run on one thread, in order, and a
+// peer slow to serve only holds up the peers of its own worker.
+void ThreadMessageHandler(int32_t nWorker, int32_t nWorkers) {
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true) {
         bool fHaveSyncNode = false;
@@ -1186,10 +1357,12 @@ void ThreadMessageHandler() {
             }
         }
 
-        if (!fHaveSyncNode)
+        if (nWorker == 0 && !fHaveSyncNode)
             StartSync(vNodesCopy);
 
-        // Poll the connected nodes for messages
+        // Poll the connected nodes for messages. Every worker draws one peer of all and
+        // trickles to it only if it is its own, so about one peer per pass gets its
+        // addresses, whatever the number of workers.
         CNode* pnodeTrickle = nullptr;
         if (!vNodesCopy.empty())
             pnodeTrickle = vNodesCopy[GetRand(vNodesCopy.size())];
@@ -1197,7 +1370,7 @@ void ThreadMessageHandler() {
         bool fSleep = true;
 
         for (auto pNode : vNodesCopy) {
-            if (pNode->fDisconnect)
+            if (pNode->fDisconnect || GetMessageHandler(pNode) != nWorker)
                 continue;
 
             // Receive messages
@@ -1207,7 +1380,7 @@ void ThreadMessageHandler() {
                     if (!GetNodeSignals().ProcessMessages(pNode))
                         pNode->CloseSocketDisconnect();
 
-                    if (pNode->nSendSize < SendBufferSize()) {
+                    if (!pNode->IsSendBufferFull()) {
                         if (!pNode->vRecvGetData.empty() ||
                             (!pNode->vRecvMsg.empty() && pNode->vRecvMsg[0].complete())) {
                             fSleep = false;
@@ -1233,8 +1406,10 @@ void ThreadMessageHandler() {
                 pNode->Release();
         }
 
+        // A wakeup during the pass is kept, so a message completed after its peer was
+        // visited is processed right away
         if (fSleep)
-            MilliSleep(100);
+            WaitMessageHandler(nWorker, MESSAGE_HANDLER_INTERVAL_MS);
     }
 }
 
@@ -1406,6 +1581,16 @@ void StartNode(boost::thread_group& threadGroup) {
     MapPort(SysCfg().GetBoolArg("-upnp", USE_UPNP));
 #endif
 
+    relayCache.SetMaxBytes(SysCfg().GetArg("-maxrelaycache", DEFAULT_MAX_RELAY_CACHE_SIZE) * 1000000);
+
+    uploadLimiter.SetRate(SysCfg().GetArg("-maxuploadrate", DEFAULT_MAX_UPLOAD_RATE) * 1000);
+    if (uploadLimiter.IsLimited())
+        LogPrint(BCLog::INFO, "upload capped to %d KB/s\n", SysCfg().GetArg("-maxuploadrate", DEFAULT_MAX_UPLOAD_RATE));
+
+    // Set before the socket thread wakes the worker of a peer up
+    nMessageHandlers = SysCfg().GetArg("-msghandlerthreads", DEFAULT_MESSAGE_HANDLER_THREADS);
+    nMessageHandlers = std::max(std::min(nMessageHandlers, MAX_MESSAGE_HANDLER_THREADS), 1);
+
     // Send and receive from sockets, accept connections
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "net", &ThreadSocketHandler));
 
@@ -1415,8 +1600,15 @@ void StartNode(boost::thread_group& threadGroup) {
     // Initiate outbound connections
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "opencon", &ThreadOpenConnections));
 
-    // Process messages
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    // Process messages, the peers are spread over the message handler threads
+    for (int32_t i = 0; i < nMessageHandlers; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()>>, "msghand",
+                                              boost::function<void()>(boost::bind(&ThreadMessageHandler, i,
+                                                                                  nMessageHandlers))));
+    LogPrint(BCLog::INFO, "message handler started with %d threads\n", nMessageHandlers);
+
+    // Admit txs received from peers in batches
+    StartTxAdmission(threadGroup);
 
     // Dump network addresses
     threadGroup.create_thread(boost::bind(&LoopForever<void (*)()>, "dumpaddr", &DumpAddresses, DUMP_ADDRESSES_INTERVAL * 1000));
@@ -1471,28 +1663,19 @@ public:
 
 instance_of_cnetcleanup;
 
-void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash) {
+void RelayTransaction(const std::shared_ptr<const CBaseTx>& pBaseTx, const uint256& hash) {
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss.reserve(1000);
-    auto pTx = pBaseTx->GetNewInstance();
-    ss << pTx;
-    RelayTransaction(pBaseTx, hash, ss);
+    ss << pBaseTx;
+    RelayTransaction(pBaseTx.get(), hash, ss);
 }
 
-void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream& ss) {
+void RelayTransaction(const CBaseTx* pBaseTx, const uint256& hash, const CDataStream& ss) {
     CInv inv(MSG_TX, hash);
-    {
-        LOCK(cs_mapRelay);
-        // Expire old relay messages
-        while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime()) {
-            mapRelay.erase(vRelayExpiration.front().second);
-            vRelayExpiration.pop_front();
-        }
+    // Save original serialized message so newer versions are preserved, framed once here
+    // for all the peers asking for it
+    relayCache.Add(hash, MakeSharedNetMessage(NetMsgType::TX, ss));
 
-        // Save original serialized message so newer versions are preserved
-        mapRelay.insert(make_pair(inv, ss));
-        vRelayExpiration.push_back(make_pair(GetTime() + 15 * 60, inv));
-    }
     LOCK(cs_vNodes);
     for (auto pNode : vNodes) {
         if (!pNode->fRelayTxes)
@@ -11,6 +11,7 @@
 #include "crypto/hash.h"
 #include "sync.h"
 #include "netbase.h"
+#include "p2p/netmessage.h"
 
 
 #include <stdint.h>
@@ -38,6 +39,11 @@ static const int TIMEOUT_INTERVAL = 20 * 60;
 
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
+/** Max sleep of the message handler without a wakeup, SendMessages() runs at least that often */
+static const int64_t MESSAGE_HANDLER_INTERVAL_MS  = 100;
+/** -msghandlerthreads default and max */
+static const int32_t DEFAULT_MESSAGE_HANDLER_THREADS = 4;
+static const int32_t MAX_MESSAGE_HANDLER_THREADS     = 16;
 
 inline uint32_t ReceiveFloodSize() { return 1000 * SysCfg().GetArg("-maxreceivebuffer", 5 * 1000); }
 void AddOneShot(string strDest);
@@ -52,6 +58,12 @@ uint16_t GetListenPort();
 bool BindListenPort(const CService& bindAddr, string& strError = REF(string()));
 void StartNode(boost::thread_group& threadGroup);
 bool StopNode();
+/** The ThreadMessageHandler() worker serving pNode */
+int32_t GetMessageHandler(const CNode* pNode);
+/** Wake ThreadMessageHandler() worker nWorker up, one of its peers has work for it */
+void WakeMessageHandler(int32_t nWorker);
+/** Sleep until worker nWorker is woken up or timeoutMs elapses */
+void WaitMessageHandler(int32_t nWorker, int64_t timeoutMs);
 
 enum {
     LOCAL_NONE,    // unknown
@@ -81,15 +93,12 @@ extern CAddrMan addrman;
 extern int32_t nMaxConnections;
 extern vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
-extern map<CInv, CDataStream> mapRelay;
-extern deque<pair<int64_t, CInv> > vRelayExpiration;
-extern CCriticalSection cs_mapRelay;
 extern vector<string> vAddedNodes;
 extern CCriticalSection cs_vAddedNodes;
 extern map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
-void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash);
-void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash, const CDataStream& ss);
+void RelayTransaction(const std::shared_ptr<const CBaseTx>& pBaseTx, const uint256& hash);
+void RelayTransaction(const CBaseTx* pBaseTx, const uint256& hash, const CDataStream& ss);
 
 /** Access to the (IP) address database (peers.dat) */
 class CAddrDB {
@@ -4,11 +4,15 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainmessage.h"
+#include "commons/hasher.h"
+#include "commons/lrucache.hpp"
 #include "commons/uint256.h"
 #include "commons/util/util.h"
 #include "main.h"
 #include "net.h"
 #include "node.h"
+#include "relaycache.h"
+#include "txadmission.h"
 #include "miner/pbftcontext.h"
 #include "miner/pbftmanager.h"
 
@@ -71,26 +75,98 @@ void MarkBlockAsInFlight(const uint256 &hash, NodeId nodeId) {
     mapBlocksInFlight[hash] = std::make_tuple(nodeId, it, GetTimeMicros());
 }
 
+// Blocks recently served framed as block messages, the peers syncing from us ask
+// for the same blocks at about the same time. Protected by cs_rawBlockCache.
+static CCriticalSection cs_rawBlockCache;
+static CLruCache<uint256, CSharedNetMessage, CSaltedUint256Hasher> rawBlockCache(
+    RAW_BLOCK_CACHE_SIZE, [](const pair<uint256, CSharedNetMessage> &item) { return item.second->size(); });
+
+CSharedNetMessage GetRawBlockMessage(const uint256 &blockHash, const CDiskBlockPos &pos) {
+    {
+        LOCK(cs_rawBlockCache);
+        CSharedNetMessage *pMessage = rawBlockCache.Get(blockHash);
+        if (pMessage)
+            return *pMessage;
+    }
+
+    CSerializeData data(CMessageHeader::HEADER_SIZE);
+    if (!ReadRawBlockFromDisk(pos, blockHash, data))
+        return nullptr;
+    CSharedNetMessage spMessage = MakeRawNetMessage(NetMsgType::BLOCK, std::move(data));
+
+    LOCK(cs_rawBlockCache);
+    rawBlockCache.Insert(blockHash, spMessage);
+    return spMessage;
+}
+
+// Trigger them to send a getblocks request for the next batch of inventory
+static void PushContinueInventory(CNode *pFrom, const uint256 &tipHash) {
+    // Bypass PushInventory, this must send even if redundant,
+    // and we want it right after the last block so they don't
+    // wait for other stuff first: queue it with the blocks, not the other invs.
+    vector<CInv> vInv;
+    vInv.push_back(CInv(MSG_BLOCK, tipHash));
+    pFrom->PushSharedMessage(MakeSharedNetMessage(NetMsgType::INV, vInv), SEND_BLOCK);
+    pFrom->hashContinue.SetNull();
+    LogPrint(BCLog::NET, "reset node hashcontinue\n");
+}
+
 void ProcessGetData(CNode *pFrom) {
     deque<CInv>::iterator it = pFrom->vRecvGetData.begin();
 
     vector<CInv> vNotFound;
 
-    LOCK(cs_main);
-
     while (it != pFrom->vRecvGetData.end()) {
-        // Don't bother if send buffer is too full to respond anyway
-        if (pFrom->nSendSize >= SendBufferSize()) {
-            LogPrint(BCLog::NET, "send buffer size: %d full for peer: %s\n", pFrom->nSendSize, pFrom->addr.ToString());
+        const CInv &inv = *it;
+
+        // Don't bother if send buffer is too full to respond anyway, the blocks and the
+        // txs have buffers of their own so that one does not hold the other back
+        SendClass sendClass = (inv.type == MSG_BLOCK || inv.type == MSG_CMPCT_BLOCK) ? SEND_BLOCK : SEND_TX;
+        if (pFrom->IsSendClassFull(sendClass)) {
+            LogPrint(BCLog::NET, "send buffer size: %d full for %s of peer: %s\n", pFrom->vSendMsg.GetClassSize(sendClass),
+                     GetSendClassName(sendClass), pFrom->addr.ToString());
             break;
         }
-
-        const CInv &inv = *it;
         {
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK) {
+            if (inv.type == MSG_BLOCK) {
+                // cs_main is only held to look the block up, it is read from disk and
+                // sent as it is stored without holding back the block validation
+                bool found = false;
+                CDiskBlockPos pos;
+                int32_t height = 0;
+                uint256 tipHash;
+                {
+                    LOCK(cs_main);
+                    auto mi = mapBlockIndex.find(inv.hash);
+                    if (mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
+                        found   = true;
+                        pos     = mi->second->GetBlockPos();
+                        height  = mi->second->height;
+                        tipHash = chainActive.Tip()->GetBlockHash();
+                    }
+                }
+                if (!found) {
+                    LogPrint(BCLog::NET, "block %s not found\n", inv.hash.GetHex());
+                    continue;
+                }
+
+                CSharedNetMessage spMessage = GetRawBlockMessage(inv.hash, pos);
+                if (!spMessage) {
+                    LogPrint(BCLog::NET, "block %s can not be read\n", inv.hash.GetHex());
+                    continue;
+                }
+                LogPrint(BCLog::NET, "send block[%u]: %s to peer %s\n", height, inv.hash.GetHex(),
+                         pFrom->addr.ToString());
+                pFrom->PushSharedMessage(spMessage);
+
+                if (inv.hash == pFrom->hashContinue)
+                    PushContinueInventory(pFrom, tipHash);
+
+            } else if (inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK) {
+                LOCK(cs_main);
                 auto mi = mapBlockIndex.find(inv.hash);
                 if (mi == mapBlockIndex.end()) {
                     LogPrint(BCLog::NET, "block %s not found\n", inv.hash.GetHex());
@@ -98,11 +174,16 @@ void ProcessGetData(CNode *pFrom) {
                 } else { // Load block from disk and send it
                     CBlock block;
                     ReadBlockFromDisk((*mi).second, block);
-                    if (inv.type == MSG_BLOCK) {
-                        LogPrint(BCLog::NET, "send block[%u]: %s to peer %s\n", block.GetHeight(), block.GetHash().GetHex(),
-                                 pFrom->addr.ToString());
-
-                        pFrom->PushMessage(NetMsgType::BLOCK, block);
+                    if (inv.type == MSG_CMPCT_BLOCK) {
+                        // the mempool of the peer is of no help for an old block
+                        if (chainActive.Height() - (*mi).second->height <= MAX_CMPCTBLOCK_DEPTH) {
+                            LogPrint(BCLog::NET, "send cmpctblock[%u]: %s to peer %s\n", block.GetHeight(),
+                                     block.GetHash().GetHex(), pFrom->addr.ToString());
+                            pFrom->PushMessage(NetMsgType::CMPCTBLOCK,
+                                               CCompactBlock(block, GetRand(std::numeric_limits<uint64_t>::max())));
+                        } else {
+                            pFrom->PushMessage(NetMsgType::BLOCK, block);
+                        }
 
                     } else  {// MSG_FILTERED_BLOCK)
                         LOCK(pFrom->cs_filter);
@@ -123,31 +204,21 @@ void ProcessGetData(CNode *pFrom) {
                         // no response
                     }
 
-                    // Trigger them to send a getblocks request for the next batch of inventory
-                    if (inv.hash == pFrom->hashContinue) {
-                        // Bypass PushInventory, this must send even if redundant,
-                        // and we want it right after the last block so they don't
-                        // wait for other stuff first.
-                        vector<CInv> vInv;
-                        vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
-                        pFrom->PushMessage(NetMsgType::INV, vInv);
-                        pFrom->hashContinue.SetNull();
-                        LogPrint(BCLog::NET, "reset node hashcontinue\n");
-                    }
+                    if (inv.hash == pFrom->hashContinue)
+                        PushContinueInventory(pFrom, chainActive.Tip()->GetBlockHash());
                 }
             } else if (inv.IsKnownType()) {
                 // Send stream from relay memory
                 bool pushed = false;
-                {
-                    LOCK(cs_mapRelay);
-                    auto mi = mapRelay.find(inv);
-                    if (mi != mapRelay.end()) {
-                        pFrom->PushMessage(inv.GetCommand(), (*mi).second);
+                if (inv.type == MSG_TX) {
+                    CSharedNetMessage spMessage = relayCache.Get(inv.hash);
+                    if (spMessage) {
+                        pFrom->PushSharedMessage(spMessage);
                         pushed = true;
                     }
                 }
                 if (!pushed && inv.type == MSG_TX) {
-                    std::shared_ptr<CBaseTx> pBaseTx = mempool.Lookup(inv.hash);
+                    std::shared_ptr<const CBaseTx> pBaseTx = mempool.Lookup(inv.hash);
                     if (pBaseTx && !pBaseTx->IsRelayForbidden()) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000); //FIXME: hardcoding here
@@ -302,6 +373,12 @@ int32_t ProcessVersionMessage(CNode *pFrom, string strCommand, CDataStream &vRec
     pFrom->PushMessage(NetMsgType::VERACK);
     pFrom->ssSend.SetVersion(min(pFrom->nVersion, PROTOCOL_VERSION));
 
+    // Nodes not knowing the message ignore it, and keep getting full blocks
+    pFrom->PushMessage(NetMsgType::SENDCMPCT, COMPACT_BLOCKS_VERSION);
+    // and keep getting all the txs in invs
+    if (SysCfg().GetBoolArg("-txreconciliation", true))
+        pFrom->PushMessage(NetMsgType::SENDRECON, TXRECON_VERSION, pFrom->nTxReconSalt);
+
     if (!pFrom->fInbound) {
         // Advertise our address
         if (!fNoListen && !IsInitialBlockDownload()) {
@@ -479,14 +556,22 @@ bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv) {
     pFrom->AddInventoryKnown(inv);
 
     if(IsInitialBlockDownload()){
-        RelayTransaction(pBaseTx.get(), inv.hash);
+        RelayTransaction(pBaseTx, inv.hash);
+        return true;
+    }
+
+    // Batched admission: verified on the worker pool, executed and relayed by the dispatcher
+    if (txAdmissionQueue.IsRunning()) {
+        if (!txAdmissionQueue.Push(pFrom, pBaseTx))
+            LogPrint(BCLog::NET, "tx admission queue full, drop tx %s from peer %s\n", inv.hash.ToString(),
+                     pFrom->addr.ToString());
         return true;
     }
 
     LOCK(cs_main);
     CValidationState state;
-    if (AcceptToMemoryPool(mempool, state, pBaseTx.get(), true)) {
-        RelayTransaction(pBaseTx.get(), inv.hash);
+    if (AcceptToMemoryPool(mempool, state, pBaseTx, true)) {
+        RelayTransaction(pBaseTx, inv.hash);
         mapAlreadyAskedFor.erase(inv);
 
         LogPrint(BCLog::NET, "[%d]~ %s %s : accepted %s (poolsz %u)\n", pBaseTx->valid_height, pFrom->addr.ToString(),
@@ -519,7 +604,7 @@ bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
     CBlockIndex *pIndex = nullptr;
     if (locator.IsNull()) {
         // If locator is null, return the hashStop block
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hashStop);
+        BlockMap::iterator mi = mapBlockIndex.find(hashStop);
         if (mi == mapBlockIndex.end())
             return true;
 
@@ -694,14 +779,8 @@ bool ProcessGetDataMessage(CNode *pFrom, CDataStream &vRecv) {
     return true;
 }
 
-void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
-    CBlock block;
-    vRecv >> block;
-
-    LogPrint(BCLog::NET, "recv block! time_ms=%lld, hash=%s, peer=%s\n", GetTimeMillis(),
-        block.GetHash().ToString(), pFrom->addr.ToString());
-    // block.Print();
-
+// A block received in full or rebuilt from a compact block
+static void ProcessReceivedBlock(CNode *pFrom, CBlock &block) {
     CInv inv(MSG_BLOCK, block.GetHash());
     pFrom->AddInventoryKnown(inv);
 
@@ -721,7 +800,335 @@ void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
     } else {
         ProcessBlock(state, pFrom, &block);
     }
+}
+
+void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlock block;
+    vRecv >> block;
+
+    LogPrint(BCLog::NET, "recv block! time_ms=%lld, hash=%s, peer=%s\n", GetTimeMillis(),
+        block.GetHash().ToString(), pFrom->addr.ToString());
+    // block.Print();
+
+    ProcessReceivedBlock(pFrom, block);
+}
+
+static void RequestFullBlock(CNode *pFrom, const uint256 &blockHash) {
+    LogPrint(BCLog::NET, "compact block %s can not be rebuilt, request the full block from peer %s\n",
+             blockHash.ToString(), pFrom->addr.ToString());
+    pFrom->PushMessage(NetMsgType::GETDATA, vector<CInv>(1, CInv(MSG_BLOCK, blockHash)));
+}
+
+// Requires cs_main.
+static void ProcessRebuiltBlock(CNode *pFrom, const CPartialBlock &partialBlock,
+                                const vector<std::shared_ptr<CBaseTx> > &missingTxs) {
+    uint256 blockHash = partialBlock.header.GetHash();
+    CBlock block;
+    CPartialBlock::ReadStatus status = partialBlock.FillBlock(block, missingTxs);
+    if (status == CPartialBlock::READ_INVALID) {
+        LogPrint(BCLog::INFO, "Misbehaving: invalid blocktxn for block %s from peer %s, Misbehavior add 100\n",
+                 blockHash.ToString(), pFrom->addr.ToString());
+        Misbehaving(pFrom->GetId(), 100);
+        return;
+    } else if (status == CPartialBlock::READ_FAILED) {
+        RequestFullBlock(pFrom, blockHash);
+        return;
+    }
+
+    LogPrint(BCLog::NET, "rebuilt block! time_ms=%lld, hash=%s, txs=%u, prefilled=%u, mempool=%u, requested=%u, "
+             "peer=%s\n", GetTimeMillis(), blockHash.ToString(), block.vptx.size(), partialBlock.nPrefilledTxs,
+             partialBlock.nAvailableTxs, missingTxs.size(), pFrom->addr.ToString());
+
+    ProcessReceivedBlock(pFrom, block);
+}
+
+// A compact block costs a mempool scan and a getblocktxn round trip, its header is checked
+// as in CheckBlock() and it must be signed by the producer of its prefilled reward tx
+// before. Whether the producer has the slot is left to the rebuilt block. Requires cs_main.
+static bool CheckCompactBlockHeader(const CCompactBlock &cmpctblock, CValidationState &state) {
+    const CBlockHeader &header = cmpctblock.header;
+    if (header.GetVersion() != CBlockHeader::CURRENT_VERSION)
+        return state.DoS(100, ERRORMSG("block version error"), REJECT_INVALID, "block-version-error");
+
+    if (header.GetBlockTime() > GetAdjustedTime() + ::GetBlockInterval(header.GetHeight()) + 2)
+        return state.Invalid(ERRORMSG("block timestamp too far in the future"), REJECT_INVALID, "time-too-new");
+
+    if (header.GetNonce() > SysCfg().GetBlockMaxNonce())
+        return state.Invalid(ERRORMSG("nonce is larger than maxNonce"), REJECT_INVALID, "Nonce-too-large");
+
+    if (cmpctblock.prefilledTxs.empty() || cmpctblock.prefilledTxs[0].index != 0 ||
+        !cmpctblock.prefilledTxs[0].pBaseTx || !cmpctblock.prefilledTxs[0].pBaseTx->IsBlockRewardTx())
+        return state.DoS(100, ERRORMSG("first tx is not coinbase"), REJECT_INVALID, "bad-cb-missing");
+
+    CAccount account;
+    if (!pCdMan->pAccountCache->GetAccount(cmpctblock.prefilledTxs[0].pBaseTx->txUid, account))
+        return state.Invalid(ERRORMSG("unknown producer %s", cmpctblock.prefilledTxs[0].pBaseTx->txUid.ToString()),
+                             REJECT_INVALID, "bad-producer");
+
+    uint256 blockHash                 = header.GetHash();
+    const vector<uint8_t> &signature = header.GetSignature();
+    if (signature.empty() || signature.size() > MAX_SIGNATURE_SIZE ||
+        (!VerifySignature(blockHash, signature, account.owner_pubkey) &&
+         !VerifySignature(blockHash, signature, account.miner_pubkey)))
+        return state.DoS(100, ERRORMSG("verify signature error"), REJECT_INVALID, "bad-block-signature");
+
+    return true;
+}
+
+void ProcessCompactBlockMessage(CNode *pFrom, CDataStream &vRecv) {
+    CCompactBlock cmpctblock;
+    vRecv >> cmpctblock;
+
+    uint256 blockHash = cmpctblock.header.GetHash();
+    LogPrint(BCLog::NET, "recv cmpctblock! time_ms=%lld, hash=%s, txs=%u, prefilled=%u, peer=%s\n", GetTimeMillis(),
+             blockHash.ToString(), cmpctblock.GetTxCount(), cmpctblock.prefilledTxs.size(), pFrom->addr.ToString());
+
+    CInv inv(MSG_BLOCK, blockHash);
+    pFrom->AddInventoryKnown(inv);
+
+    LOCK(cs_main);
+    if (AlreadyHave(inv)) {
+        LOCK(cs_mapNodeState);
+        MarkBlockAsReceived(blockHash, pFrom->GetId());
+        return;
+    }
+
+    CValidationState state;
+    if (!CheckCompactBlockHeader(cmpctblock, state)) {
+        int32_t nDoS = 0;
+        if (state.IsInvalid(nDoS) && nDoS > 0) {
+            LogPrint(BCLog::INFO, "Misbehaving: invalid cmpctblock %s header from peer %s, Misbehavior add %d\n",
+                     blockHash.ToString(), pFrom->addr.ToString(), nDoS);
+            Misbehaving(pFrom->GetId(), nDoS);
+        }
+        return;
+    }
+
+    // an orphan goes through the full block path, which knows how to fetch its parents
+    auto miPrev = mapBlockIndex.find(cmpctblock.header.GetPrevBlockHash());
+    if (miPrev == mapBlockIndex.end()) {
+        RequestFullBlock(pFrom, blockHash);
+        return;
+    }
+
+    if (cmpctblock.header.GetHeight() != (uint32_t)miPrev->second->height + 1) {
+        LogPrint(BCLog::INFO, "Misbehaving: cmpctblock %s height %u after block %d from peer %s, Misbehavior add 100\n",
+                 blockHash.ToString(), cmpctblock.header.GetHeight(), miPrev->second->height, pFrom->addr.ToString());
+        Misbehaving(pFrom->GetId(), 100);
+        return;
+    }
+
+    auto pPartialBlock = std::make_shared<CPartialBlock>();
+    CPartialBlock::ReadStatus status = pPartialBlock->InitData(cmpctblock);
+    if (status == CPartialBlock::READ_INVALID) {
+        LogPrint(BCLog::INFO, "Misbehaving: invalid cmpctblock %s from peer %s, Misbehavior add 100\n",
+                 blockHash.ToString(), pFrom->addr.ToString());
+        Misbehaving(pFrom->GetId(), 100);
+        return;
+    } else if (status == CPartialBlock::READ_FAILED) {
+        RequestFullBlock(pFrom, blockHash);
+        return;
+    }
+
+    pPartialBlock->AddMemPoolTxs(mempool);
+
+    CBlockTxnRequest request;
+    request.blockHash = blockHash;
+    pPartialBlock->GetMissingIndexes(request.indexes);
+    if (request.indexes.empty()) {
+        ProcessRebuiltBlock(pFrom, *pPartialBlock, vector<std::shared_ptr<CBaseTx> >());
+        return;
+    }
+
+    {
+        // one block at a time per peer, a newer one replaces it
+        LOCK(cs_mapNodeState);
+        CNodeState *state = State(pFrom->GetId());
+        if (state == nullptr)
+            return;
+        state->pPartialBlock = pPartialBlock;
+    }
+    LogPrint(BCLog::NET, "send getblocktxn! hash=%s, missing=%u of %u, peer=%s\n", blockHash.ToString(),
+             request.indexes.size(), cmpctblock.GetTxCount(), pFrom->addr.ToString());
+    pFrom->PushMessage(NetMsgType::GETBLOCKTXN, request);
+}
+
+void ProcessGetBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTxnRequest request;
+    vRecv >> request;
+
+    LOCK(cs_main);
+    auto mi = mapBlockIndex.find(request.blockHash);
+    if (mi == mapBlockIndex.end()) {
+        LogPrint(BCLog::NET, "getblocktxn for unknown block %s from peer %s\n", request.blockHash.ToString(),
+                 pFrom->addr.ToString());
+        return;
+    }
+
+    // only the recent blocks were sent as compact blocks, an old one is not read from disk for it
+    if (chainActive.Height() - mi->second->height > MAX_BLOCKTXN_DEPTH) {
+        LogPrint(BCLog::NET, "getblocktxn for block %s %d blocks deep from peer %s, ignored\n",
+                 request.blockHash.ToString(), chainActive.Height() - mi->second->height, pFrom->addr.ToString());
+        return;
+    }
+
+    CBlock block;
+    if (!ReadBlockFromDisk(mi->second, block)) {
+        LogPrint(BCLog::NET, "read block %s for getblocktxn failed\n", request.blockHash.ToString());
+        return;
+    }
+
+    CBlockTxn response;
+    response.blockHash = request.blockHash;
+    response.txs.reserve(request.indexes.size());
+    for (auto index : request.indexes) {
+        if (index >= block.vptx.size()) {
+            LogPrint(BCLog::INFO, "Misbehaving: getblocktxn index %u out of %u txs from peer %s, Misbehavior add 100\n",
+                     index, block.vptx.size(), pFrom->addr.ToString());
+            Misbehaving(pFrom->GetId(), 100);
+            return;
+        }
+        response.txs.push_back(block.vptx[index]);
+    }
+
+    pFrom->PushMessage(NetMsgType::BLOCKTXN, response);
+}
+
+void ProcessBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTxn response;
+    vRecv >> response;
+
+    LOCK(cs_main);
+    std::shared_ptr<CPartialBlock> pPartialBlock;
+    {
+        LOCK(cs_mapNodeState);
+        CNodeState *state = State(pFrom->GetId());
+        if (state == nullptr || !state->pPartialBlock ||
+            state->pPartialBlock->header.GetHash() != response.blockHash) {
+            LogPrint(BCLog::NET, "unrequested blocktxn for block %s from peer %s\n", response.blockHash.ToString(),
+                     pFrom->addr.ToString());
+            return;
+        }
+        pPartialBlock = state->pPartialBlock;
+        state->pPartialBlock.reset();
+    }
+
+    if (AlreadyHave(CInv(MSG_BLOCK, response.blockHash)))
+        return;
+
+    ProcessRebuiltBlock(pFrom, *pPartialBlock, response.txs);
+}
+
+// Announce the txs of a reconciliation, the peer knows them afterwards
+static void PushReconciledInventory(CNode *pFrom, const vector<uint256> &txids) {
+    vector<CInv> vInv;
+    for (const auto &txid : txids) {
+        vInv.push_back(CInv(MSG_TX, txid));
+        pFrom->AddInventoryKnown(vInv.back());
+        if (vInv.size() >= MAX_INV_SZ) {
+            pFrom->PushMessage(NetMsgType::INV, vInv);
+            vInv.clear();
+        }
+    }
+    if (!vInv.empty())
+        pFrom->PushMessage(NetMsgType::INV, vInv);
+}
+
+void ProcessSendReconMessage(CNode *pFrom, CDataStream &vRecv) {
+    uint32_t nReconVersion = 0;
+    uint64_t nSalt         = 0;
+    vRecv >> nReconVersion >> nSalt;
+    if (nReconVersion != TXRECON_VERSION || !SysCfg().GetBoolArg("-txreconciliation", true))
+        return;
+
+    // The first outbound peers still get the txs flooded, they keep the relay latency low.
+    // cs_vNodes is held until the state is set, two peers can not both take the last slot
+    LOCK(cs_vNodes);
+    bool fFlood = false;
+    if (!pFrom->fInbound) {
+        int32_t nFlooded = 0;
+        for (auto pNode : vNodes) {
+            LOCK(pNode->cs_inventory);
+            if (pNode != pFrom && !pNode->fInbound && pNode->pTxRecon && pNode->pTxRecon->fFlood)
+                nFlooded++;
+        }
+        fFlood = nFlooded < TXRECON_FLOOD_OUTBOUND_PEERS;
+    }
+
+    {
+        LOCK(pFrom->cs_inventory);
+        if (pFrom->pTxRecon)
+            return;
+
+        pFrom->pTxRecon.reset(new CTxReconState(!pFrom->fInbound, pFrom->nTxReconSalt, nSalt));
+        pFrom->pTxRecon->fFlood = fFlood;
+    }
+    LogPrint(BCLog::NET, "tx reconciliation with peer %s, initiator=%d, flood=%d\n", pFrom->addr.ToString(),
+             !pFrom->fInbound, fFlood);
+}
+
+void ProcessReqReconMessage(CNode *pFrom, CDataStream &vRecv) {
+    CReconRequest request;
+    vRecv >> request;
+
+    CReconSketch sketch;
+    {
+        LOCK(pFrom->cs_inventory);
+        if (!pFrom->pTxRecon || !pFrom->pTxRecon->ProcessRequest(request, GetTime(), sketch)) {
+            LogPrint(BCLog::INFO, "Misbehaving: unexpected reqrecon from peer %s, Misbehavior add 10\n",
+                     pFrom->addr.ToString());
+            Misbehaving(pFrom->GetId(), 10);
+            return;
+        }
+    }
+
+    pFrom->PushMessage(NetMsgType::SKETCH, sketch);
+}
+
+void ProcessSketchMessage(CNode *pFrom, CDataStream &vRecv) {
+    CReconSketch sketch;
+    vRecv >> sketch;
+
+    vector<uint256> txids;
+    CReconDiff diff;
+    {
+        LOCK(pFrom->cs_inventory);
+        if (!pFrom->pTxRecon || !pFrom->pTxRecon->ProcessSketch(sketch, txids, diff)) {
+            LogPrint(BCLog::INFO, "Misbehaving: unexpected sketch from peer %s, Misbehavior add 10\n",
+                     pFrom->addr.ToString());
+            Misbehaving(pFrom->GetId(), 10);
+            return;
+        }
+    }
+
+    // the round failed, the diff and the invs still go out
+    if (!sketch.IsValid()) {
+        LogPrint(BCLog::INFO, "Misbehaving: invalid sketch from peer %s, Misbehavior add 10\n", pFrom->addr.ToString());
+        Misbehaving(pFrom->GetId(), 10);
+    }
+
+    LogPrint(BCLog::NET, "reconciled with peer %s: %s, %u txs to announce, %u to ask for\n", pFrom->addr.ToString(),
+             diff.fSuccess ? "decoded" : "failed", txids.size(), diff.shortIds.size());
+    pFrom->PushMessage(NetMsgType::RECONCILDIFF, diff);
+    PushReconciledInventory(pFrom, txids);
+}
+
+void ProcessReconcilDiffMessage(CNode *pFrom, CDataStream &vRecv) {
+    CReconDiff diff;
+    vRecv >> diff;
+
+    vector<uint256> txids;
+    {
+        LOCK(pFrom->cs_inventory);
+        if (!pFrom->pTxRecon || !pFrom->pTxRecon->ProcessDiff(diff, txids)) {
+            LogPrint(BCLog::INFO, "Misbehaving: unexpected reconcildiff from peer %s, Misbehavior add 10\n",
+                     pFrom->addr.ToString());
+            Misbehaving(pFrom->GetId(), 10);
+            return;
+        }
+    }
 
+    PushReconciledInventory(pFrom, txids);
 }
 
 void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv) {
@@ -732,7 +1139,7 @@ void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv) {
     vector<CInv> vInv;
     for (auto &hash : vtxid) {
         CInv inv(MSG_TX, hash);
-        std::shared_ptr<CBaseTx> pBaseTx = mempool.Lookup(hash);
+        std::shared_ptr<const CBaseTx> pBaseTx = mempool.Lookup(hash);
         if (pBaseTx.get())
             continue;  // another thread removed since queryHashes, maybe...
 
@@ -12,6 +12,7 @@
 #include "main.h"
 #include "addrman.h"
 #include "net.h"
+#include "p2p/compactblock.h"
 #include "miner/pbftcontext.h"
 #include "miner/pbftmanager.h"
 
@@ -25,6 +26,7 @@ static const int64_t MINER_NODE_BLOCKS_TO_DOWNLOAD_TIMEOUT   = 2;   // 2 seconds
 static const int64_t MINER_NODE_BLOCKS_IN_FLIGHT_TIMEOUT     = 1;   // 1 seconds
 static const int64_t WITNESS_NODE_BLOCKS_TO_DOWNLOAD_TIMEOUT = 20;  // 20 seconds
 static const int64_t WITNESS_NODE_BLOCKS_IN_FLIGHT_TIMEOUT   = 10;  // 10 seconds
+static const uint32_t RAW_BLOCK_CACHE_SIZE                  = 32 * 1024 * 1024;  // block messages served, in bytes
 
 class CNode;
 class CDataStream;
@@ -51,6 +53,10 @@ struct COrphanBlock {
 
 static CMedianFilter<int32_t> cPeerBlockCounts(8, 0);
 
+// The block message for the block at pos, framed from the bytes on disk without
+// deserializing the block, nullptr if it can not be read
+CSharedNetMessage GetRawBlockMessage(const uint256 &blockHash, const CDiskBlockPos &pos);
+
 void ProcessGetData(CNode *pFrom);
 
 bool AlreadyHave(const CInv &inv);
@@ -76,6 +82,20 @@ bool ProcessGetDataMessage(CNode *pFrom, CDataStream &vRecv);
 
 void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv);
 
+void ProcessCompactBlockMessage(CNode *pFrom, CDataStream &vRecv);
+
+void ProcessGetBlockTxnMessage(CNode *pFrom, CDataStream &vRecv);
+
+void ProcessBlockTxnMessage(CNode *pFrom, CDataStream &vRecv);
+
+void ProcessSendReconMessage(CNode *pFrom, CDataStream &vRecv);
+
+void ProcessReqReconMessage(CNode *pFrom, CDataStream &vRecv);
+
+void ProcessSketchMessage(CNode *pFrom, CDataStream &vRecv);
+
+void ProcessReconcilDiffMessage(CNode *pFrom, CDataStream &vRecv);
+
 void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv);
 
 void ProcessAlertMessage(CNode *pFrom, CDataStream &vRecv);
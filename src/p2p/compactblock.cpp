@@ -0,0 +1,129 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "compactblock.h"
+
+#include "crypto/hash.h"
+#include "crypto/siphash.h"
+#include "tx/txmempool.h"
+
+CCompactBlock::CCompactBlock(const CBlock &block, uint64_t nonceIn) : header(block), nonce(nonceIn) {
+    SetShortTxIdKeys();
+
+    for (uint32_t i = 0; i < block.vptx.size(); i++) {
+        const auto &pBaseTx = block.vptx[i];
+        if (pBaseTx->IsBlockRewardTx() || pBaseTx->IsPriceMedianTx())
+            prefilledTxs.emplace_back(i, pBaseTx);
+        else
+            shortTxIds.push_back(GetShortTxId(pBaseTx->GetHash()));
+    }
+}
+
+void CCompactBlock::SetShortTxIdKeys() {
+    CHashWriter hasher(SER_GETHASH, 0);
+    hasher << header << nonce;
+    uint256 hash = hasher.GetHash();
+    k0           = hash.GetUint64(0);
+    k1           = hash.GetUint64(1);
+}
+
+uint64_t CCompactBlock::GetShortTxId(const uint256 &txid) const { return SipHashUint256(k0, k1, txid); }
+
+CPartialBlock::ReadStatus CPartialBlock::InitData(const CCompactBlock &cmpctblockIn) {
+    cmpctblock = cmpctblockIn;
+    header     = cmpctblock.header;
+
+    size_t count = cmpctblock.GetTxCount();
+    if (count == 0 || count > MAX_CMPCTBLOCK_TXS)
+        return READ_INVALID;
+
+    txs.assign(count, nullptr);
+    claims.assign(count, 0);
+
+    int64_t lastIndex = -1;
+    for (const auto &prefilledTx : cmpctblock.prefilledTxs) {
+        if (!prefilledTx.pBaseTx || prefilledTx.index <= lastIndex || prefilledTx.index >= count)
+            return READ_INVALID;
+
+        txs[prefilledTx.index] = prefilledTx.pBaseTx;
+        lastIndex              = prefilledTx.index;
+    }
+    nPrefilledTxs = cmpctblock.prefilledTxs.size();
+
+    // the short ids take the slots left over, in order
+    shortTxIdIndexes.reserve(cmpctblock.shortTxIds.size());
+    uint32_t index = 0;
+    for (auto shortTxId : cmpctblock.shortTxIds) {
+        while (txs[index])
+            index++;
+        // two txs of the block with one short id, their slots can not be told apart
+        if (!shortTxIdIndexes.emplace(shortTxId, index).second)
+            return READ_FAILED;
+        index++;
+    }
+
+    return READ_OK;
+}
+
+void CPartialBlock::AddAvailableTx(const uint256 &txid, const std::shared_ptr<const CBaseTx> &pBaseTx) {
+    auto it = shortTxIdIndexes.find(cmpctblock.GetShortTxId(txid));
+    if (it == shortTxIdIndexes.end())
+        return;
+
+    uint32_t index = it->second;
+    if (claims[index] == 0) {
+        txs[index] = pBaseTx;
+        nAvailableTxs++;
+    } else if (claims[index] == 1 && txs[index]->GetHash() != txid) {
+        // we have two txs with the short id of the slot, leave it to the getblocktxn
+        txs[index] = nullptr;
+        nAvailableTxs--;
+    }
+
+    if (claims[index] < 2)
+        claims[index]++;
+}
+
+void CPartialBlock::AddMemPoolTxs(const CTxMemPool &pool) {
+    LOCK(pool.cs);
+    for (const auto &item : pool.memPoolTxs) {
+        AddAvailableTx(item.first, item.second.GetTransaction());
+        if (nAvailableTxs == cmpctblock.shortTxIds.size())
+            break;
+    }
+}
+
+void CPartialBlock::GetMissingIndexes(vector<uint32_t> &indexes) const {
+    for (uint32_t i = 0; i < txs.size(); i++) {
+        if (!txs[i])
+            indexes.push_back(i);
+    }
+}
+
+CPartialBlock::ReadStatus CPartialBlock::FillBlock(CBlock &block,
+                                                   const vector<std::shared_ptr<CBaseTx> > &missingTxs) const {
+    block = CBlock(header);
+    block.vptx.reserve(txs.size());
+
+    size_t next = 0;
+    for (const auto &pBaseTx : txs) {
+        if (pBaseTx) {
+            // the block keeps its txs and executes them when it is connected, outside of the mempool, a copy
+            // of the mempool tx costs what deserializing it from a full block would
+            block.vptx.push_back(pBaseTx->GetNewInstance());
+            continue;
+        }
+        if (next == missingTxs.size() || !missingTxs[next])
+            return READ_INVALID;
+        block.vptx.push_back(missingTxs[next++]);
+    }
+    if (next != missingTxs.size())
+        return READ_INVALID;
+
+    // a tx of ours taken for the one of the block with the same short id
+    if (block.BuildMerkleTree() != header.GetMerkleRootHash())
+        return READ_FAILED;
+
+    return READ_OK;
+}
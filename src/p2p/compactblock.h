@@ -0,0 +1,147 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_COMPACTBLOCK_H
+#define P2P_COMPACTBLOCK_H
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+#include "persistence/block.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+class CTxMemPool;
+
+/** Compact block version announced by sendcmpct */
+static const uint64_t COMPACT_BLOCKS_VERSION = 1;
+/** Blocks deeper than this below the tip are sent in full to a MSG_CMPCT_BLOCK getdata */
+static const int32_t MAX_CMPCTBLOCK_DEPTH    = 10;
+/** Blocks deeper than this below the tip are not read for a getblocktxn, the tip may move on meanwhile */
+static const int32_t MAX_BLOCKTXN_DEPTH      = 15;
+/** Txs of a compact block: all but the prefilled ones carry a signature of 64 bytes or more */
+static const uint32_t MAX_CMPCTBLOCK_TXS     = MAX_BLOCK_SIZE / 64;
+
+/** A tx sent in full in a compact block, with its index in the block */
+class CPrefilledTx {
+public:
+    uint32_t index;
+    std::shared_ptr<CBaseTx> pBaseTx;
+
+    CPrefilledTx() : index(0) {}
+    CPrefilledTx(uint32_t indexIn, const std::shared_ptr<CBaseTx> &pBaseTxIn) : index(indexIn), pBaseTx(pBaseTxIn) {}
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(index);
+        READWRITE(pBaseTx);
+    )
+};
+
+/**
+ * The cmpctblock message: the block header, the short ids of the txs the receiver is
+ * expected to have in its mempool and the txs it can not have, prefilled.
+ *
+ * A short id is the SipHash-2-4 of the txid, keyed with the hash of the header and of a
+ * nonce drawn by the sender, so that the ids colliding within a mempool differ from one
+ * block to the next and can not be aimed at.
+ */
+class CCompactBlock {
+public:
+    CBlockHeader header;
+    uint64_t nonce;
+    vector<uint64_t> shortTxIds;        // txs not prefilled, in block order
+    vector<CPrefilledTx> prefilledTxs;  // in ascending index order
+
+public:
+    CCompactBlock() : nonce(0) {}
+    // The block reward and the price median txs are prefilled, they are never relayed
+    CCompactBlock(const CBlock &block, uint64_t nonceIn);
+
+    size_t GetTxCount() const { return shortTxIds.size() + prefilledTxs.size(); }
+    uint64_t GetShortTxId(const uint256 &txid) const;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(header);
+        READWRITE(nonce);
+        READWRITE(shortTxIds);
+        READWRITE(prefilledTxs);
+        if (fRead)
+            const_cast<CCompactBlock *>(this)->SetShortTxIdKeys();
+    )
+
+private:
+    void SetShortTxIdKeys();
+
+    uint64_t k0 = 0, k1 = 0;  // memory only
+};
+
+/** The getblocktxn message: the indexes of the txs missing to rebuild a compact block */
+class CBlockTxnRequest {
+public:
+    uint256 blockHash;
+    vector<uint32_t> indexes;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(indexes);
+    )
+};
+
+/** The blocktxn message: the txs a getblocktxn asked for, in the same order */
+class CBlockTxn {
+public:
+    uint256 blockHash;
+    vector<std::shared_ptr<CBaseTx> > txs;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(txs);
+    )
+};
+
+/**
+ * A block being rebuilt from a compact block: the prefilled txs are placed first, then
+ * the txs we already have fill the slots of their short ids, and the rest is asked for
+ * with a getblocktxn.
+ *
+ * A slot that two of our txs claim is left empty and asked for. A wrong tx taken for its
+ * short id shows up as a merkle root mismatch in FillBlock(), the block is then asked
+ * for in full.
+ */
+class CPartialBlock {
+public:
+    enum ReadStatus {
+        READ_OK,
+        READ_INVALID,  // the peer sent a malformed message
+        READ_FAILED,   // can not be rebuilt, ask for the full block
+    };
+
+    CBlockHeader header;
+
+    // Reconstruction stats of the block
+    uint32_t nPrefilledTxs = 0;
+    uint32_t nAvailableTxs = 0;  // found by their short id
+
+public:
+    ReadStatus InitData(const CCompactBlock &cmpctblock);
+    // Offer a tx we have, it takes the slot of its short id if there is one
+    void AddAvailableTx(const uint256 &txid, const std::shared_ptr<const CBaseTx> &pBaseTx);
+    // Offer all the txs of the mempool
+    void AddMemPoolTxs(const CTxMemPool &pool);
+
+    void GetMissingIndexes(vector<uint32_t> &indexes) const;
+    // Build the block with the txs a getblocktxn for GetMissingIndexes() got
+    ReadStatus FillBlock(CBlock &block, const vector<std::shared_ptr<CBaseTx> > &missingTxs) const;
+
+private:
+    CCompactBlock cmpctblock;
+    vector<std::shared_ptr<const CBaseTx> > txs;   // shared with the mempool, copied into the block
+    vector<uint8_t> claims;                        // number of our txs that claimed each slot
+    unordered_map<uint64_t, uint32_t> shortTxIdIndexes;
+};
+
+#endif  // P2P_COMPACTBLOCK_H
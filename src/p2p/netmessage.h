@@ -9,6 +9,8 @@
 #include "commons/serialize.h"
 #include "p2p/protocol.h"
 
+#include <memory>
+
 class CNetMessage {
 public:
     bool in_data;  // parsing header (false) or data (true)
@@ -42,6 +44,14 @@ public:
     int32_t readData(const char* pch, uint32_t nBytes);
 };
 
+/**
+ * A message framed once, header and checksum included, that the send queues of all the
+ * peers it is broadcast to hold by reference: a block sent to 100 peers is serialized
+ * and hashed once instead of 100 times, and sits in memory once until the slowest peer
+ * has taken it.
+ */
+typedef std::shared_ptr<const CSerializeData> CSharedNetMessage;
+
 
 
 #endif //WAYKICHAIN_NETMESSAGE_H
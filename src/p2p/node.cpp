@@ -57,26 +57,79 @@ CNodeState *State(NodeId pNode) {
     return &it->second;
 }
 
+void FinishMessageHeader(CDataStream& ss) {
+    // Set the size
+    uint32_t nSize = ss.size() - CMessageHeader::HEADER_SIZE;
+    memcpy((char*)&ss[CMessageHeader::MESSAGE_SIZE_OFFSET], &nSize, sizeof(nSize));
+
+    // Set the checksum
+    uint256 hash       = Hash(ss.begin() + CMessageHeader::HEADER_SIZE, ss.end());
+    uint32_t nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    assert(ss.size() >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
+    memcpy((char*)&ss[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+}
+
+CSharedNetMessage MakeRawNetMessage(const char* pszCommand, CSerializeData&& data) {
+    assert(data.size() >= CMessageHeader::HEADER_SIZE);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CMessageHeader(pszCommand, data.size() - CMessageHeader::HEADER_SIZE);
+    memcpy(&data[0], &ss[0], CMessageHeader::HEADER_SIZE);
+
+    uint256 hash = Hash(data.begin() + CMessageHeader::HEADER_SIZE, data.end());
+    memcpy(&data[CMessageHeader::CHECKSUM_OFFSET], &hash, CMessageHeader::CHECKSUM_SIZE);
+
+    return std::make_shared<CSerializeData>(std::move(data));
+}
+
+void CNode::PushSharedMessage(const CSharedNetMessage& spMessage, SendClass sendClass) {
+    LOCK(cs_vSend);
+    const char* pchCommand = &(*spMessage)[MESSAGE_START_SIZE];
+    LogPrint(BCLog::NET, "sending: %s (%d bytes, shared)\n",
+             string(pchCommand, strnlen(pchCommand, CMessageHeader::COMMAND_SIZE)),
+             spMessage->size() - CMessageHeader::HEADER_SIZE);
+
+    vSendMsg.Push(spMessage, sendClass);
+    nSendSize += spMessage->size();
+
+    // If write queue empty, attempt "optimistic write"
+    if (vSendMsg.size() == 1) SocketSendData();
+}
+
+bool CNode::IsSendHeldBack() {
+    return uploadLimiter.IsLimited() && !vSendMsg.empty() && vSendMsg.FrontClass() != SEND_CONSENSUS &&
+           uploadLimiter.GetAllowance(1) == 0;
+}
+
 // requires LOCK(cs_vSend)
 void CNode::SocketSendData() {
-    deque<CSerializeData>::iterator it = vSendMsg.begin();
-
-    while (it != vSendMsg.end()) {
-        const CSerializeData& data = *it;
+    while (!vSendMsg.empty()) {
+        const CSerializeData& data = *vSendMsg.Front();
         assert(data.size() > nSendOffset);
-        int32_t nBytes = send(hSocket, &data[nSendOffset], data.size() - nSendOffset,
-                              MSG_NOSIGNAL | MSG_DONTWAIT);
+        size_t nToSend = data.size() - nSendOffset;
+        bool fCapped   = uploadLimiter.IsLimited() && vSendMsg.FrontClass() != SEND_CONSENSUS;
+        if (fCapped) {
+            nToSend = uploadLimiter.GetAllowance(nToSend);
+            // held back by the upload cap, the socket thread tries again
+            if (nToSend == 0)
+                break;
+        }
+
+        int32_t nBytes = send(hSocket, &data[nSendOffset], nToSend, MSG_NOSIGNAL | MSG_DONTWAIT);
         if (nBytes > 0) {
             nLastSend = GetTime();
             nSendBytes += nBytes;
             nSendOffset += nBytes;
             RecordBytesSent(nBytes);
+            if (fCapped)
+                uploadLimiter.Consume(nBytes);
             if (nSendOffset == data.size()) {
                 nSendOffset = 0;
                 nSendSize -= data.size();
-                it++;
+                vSendMsg.PopFront();
             } else {
                 // could not send full message; stop sending more
+                vSendMsg.StartFront();
                 break;
             }
         } else {
@@ -93,11 +146,13 @@ void CNode::SocketSendData() {
         }
     }
 
-    if (it == vSendMsg.end()) {
+    if (vSendMsg.empty()) {
         assert(nSendOffset == 0);
         assert(nSendSize == 0);
     }
-    vSendMsg.erase(vSendMsg.begin(), it);
+
+    // wait for the socket to become writable only while there is something left to send
+    socketEvents.SetSendInterest(this, !vSendMsg.empty());
 }
 
 
@@ -138,10 +193,16 @@ CAddress GetLocalAddress(const CNetAddr* paddrPeer) {
 
 void CNode::CloseSocketDisconnect() {
     fDisconnect = true;
-    if (hSocket != INVALID_SOCKET) {
-        LogPrint(BCLog::NET, "disconnecting node %s\n", addrName);
-        closesocket(hSocket);
-        hSocket = INVALID_SOCKET;
+    {
+        // The send path changes the socket registration under cs_vSend. If a thread is sending,
+        // the socket is closed by the next ThreadSocketHandler() sweep or when the node is deleted.
+        TRY_LOCK(cs_vSend, lockSend);
+        if (lockSend && hSocket != INVALID_SOCKET) {
+            LogPrint(BCLog::NET, "disconnecting node %s\n", addrName);
+            socketEvents.RemoveNode(this);
+            closesocket(hSocket);
+            hSocket = INVALID_SOCKET;
+        }
     }
 
     // in case this fails, we'll empty the recv buffer when the CNode is deleted
@@ -207,7 +268,8 @@ bool CNode::Ban(const CNetAddr& addr) {
 }
 
 // requires LOCK(cs_vRecvMsg)
-bool CNode::ReceiveMsgBytes(const char* pch, uint32_t nBytes) {
+bool CNode::ReceiveMsgBytes(const char* pch, uint32_t nBytes, bool& fComplete) {
+    fComplete = false;
     while (nBytes > 0) {
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() || vRecvMsg.back().complete()) vRecvMsg.push_back(CNetMessage(SER_NETWORK, nRecvVersion));
@@ -226,6 +288,9 @@ bool CNode::ReceiveMsgBytes(const char* pch, uint32_t nBytes) {
 
         pch += handled;
         nBytes -= handled;
+
+        if (msg.complete())
+            fComplete = true;
     }
 
     return true;
@@ -17,10 +17,16 @@
 #include "commons/mruset.h"
 #include "commons/random.h"
 #include "p2p/netmessage.h"
+#include "p2p/sendqueue.h"
+#include "p2p/socketevents.h"
+#include "p2p/txreconciliation.h"
+
+#include <atomic>
 
 class CNode;
 struct CNodeSignals;
 struct CNodeState;
+class CPartialBlock;
 
 typedef int32_t NodeId;
 extern CCriticalSection cs_nLastNodeId;
@@ -56,8 +62,31 @@ struct CNodeSignals {
 };
 
 inline uint32_t SendBufferSize() { return 1000 * SysCfg().GetArg("-maxsendbuffer", 1 * 1000); }
+// Send buffer limit of a class of messages, 0 for no limit
+inline size_t SendClassBufferSize(SendClass sendClass) {
+    return (size_t)SendBufferSize() * SEND_CLASS_BUFFER_SHARES[sendClass] / 100;
+}
 inline uint32_t MaxPbftMsgSize() { return SysCfg().GetArg("-maxpbftmsgsize", 11 * 1000); }
 
+// Set the size and the checksum in the header of the message in ss
+void FinishMessageHeader(CDataStream& ss);
+
+// Frame obj as a pszCommand message, once for all the peers it is sent to
+template <typename T>
+CSharedNetMessage MakeSharedNetMessage(const char* pszCommand, const T& obj) {
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CMessageHeader(pszCommand, 0) << obj;
+    FinishMessageHeader(ss);
+
+    auto spData = std::make_shared<CSerializeData>();
+    ss.GetAndClear(*spData);
+    return spData;
+}
+
+// Frame a payload serialized beforehand as a pszCommand message, data holds
+// CMessageHeader::HEADER_SIZE bytes of room for the header before the payload
+CSharedNetMessage MakeRawNetMessage(const char* pszCommand, CSerializeData&& data);
+
 
 
 CAddress GetLocalAddress(const CNetAddr* paddrPeer = nullptr);
@@ -100,6 +129,8 @@ struct CNodeState {
     int32_t nBlocksToDownload;        // blocks number to be downloaded
     int64_t nLastBlockReceive;        // the latest receiving blocks time
     int64_t nLastBlockProcess;        // the latest processing blocks time
+    // Compact block from this peer waiting for the blocktxn of its missing txs
+    std::shared_ptr<CPartialBlock> pPartialBlock;
 
     CNodeState() {
         nMisbehavior      = 0;
@@ -122,10 +153,11 @@ public:
     SOCKET hSocket;
     CDataStream ssSend;
     size_t nSendSize;    // total size of all vSendMsg entries
-    size_t nSendOffset;  // offset inside the first vSendMsg already sent
+    size_t nSendOffset;  // offset inside the front vSendMsg already sent
     uint64_t nSendBytes;
-    deque<CSerializeData> vSendMsg;
+    CSendQueue vSendMsg;
     CCriticalSection cs_vSend;
+    bool fSendInterest;  // registered for writing in socketEvents, requires cs_vSend
 
     deque<CInv> vRecvGetData;  // strCommand == "getdata 保存的inv
     deque<CNetMessage> vRecvMsg;
@@ -157,6 +189,9 @@ public:
     // b) the peer may tell us in their version message that we should not relay tx invs
     //    until they have initialized their bloom filter.
     bool fRelayTxes;
+    // The peer sent sendcmpct: it takes cmpctblock, getblocktxn and blocktxn. Set by its message
+    // handler worker, read by the threads announcing blocks.
+    std::atomic<bool> fCompactBlocks;
     CSemaphoreGrant grantOutbound;
     CCriticalSection cs_filter;
     CBloomFilter* pFilter;
@@ -182,6 +217,7 @@ public:
     // flood relay
     vector<CAddress> vAddrToSend;
     mruset<CAddress> setAddrKnown;
+    CCriticalSection cs_addr;  // vAddrToSend and setAddrKnown, other peers relay addresses to us
     bool fGetAddr;
     set<uint256> setKnown;  // alertHash
 
@@ -192,6 +228,9 @@ public:
 
     CCriticalSection cs_inventory;
     multimap<int64_t, CInv> mapAskFor;  //向网络请求交易的时间, a priority queue
+    // Set once the peer sent sendrecon, the txs not flooded to it go by reconciliation. Guarded by cs_inventory
+    std::unique_ptr<CTxReconState> pTxRecon;
+    uint64_t nTxReconSalt;  // our half of the short id salt, sent in sendrecon
 
 
     mruset<CBlockConfirmMessage> setBlockConfirmMsgKnown;
@@ -230,6 +269,7 @@ public:
         nRefCount                = 0;
         nSendSize                = 0;
         nSendOffset              = 0;
+        fSendInterest            = false;
         hashContinue             = uint256();
         pIndexLastGetBlocksBegin = 0;
         hashLastGetBlocksEnd     = uint256();
@@ -237,6 +277,8 @@ public:
         fStartSync               = false;
         fGetAddr                 = false;
         fRelayTxes               = false;
+        fCompactBlocks           = false;
+        nTxReconSalt             = GetRand(std::numeric_limits<uint64_t>::max());
         setInventoryKnown.max_size(SendBufferSize() / 1000);
         auto maxPbftMsgSize = MaxPbftMsgSize();
         setBlockConfirmMsgKnown.max_size(maxPbftMsgSize);
@@ -252,6 +294,9 @@ public:
             id = nLastNodeId++;
         }
 
+        // Registered before the version is pushed, a partial send asks for the socket to become writable
+        socketEvents.AddNode(this);
+
         // Be shy and don't send version until we hear
         if (hSocket != INVALID_SOCKET && !fInbound)
             PushVersion();
@@ -261,6 +306,7 @@ public:
 
     ~CNode() {
         if (hSocket != INVALID_SOCKET) {
+            socketEvents.RemoveNode(this);
             closesocket(hSocket);
             hSocket = INVALID_SOCKET;
         }
@@ -302,8 +348,23 @@ public:
         return total;
     }
 
+    // More messages of sendClass wait until the peer has read some of those queued
+    bool IsSendClassFull(SendClass sendClass) const {
+        size_t nLimit = SendClassBufferSize(sendClass);
+        return nLimit > 0 && vSendMsg.GetClassSize(sendClass) >= nLimit;
+    }
+
+    // The peer does not read what we queued for it, its messages wait to be processed.
+    // Any reply counts, the consensus ones included, the class limits only hold back getdata
+    bool IsSendBufferFull() const { return nSendSize >= SendBufferSize(); }
+
+    // requires LOCK(cs_vSend)
+    // There are messages to send but the upload cap holds them back
+    bool IsSendHeldBack();
+
     // requires LOCK(cs_vRecvMsg)
-    bool ReceiveMsgBytes(const char* pch, uint32_t nBytes);
+    // fComplete is set when a message got complete
+    bool ReceiveMsgBytes(const char* pch, uint32_t nBytes, bool& fComplete);
 
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int32_t nVersionIn) {
@@ -319,15 +380,25 @@ public:
 
     void Release() { nRefCount--; }
 
-    void AddAddressKnown(const CAddress& addr) { setAddrKnown.insert(addr); }
+    void AddAddressKnown(const CAddress& addr) {
+        LOCK(cs_addr);
+        setAddrKnown.insert(addr);
+    }
 
-    void AddBlockConfirmMessageKnown(const CBlockConfirmMessage msg){ setBlockConfirmMsgKnown.insert(msg); }
-    void AddBlockFinalityMessageKnown(const CBlockFinalityMessage msg){ setBlockFinalityMsgKnown.insert(msg); }
+    void AddBlockConfirmMessageKnown(const CBlockConfirmMessage msg){
+        LOCK(cs_blockConfirm);
+        setBlockConfirmMsgKnown.insert(msg);
+    }
+    void AddBlockFinalityMessageKnown(const CBlockFinalityMessage msg){
+        LOCK(cs_blockFinality);
+        setBlockFinalityMsgKnown.insert(msg);
+    }
 
     void PushAddress(const CAddress& addr) {
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_addr);
         if (addr.IsValid() && !setAddrKnown.count(addr)) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand() % vAddrToSend.size()] = addr;
@@ -340,6 +411,8 @@ public:
     void AddInventoryKnown(const CInv& inv) {
         LOCK(cs_inventory);
         setInventoryKnown.insert(inv);
+        if (inv.type == MSG_TX && pTxRecon)
+            pTxRecon->RemoveTx(inv.hash);
     }
 
     void PushInventory(const CInv& inv, bool forced = false) {
@@ -360,6 +433,15 @@ public:
         }
     }
 
+    // spMessage is msg framed by MakeSharedNetMessage(), once for all the peers
+    void PushBlockConfirmMessage(const CBlockConfirmMessage& msg, const CSharedNetMessage& spMessage) {
+        LOCK(cs_blockConfirm);
+        if(!setBlockConfirmMsgKnown.count(msg)){
+            PushSharedMessage(spMessage);
+            setBlockConfirmMsgKnown.insert(msg);
+        }
+    }
+
     void PushBlockFinalityMessage(const CBlockFinalityMessage& msg) {
         LOCK(cs_blockFinality);
         if(!setBlockFinalityMsgKnown.count(msg)){
@@ -368,6 +450,14 @@ public:
         }
     }
 
+    void PushBlockFinalityMessage(const CBlockFinalityMessage& msg, const CSharedNetMessage& spMessage) {
+        LOCK(cs_blockFinality);
+        if(!setBlockFinalityMsgKnown.count(msg)){
+            PushSharedMessage(spMessage);
+            setBlockFinalityMsgKnown.insert(msg);
+        }
+    }
+
     void AskFor(const CInv& inv) {
         if (mapAskFor.size() > MAPASKFOR_MAX_SZ) {
             return;
@@ -433,31 +523,28 @@ public:
             if (ssSend.size() == 0)
             return;
 
-            // Set the size
-            uint32_t nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
-            memcpy((char*)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], &nSize, sizeof(nSize));
-
-            // Set the checksum
-            uint256 hash           = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
-            uint32_t nChecksum = 0;
-            memcpy(&nChecksum, &hash, sizeof(nChecksum));
-            assert(ssSend.size() >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
-            memcpy((char*)&ssSend[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+            FinishMessageHeader(ssSend);
 
-            LogPrint(BCLog::NET, "(%d bytes)\n", nSize);
+            LogPrint(BCLog::NET, "(%d bytes)\n", ssSend.size() - CMessageHeader::HEADER_SIZE);
 
-            deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-            ssSend.GetAndClear(*it);
-            nSendSize += (*it).size();
+            auto spData = std::make_shared<CSerializeData>();
+            ssSend.GetAndClear(*spData);
+            vSendMsg.Push(spData, GetSendClass(*spData));
+            nSendSize += spData->size();
 
             // If write queue empty, attempt "optimistic write"
-            if (it == vSendMsg.begin()) SocketSendData();
+            if (vSendMsg.size() == 1) SocketSendData();
 
             LEAVE_CRITICAL_SECTION(cs_vSend);
     }
 
     void PushVersion();
 
+    // Queue a message built by MakeSharedNetMessage(), the same buffer may be queued to many peers
+    void PushSharedMessage(const CSharedNetMessage& spMessage) { PushSharedMessage(spMessage, GetSendClass(*spMessage)); }
+    // Queue it in sendClass instead of the class of its command
+    void PushSharedMessage(const CSharedNetMessage& spMessage, SendClass sendClass);
+
     void PushMessage(const char* pszCommand) {
         try {
             BeginMessage(pszCommand);
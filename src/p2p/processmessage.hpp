@@ -69,8 +69,49 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
         ProcessBlockMessage(pFrom, vRecv);
     }
 
+    else if (strCommand == NetMsgType::SENDCMPCT) {
+        uint64_t nCompactBlocksVersion = 0;
+        vRecv >> nCompactBlocksVersion;
+        pFrom->fCompactBlocks = (nCompactBlocksVersion == COMPACT_BLOCKS_VERSION);
+    }
+
+    else if (strCommand == NetMsgType::CMPCTBLOCK &&
+            !SysCfg().IsImporting() && !SysCfg().IsReindex())
+    {
+        ProcessCompactBlockMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::GETBLOCKTXN) {
+        ProcessGetBlockTxnMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::BLOCKTXN &&
+            !SysCfg().IsImporting() && !SysCfg().IsReindex())
+    {
+        ProcessBlockTxnMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::SENDRECON) {
+        ProcessSendReconMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::REQRECON) {
+        ProcessReqReconMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::SKETCH) {
+        ProcessSketchMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == NetMsgType::RECONCILDIFF) {
+        ProcessReconcilDiffMessage(pFrom, vRecv);
+    }
+
     else if (strCommand == NetMsgType::GETADDR) {
-        pFrom->vAddrToSend.clear();
+        {
+            LOCK(pFrom->cs_addr);
+            pFrom->vAddrToSend.clear();
+        }
         vector<CAddress> vAddr = addrman.GetAddr();
         for (const auto &addr : vAddr)
             pFrom->PushAddress(addr);
@@ -173,7 +214,7 @@ bool ProcessMessages(CNode *pFrom) {
     deque<CNetMessage>::iterator it = pFrom->vRecvMsg.begin();
     while (!pFrom->fDisconnect && it != pFrom->vRecvMsg.end()) {
         // Don't bother if send buffer is too full to respond anyway
-        if (pFrom->nSendSize >= SendBufferSize()) {
+        if (pFrom->IsSendBufferFull()) {
             LogPrint(BCLog::NET, "send buffer size: %d full for peer: %s\n", pFrom->nSendSize, pFrom->addr.ToString());
             break;
         }
@@ -38,10 +38,14 @@ namespace NetMsgType {
     const char *FINALITYBLOCK = "finblock";
     // const char *SENDHEADERS="sendheaders";
     // const char *FEEFILTER="feefilter";
-    // const char *SENDCMPCT="sendcmpct";
-    // const char *CMPCTBLOCK="cmpctblock";
-    // const char *GETBLOCKTXN="getblocktxn";
-    // const char *BLOCKTXN="blocktxn";
+    const char *SENDCMPCT="sendcmpct";
+    const char *CMPCTBLOCK="cmpctblock";
+    const char *GETBLOCKTXN="getblocktxn";
+    const char *BLOCKTXN="blocktxn";
+    const char *SENDRECON="sendrecon";
+    const char *REQRECON="reqrecon";
+    const char *SKETCH="sketch";
+    const char *RECONCILDIFF="reconcildiff";
 } // namespace NetMsgType
 
 static const char* ppszTypeName[] =
@@ -49,7 +53,8 @@ static const char* ppszTypeName[] =
     "ERROR",
     "tx",
     "block",
-    "filtered block"
+    "filtered block",
+    "cmpct block"
 };
 
 CMessageHeader::CMessageHeader()
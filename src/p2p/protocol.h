@@ -219,31 +219,51 @@ extern const char *SENDHEADERS;
  */
 extern const char *FEEFILTER;
 /**
- * Contains a 1-byte bool and 8-byte LE version number.
- * Indicates that a node is willing to provide blocks via "cmpctblock" messages.
- * May indicate that a node prefers to receive new block announcements via a
- * "cmpctblock" message rather than an "inv", depending on message contents.
- * @since protocol version 70014 as described by BIP 152
+ * Contains an 8-byte LE compact block version (COMPACT_BLOCKS_VERSION).
+ * Sent after the verack, indicates that a node is willing to provide and to
+ * receive blocks via "cmpctblock" messages.
+ * @see BIP 152, without the high/low bandwidth modes
  */
 extern const char *SENDCMPCT;
 /**
- * Contains a CBlockHeaderAndShortTxIDs object - providing a header and
- * list of "short txids".
- * @since protocol version 70014 as described by BIP 152
+ * Contains a CCompactBlock - providing a header, a list of "short txids" and
+ * the prefilled txs.
+ * @see BIP 152
  */
 extern const char *CMPCTBLOCK;
 /**
- * Contains a BlockTransactionsRequest
+ * Contains a CBlockTxnRequest
  * Peer should respond with "blocktxn" message.
- * @since protocol version 70014 as described by BIP 152
+ * @see BIP 152
  */
 extern const char *GETBLOCKTXN;
 /**
- * Contains a BlockTransactions.
+ * Contains a CBlockTxn.
  * Sent in response to a "getblocktxn" message.
- * @since protocol version 70014 as described by BIP 152
+ * @see BIP 152
  */
 extern const char *BLOCKTXN;
+/**
+ * Contains a 4-byte tx reconciliation version (TXRECON_VERSION) and the 8-byte half of
+ * the short id salt of the sender. Sent after the verack, indicates that a node
+ * announces txs by set reconciliation to the peers that sent it too.
+ */
+extern const char *SENDRECON;
+/**
+ * Contains a CReconRequest, from the outbound side of a connection.
+ * Peer should respond with a "sketch" message.
+ */
+extern const char *REQRECON;
+/**
+ * Contains a CReconSketch of the txs the sender queued for the peer.
+ * Sent in response to a "reqrecon" message.
+ */
+extern const char *SKETCH;
+/**
+ * Contains a CReconDiff, the short ids of the "sketch" sender the receiver lacks.
+ * Peer should announce them in an "inv".
+ */
+extern const char *RECONCILDIFF;
 
 /**
  * the message must be send by miner,means the the
@@ -388,6 +408,9 @@ enum
     // Nodes may always request a MSG_FILTERED_BLOCK in a getdata, however,
     // MSG_FILTERED_BLOCK should not appear in any invs except as a part of getdata.
     MSG_FILTERED_BLOCK,
+    // Only in a getdata, to a peer that sent sendcmpct: asks for a cmpctblock instead of
+    // a block.
+    MSG_CMPCT_BLOCK,
 };
 
 #endif // __INCLUDED_PROTOCOL_H__
@@ -0,0 +1,76 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "relaycache.h"
+
+#include "commons/util/util.h"
+
+CRelayCache relayCache;
+
+void CRelayCache::SetMaxBytes(size_t nMaxBytesIn) {
+    LOCK(cs);
+    nMaxBytes = nMaxBytesIn;
+    while (nBytes > nMaxBytes && !order.empty()) {
+        EraseOldest();
+        nEvictions++;
+    }
+}
+
+void CRelayCache::EraseOldest() {
+    auto it = entries.find(order.front());
+    nBytes -= it->second.nSize;
+    entries.erase(it);
+    order.pop_front();
+}
+
+void CRelayCache::Expire(int64_t nNow) {
+    while (!order.empty() && entries.find(order.front())->second.nExpiry < nNow) {
+        EraseOldest();
+        nExpirations++;
+    }
+}
+
+void CRelayCache::Add(const uint256 &txid, const CSharedNetMessage &spMessage) {
+    LOCK(cs);
+    int64_t nNow = GetTime();
+    Expire(nNow);
+
+    size_t nSize = spMessage->size() + RELAY_CACHE_ENTRY_OVERHEAD;
+    if (nSize > nMaxBytes || entries.count(txid))
+        return;
+
+    while (nBytes + nSize > nMaxBytes) {
+        EraseOldest();
+        nEvictions++;
+    }
+
+    nBytes += nSize;
+    entries.emplace(txid, Entry{spMessage, nNow + RELAY_CACHE_EXPIRY, nSize});
+    order.push_back(txid);
+}
+
+CSharedNetMessage CRelayCache::Get(const uint256 &txid) {
+    LOCK(cs);
+    auto it = entries.find(txid);
+    if (it == entries.end() || it->second.nExpiry < GetTime()) {
+        nMisses++;
+        return nullptr;
+    }
+
+    nHits++;
+    return it->second.spMessage;
+}
+
+CRelayCache::Stats CRelayCache::GetStats() {
+    LOCK(cs);
+    Stats stats;
+    stats.nEntries     = entries.size();
+    stats.nBytes       = nBytes;
+    stats.nMaxBytes    = nMaxBytes;
+    stats.nHits        = nHits;
+    stats.nMisses      = nMisses;
+    stats.nEvictions   = nEvictions;
+    stats.nExpirations = nExpirations;
+    return stats;
+}
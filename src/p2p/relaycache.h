@@ -0,0 +1,76 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_RELAYCACHE_H
+#define P2P_RELAYCACHE_H
+
+#include "commons/hasher.h"
+#include "commons/uint256.h"
+#include "p2p/netmessage.h"
+#include "sync.h"
+
+#include <deque>
+#include <unordered_map>
+
+/** Seconds a relayed tx is kept for the peers asking for it */
+static const int64_t RELAY_CACHE_EXPIRY           = 15 * 60;
+/** -maxrelaycache default, in MB */
+static const int64_t DEFAULT_MAX_RELAY_CACHE_SIZE = 32;
+/** Bytes charged to an entry besides its message: the index node and the expiry record */
+static const size_t RELAY_CACHE_ENTRY_OVERHEAD    = 140;
+
+/**
+ * The txs we relayed, served to the peers that ask for them after our inv.
+ *
+ * An entry keeps the tx message framed when the tx was relayed, checksum included, so
+ * serving it neither serializes nor hashes it again and the same buffer is queued to
+ * every peer asking. The entries go in relay order, the oldest are dropped first once
+ * they expire or the bytes kept go over the budget.
+ */
+class CRelayCache {
+public:
+    struct Stats {
+        size_t nEntries       = 0;
+        size_t nBytes         = 0;
+        size_t nMaxBytes      = 0;
+        uint64_t nHits        = 0;
+        uint64_t nMisses      = 0;
+        uint64_t nEvictions   = 0;  // dropped for the budget before they expired
+        uint64_t nExpirations = 0;
+    };
+
+    explicit CRelayCache(size_t nMaxBytesIn = DEFAULT_MAX_RELAY_CACHE_SIZE * 1000000) : nMaxBytes(nMaxBytesIn) {}
+
+    void SetMaxBytes(size_t nMaxBytesIn);
+    // Keep the tx message for RELAY_CACHE_EXPIRY seconds, a tx kept already stays as it was
+    void Add(const uint256 &txid, const CSharedNetMessage &spMessage);
+    // The tx message kept, nullptr if the tx is not kept
+    CSharedNetMessage Get(const uint256 &txid);
+    Stats GetStats();
+
+private:
+    struct Entry {
+        CSharedNetMessage spMessage;
+        int64_t nExpiry;
+        size_t nSize;
+    };
+
+    void Expire(int64_t nNow);
+    // Drop the oldest entry, requires !order.empty()
+    void EraseOldest();
+
+    CCriticalSection cs;
+    std::unordered_map<uint256, Entry, CSaltedUint256Hasher> entries;
+    std::deque<uint256> order;  // txids in relay order, that is in expiry order
+    size_t nMaxBytes;
+    size_t nBytes         = 0;
+    uint64_t nHits        = 0;
+    uint64_t nMisses      = 0;
+    uint64_t nEvictions   = 0;
+    uint64_t nExpirations = 0;
+};
+
+extern CRelayCache relayCache;
+
+#endif  // P2P_RELAYCACHE_H
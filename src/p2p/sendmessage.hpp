@@ -67,11 +67,36 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
             //LogPrint(BCLog::NET, "send ping: %s\n", DateTimeStrFormat("YYYY-MM-DDTHH-MM-SS", pTo->nPingUsecStart).c_str());
         }
 
+        //
+        // Message: addr
+        //
+        if (fSendTrickle) {
+            vector<CAddress> vAddr;
+            {
+                LOCK(pTo->cs_addr);
+                vAddr.reserve(pTo->vAddrToSend.size());
+                for (const auto &addr : pTo->vAddrToSend) {
+                    // returns true if wasn't already contained in the set
+                    if (pTo->setAddrKnown.insert(addr).second)
+                        vAddr.push_back(addr);
+                }
+                pTo->vAddrToSend.clear();
+            }
+            // receiver rejects addr messages larger than 1000
+            for (size_t i = 0; i < vAddr.size(); i += 1000)
+                pTo->PushMessage(NetMsgType::ADDR,
+                                 vector<CAddress>(vAddr.begin() + i, vAddr.begin() + min(i + 1000, vAddr.size())));
+        }
+
+        // Near the tip the mempool holds most of the txs of a new block
+        bool fCompactBlocks = false;
         {
             TRY_LOCK(cs_main, lockMain);  // Acquire cs_main for IsInitialBlockDownload() and CNodeState()
             if (!lockMain)
                 return true;
 
+            fCompactBlocks = pTo->fCompactBlocks && !IsInitialBlockDownload();
+
             // Address refresh broadcast
             static int64_t nLastRebroadcast;
             if (!IsInitialBlockDownload() && (GetTime() - nLastRebroadcast > 24 * 60 * 60)) {
@@ -79,8 +104,10 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                     LOCK(cs_vNodes);
                     for (auto pNode : vNodes) {
                         // Periodically clear setAddrKnown to allow refresh broadcasts
-                        if (nLastRebroadcast)
+                        if (nLastRebroadcast) {
+                            LOCK(pNode->cs_addr);
                             pNode->setAddrKnown.clear();
+                        }
 
                         // Rebroadcast our address
                         if (!fNoListen) {
@@ -93,28 +120,6 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                 nLastRebroadcast = GetTime();
             }
 
-            //
-            // Message: addr
-            //
-            if (fSendTrickle) {
-                vector<CAddress> vAddr;
-                vAddr.reserve(pTo->vAddrToSend.size());
-                for (const auto &addr : pTo->vAddrToSend) {
-                    // returns true if wasn't already contained in the set
-                    if (pTo->setAddrKnown.insert(addr).second) {
-                        vAddr.push_back(addr);
-                        // receiver rejects addr messages larger than 1000
-                        if (vAddr.size() >= 1000) {
-                            pTo->PushMessage(NetMsgType::ADDR, vAddr);
-                            vAddr.clear();
-                        }
-                    }
-                }
-                pTo->vAddrToSend.clear();
-                if (!vAddr.empty())
-                    pTo->PushMessage(NetMsgType::ADDR, vAddr);
-            }
-
             // Start block sync
             if (pTo->fStartSync && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
                 pTo->fStartSync = false;
@@ -170,6 +175,10 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                 if (pTo->setInventoryKnown.count(inv))
                     continue;
 
+                // announced by the next reconciliation, unless it has to go in an inv
+                if (inv.type == MSG_TX && pTo->pTxRecon && !pTo->pTxRecon->fFlood && pTo->pTxRecon->AddTx(inv.hash))
+                    continue;
+
                 // trickle out tx inv to protect privacy
                 if (inv.type == MSG_TX && !fSendTrickle) {
                     // 1/4 of tx invs blast to all immediately
@@ -196,6 +205,21 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
                 }
             }
             pTo->vInventoryToSend = vInvWait;
+
+            // a round the peer did not answer in time, its txs go in invs
+            vector<uint256> vExpiredTxid;
+            if (pTo->pTxRecon && pTo->pTxRecon->ExpireRound(GetTime(), vExpiredTxid)) {
+                LogPrint(BCLog::NET, "reconciliation with peer %s timed out, %u txs to announce\n",
+                         pTo->addr.ToString(), vExpiredTxid.size());
+                for (const auto &txid : vExpiredTxid) {
+                    CInv inv(MSG_TX, txid);
+                    if (pTo->setInventoryKnown.insert(inv).second)
+                        vInv.push_back(inv);
+                }
+            }
+
+            if (pTo->pTxRecon && pTo->pTxRecon->IsRequestDue(GetTime()))
+                pTo->PushMessage(NetMsgType::REQRECON, pTo->pTxRecon->MakeRequest(GetTime()));
         }
         if (!vInv.empty())
             pTo->PushMessage(NetMsgType::INV, vInv);
@@ -219,7 +243,7 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
         int32_t index = 0;
         while (!pTo->fDisconnect && state.nBlocksToDownload && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
             uint256 hash = state.vBlocksToDownload.front();
-            vGetData.push_back(CInv(MSG_BLOCK, hash));
+            vGetData.push_back(CInv(fCompactBlocks ? MSG_CMPCT_BLOCK : MSG_BLOCK, hash));
             MarkBlockAsInFlight(hash, pTo->GetId());
             LogPrint(BCLog::NET, "send MSG_BLOCK msg! time_ms=%lld, hash=%s, peer=%s, FlightBlocks=%d, index=%d\n",
                 GetTimeMillis(), hash.ToString(), state.name, state.nBlocksInFlight, index++);
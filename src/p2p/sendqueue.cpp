@@ -0,0 +1,163 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sendqueue.h"
+
+#include "commons/util/util.h"
+
+#include <map>
+#include <string>
+
+CSendClassStats sendClassStats[SEND_CLASS_COUNT];
+CUploadLimiter uploadLimiter;
+
+SendClass GetSendClass(const std::string &strCommand) {
+    static const std::map<std::string, SendClass> sendClasses = {
+        {NetMsgType::CONFIRMBLOCK, SEND_CONSENSUS},
+        {NetMsgType::FINALITYBLOCK, SEND_CONSENSUS},
+        // small, and the version must be the first message on the wire
+        {NetMsgType::VERSION, SEND_CONSENSUS},
+        {NetMsgType::VERACK, SEND_CONSENSUS},
+        {NetMsgType::SENDCMPCT, SEND_CONSENSUS},
+        {NetMsgType::SENDRECON, SEND_CONSENSUS},
+        {NetMsgType::PING, SEND_CONSENSUS},
+        {NetMsgType::PONG, SEND_CONSENSUS},
+        {NetMsgType::REJECT, SEND_CONSENSUS},
+        {NetMsgType::ALERT, SEND_CONSENSUS},
+
+        {NetMsgType::BLOCK, SEND_BLOCK},
+        {NetMsgType::CMPCTBLOCK, SEND_BLOCK},
+        {NetMsgType::GETBLOCKTXN, SEND_BLOCK},
+        {NetMsgType::BLOCKTXN, SEND_BLOCK},
+        {NetMsgType::GETBLOCKS, SEND_BLOCK},
+        {NetMsgType::GETHEADERS, SEND_BLOCK},
+        {NetMsgType::GETDATA, SEND_BLOCK},
+
+        {NetMsgType::ADDR, SEND_ADDR},
+        {NetMsgType::GETADDR, SEND_ADDR},
+    };
+
+    // the rest go with the txs, the merkleblock of a filtered block and the txs following it among them
+    auto it = sendClasses.find(strCommand);
+    return it != sendClasses.end() ? it->second : SEND_TX;
+}
+
+SendClass GetSendClass(const CSerializeData &data) {
+    const char *pchCommand = &data[MESSAGE_START_SIZE];
+    return GetSendClass(std::string(pchCommand, strnlen(pchCommand, CMessageHeader::COMMAND_SIZE)));
+}
+
+const char *GetSendClassName(SendClass sendClass) {
+    switch (sendClass) {
+        case SEND_CONSENSUS: return "consensus";
+        case SEND_BLOCK: return "block";
+        case SEND_TX: return "tx";
+        case SEND_ADDR: return "addr";
+        default: return "unknown";
+    }
+}
+
+void CSendClassStats::Record(size_t nSize, int64_t nDelayMicros) {
+    nMessages++;
+    nBytes += nSize;
+    nTotalDelayMicros += nDelayMicros;
+
+    int64_t nMax = nMaxDelayMicros;
+    while (nDelayMicros > nMax && !nMaxDelayMicros.compare_exchange_weak(nMax, nDelayMicros)) {
+    }
+}
+
+void CSendQueue::Push(const CSharedNetMessage &spMessage, SendClass sendClass) {
+    queues[sendClass].push_back({spMessage, GetTimeMicros()});
+    nClassSizes[sendClass] += spMessage->size();
+    nMessages++;
+}
+
+int32_t CSendQueue::SelectClass() {
+    if (!queues[SEND_CONSENSUS].empty())
+        return SEND_CONSENSUS;
+
+    // Deficit round robin over the other classes, one of them is not empty
+    while (true) {
+        const auto &queue = queues[nRound];
+        if (!queue.empty() && nDeficits[nRound] >= (int64_t)queue.front().spMessage->size()) {
+            nDeficits[nRound] -= queue.front().spMessage->size();
+            return nRound;
+        }
+
+        // the class is done for this round, an idle class does not save credit up
+        if (queue.empty())
+            nDeficits[nRound] = 0;
+
+        nRound = nRound % (SEND_CLASS_COUNT - 1) + 1;
+        if (!queues[nRound].empty())
+            nDeficits[nRound] += SEND_QUANTUM_SIZE * SEND_CLASS_WEIGHTS[nRound];
+    }
+}
+
+const CSharedNetMessage &CSendQueue::Front() {
+    assert(!empty());
+    if (nFront != -1 && !fFrontStarted) {
+        // nothing of it went out yet, pick again: a consensus message queued since goes first
+        if (nFront != SEND_CONSENSUS)
+            nDeficits[nFront] += queues[nFront].front().spMessage->size();
+        nFront = -1;
+    }
+    if (nFront == -1)
+        nFront = SelectClass();
+
+    return queues[nFront].front().spMessage;
+}
+
+SendClass CSendQueue::FrontClass() {
+    Front();
+    return (SendClass)nFront;
+}
+
+void CSendQueue::PopFront() {
+    assert(nFront != -1);
+    auto &queue        = queues[nFront];
+    const Entry &entry = queue.front();
+    size_t nSize       = entry.spMessage->size();
+    sendClassStats[nFront].Record(nSize, GetTimeMicros() - entry.nQueuedTime);
+
+    nClassSizes[nFront] -= nSize;
+    nMessages--;
+    queue.pop_front();
+    nFront        = -1;
+    fFrontStarted = false;
+}
+
+void CUploadLimiter::SetRate(int64_t nBytesPerSecond) {
+    LOCK(cs);
+    nRate       = std::max<int64_t>(nBytesPerSecond, 0);
+    nTokens     = nRate;
+    nLastRefill = GetTimeMicros();
+}
+
+void CUploadLimiter::Refill() {
+    int64_t nElapsed = std::min<int64_t>(GetTimeMicros() - nLastRefill, 1000000);
+    int64_t nAdded   = nElapsed * nRate / 1000000;
+    // less than a byte is left for the next refill
+    if (nAdded <= 0)
+        return;
+
+    nTokens     = std::min(nTokens + nAdded, nRate);
+    nLastRefill = GetTimeMicros();
+}
+
+size_t CUploadLimiter::GetAllowance(size_t nSize) {
+    LOCK(cs);
+    if (nRate == 0)
+        return nSize;
+
+    Refill();
+    return nTokens > 0 ? std::min<size_t>(nSize, nTokens) : 0;
+}
+
+void CUploadLimiter::Consume(size_t nBytes) {
+    LOCK(cs);
+    if (nRate > 0)
+        nTokens -= nBytes;
+}
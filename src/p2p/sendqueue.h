@@ -0,0 +1,118 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_SENDQUEUE_H
+#define P2P_SENDQUEUE_H
+
+#include "p2p/netmessage.h"
+#include "sync.h"
+
+#include <atomic>
+#include <deque>
+#include <string>
+
+/** Priority classes of the messages sent to a peer */
+enum SendClass {
+    SEND_CONSENSUS = 0,  // pbft confirm and finality, and the handshake and control messages
+    SEND_BLOCK,          // blocks, compact blocks and their requests
+    SEND_TX,             // txs, inventory and the rest
+    SEND_ADDR,           // addresses
+    SEND_CLASS_COUNT
+};
+
+/** Deficit round robin quantum of a weight unit, in bytes */
+static const size_t SEND_QUANTUM_SIZE          = 16 * 1000;
+/** Share of the upload of the block, tx and addr classes when all of them have messages queued */
+static const int32_t SEND_CLASS_WEIGHTS[SEND_CLASS_COUNT] = {0, 4, 2, 1};
+/** Send buffer limit of each class in percent of -maxsendbuffer, 0 for no limit */
+static const uint32_t SEND_CLASS_BUFFER_SHARES[SEND_CLASS_COUNT] = {0, 100, 50, 10};
+/** -maxuploadrate default, in KB/s, 0 for no limit */
+static const int64_t DEFAULT_MAX_UPLOAD_RATE   = 0;
+
+SendClass GetSendClass(const std::string &strCommand);
+// Class of a framed message, from the command of its header
+SendClass GetSendClass(const CSerializeData &data);
+const char *GetSendClassName(SendClass sendClass);
+
+/** Messages sent and their time in the send queues, per class, over all the peers */
+struct CSendClassStats {
+    std::atomic<uint64_t> nMessages{0};
+    std::atomic<uint64_t> nBytes{0};
+    std::atomic<int64_t> nTotalDelayMicros{0};
+    std::atomic<int64_t> nMaxDelayMicros{0};
+
+    void Record(size_t nSize, int64_t nDelayMicros);
+};
+
+extern CSendClassStats sendClassStats[SEND_CLASS_COUNT];
+
+/**
+ * The send queue of a peer, one FIFO per class.
+ *
+ * A consensus message goes out before any other. The block, tx and addr classes share
+ * what is left by deficit round robin over their bytes, SEND_CLASS_WEIGHTS to one
+ * another: a block does not wait for megabytes of inventory and txs still flow while
+ * blocks are served. The messages of a class keep their order. Front() picks the message
+ * again until some of its bytes are sent, so that a message held back by the upload cap
+ * does not hold back a consensus message queued after it; a started message stays in
+ * front until it is fully sent. Requires CNode::cs_vSend.
+ */
+class CSendQueue {
+public:
+    void Push(const CSharedNetMessage &spMessage, SendClass sendClass);
+
+    bool empty() const { return nMessages == 0; }
+    size_t size() const { return nMessages; }
+    // Bytes of the messages queued in sendClass
+    size_t GetClassSize(SendClass sendClass) const { return nClassSizes[sendClass]; }
+
+    // The message to send next, requires !empty()
+    const CSharedNetMessage &Front();
+    SendClass FrontClass();
+    // Some bytes of the message returned by Front() were sent, it stays in front
+    void StartFront() { assert(nFront != -1); fFrontStarted = true; }
+    // The message returned by Front() was sent
+    void PopFront();
+
+private:
+    struct Entry {
+        CSharedNetMessage spMessage;
+        int64_t nQueuedTime;  // micros
+    };
+
+    int32_t SelectClass();
+
+    std::deque<Entry> queues[SEND_CLASS_COUNT];
+    size_t nClassSizes[SEND_CLASS_COUNT] = {};
+    int64_t nDeficits[SEND_CLASS_COUNT]  = {};
+    size_t nMessages                     = 0;
+    int32_t nFront                       = -1;          // class of the message in front, -1 if none picked
+    bool fFrontStarted                   = false;       // some bytes of the message in front were sent
+    int32_t nRound                       = SEND_BLOCK;  // class the round robin is on
+};
+
+/**
+ * Global upload bandwidth cap of -maxuploadrate, a token bucket of one second of upload.
+ * Consensus messages are not held back by it.
+ */
+class CUploadLimiter {
+public:
+    void SetRate(int64_t nBytesPerSecond);
+    bool IsLimited() const { return nRate > 0; }
+    // Bytes that may be sent now, at most nSize
+    size_t GetAllowance(size_t nSize);
+    void Consume(size_t nBytes);
+
+private:
+    void Refill();
+
+    CCriticalSection cs;
+    int64_t nRate       = 0;
+    int64_t nTokens     = 0;
+    int64_t nLastRefill = 0;  // micros
+};
+
+extern CUploadLimiter uploadLimiter;
+
+#endif  // P2P_SENDQUEUE_H
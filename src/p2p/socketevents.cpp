@@ -0,0 +1,121 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketevents.h"
+
+#include "netbase.h"
+#include "p2p/node.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+CSocketEvents socketEvents;
+
+CSocketEvents::~CSocketEvents() {
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollFd != -1)
+        close(epollFd);
+#endif
+}
+
+bool CSocketEvents::Init(const std::string &mode) {
+    if (mode == "select")
+        return true;
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (mode == "epoll") {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd == -1) {
+            LogPrint(BCLog::INFO, "epoll_create1 failed: %s\n", NetworkErrorString(errno));
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+bool CSocketEvents::AddListenSocket(SOCKET hSocket) {
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollFd == -1)
+        return true;
+
+    // level triggered, a pass accepts one connection per listening socket
+    struct epoll_event event = {};
+    event.events   = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, hSocket, &event) == -1) {
+        LogPrint(BCLog::INFO, "epoll_ctl add listening socket failed: %s\n", NetworkErrorString(errno));
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool CSocketEvents::AddNode(CNode *pNode) {
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollFd == -1 || pNode->hSocket == INVALID_SOCKET)
+        return true;
+
+    struct epoll_event event = {};
+    event.events   = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = pNode;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, pNode->hSocket, &event) == -1) {
+        LogPrint(BCLog::INFO, "epoll_ctl add socket[%s] failed: %s\n", pNode->addr.ToString(),
+                 NetworkErrorString(errno));
+        return false;
+    }
+#endif
+    return true;
+}
+
+void CSocketEvents::RemoveNode(CNode *pNode) {
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollFd == -1 || pNode->hSocket == INVALID_SOCKET)
+        return;
+
+    struct epoll_event event = {};
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, pNode->hSocket, &event);
+#endif
+}
+
+void CSocketEvents::SetSendInterest(CNode *pNode, bool fSend) {
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollFd == -1 || pNode->hSocket == INVALID_SOCKET || pNode->fSendInterest == fSend)
+        return;
+
+    // EPOLL_CTL_MOD reports the current readiness again, a socket that can already be
+    // written to gets its edge
+    struct epoll_event event = {};
+    event.events   = EPOLLIN | EPOLLRDHUP | EPOLLET | (fSend ? EPOLLOUT : 0);
+    event.data.ptr = pNode;
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, pNode->hSocket, &event) == -1) {
+        LogPrint(BCLog::INFO, "epoll_ctl modify socket[%s] failed: %s\n", pNode->addr.ToString(),
+                 NetworkErrorString(errno));
+        return;
+    }
+    pNode->fSendInterest = fSend;
+#endif
+}
+
+int32_t CSocketEvents::Wait(int64_t timeoutMs, std::vector<Event> &events) {
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event readyEvents[MAX_SOCKET_EVENTS];
+    int32_t nReady = epoll_wait(epollFd, readyEvents, MAX_SOCKET_EVENTS, timeoutMs);
+    for (int32_t i = 0; i < nReady; i++) {
+        const struct epoll_event &ready = readyEvents[i];
+        Event event;
+        event.pNode  = (CNode *)ready.data.ptr;
+        event.fRecv  = ready.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP);
+        event.fSend  = ready.events & EPOLLOUT;
+        event.fError = ready.events & EPOLLERR;
+        events.push_back(event);
+    }
+    return nReady;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_SOCKETEVENTS_H
+#define P2P_SOCKETEVENTS_H
+
+#if defined(HAVE_CONFIG_H)
+#include "config/coin-config.h"
+#endif
+
+#include "commons/compat/compat.h"
+
+#include <string>
+#include <vector>
+
+class CNode;
+
+/** -socketevents default */
+#ifdef HAVE_SYS_EPOLL_H
+static const char *const DEFAULT_SOCKET_EVENTS = "epoll";
+#else
+static const char *const DEFAULT_SOCKET_EVENTS = "select";
+#endif
+/** Max number of events taken by one epoll_wait() */
+static const int32_t MAX_SOCKET_EVENTS         = 1024;
+/** How often the socket thread sweeps the disconnected and inactive peers in epoll mode, in milliseconds */
+static const int64_t SOCKET_SWEEP_INTERVAL_MS  = 50;
+
+/**
+ * Readiness notification of the sockets serviced by ThreadSocketHandler().
+ *
+ * In select mode nothing is registered, the socket thread rebuilds its fd_sets over all
+ * the peers on every pass, and the descriptors must stay below FD_SETSIZE.
+ *
+ * In epoll mode the sockets are registered once: the listening sockets level triggered,
+ * the peer sockets edge triggered for reading from their connection on, and for writing
+ * only while their send queue is not empty (see CNode::SocketSendData()). A pass then
+ * costs the number of ready sockets instead of the number of peers, and there is no
+ * limit on the descriptor values.
+ */
+class CSocketEvents {
+public:
+    struct Event {
+        CNode *pNode;  // nullptr for a listening socket
+        bool fRecv;
+        bool fSend;
+        bool fError;
+    };
+
+public:
+    CSocketEvents() {}
+    ~CSocketEvents();
+
+    // Set up the mode, "epoll" or "select". Returns false if it is not supported.
+    bool Init(const std::string &mode);
+    bool IsEpoll() const { return epollFd != -1; }
+
+    bool AddListenSocket(SOCKET hSocket);
+    bool AddNode(CNode *pNode);
+    // Call it before the socket is closed, a closed descriptor may be reused at once
+    void RemoveNode(CNode *pNode);
+    // Requires pNode->cs_vSend
+    void SetSendInterest(CNode *pNode, bool fSend);
+
+    // Wait at most timeoutMs for ready sockets, the events are appended to events
+    int32_t Wait(int64_t timeoutMs, std::vector<Event> &events);
+
+private:
+    int epollFd = -1;
+};
+
+extern CSocketEvents socketEvents;
+
+#endif  // P2P_SOCKETEVENTS_H
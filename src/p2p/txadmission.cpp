@@ -0,0 +1,193 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txadmission.h"
+
+#include "main.h"
+#include "net.h"
+#include "node.h"
+#include "sigverify.h"
+#include "tx/tx.h"
+
+CTxAdmissionQueue txAdmissionQueue;
+
+static void ThreadTxAdmission() { txAdmissionQueue.ThreadDispatch(); }
+
+void StartTxAdmission(boost::thread_group &threadGroup) {
+    if (!SysCfg().GetBoolArg("-txadmission", DEFAULT_TX_ADMISSION)) {
+        LogPrint(BCLog::INFO, "tx admission queue disabled, txs from peers are admitted inline\n");
+        return;
+    }
+
+    txAdmissionQueue.Start(threadGroup);
+}
+
+void CTxAdmissionQueue::Start(boost::thread_group &threadGroup) {
+    fRunning = true;
+
+    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "txadmit", &ThreadTxAdmission));
+
+    LogPrint(BCLog::INFO, "tx admission queue started\n");
+}
+
+bool CTxAdmissionQueue::Push(CNode *pFrom, const std::shared_ptr<CBaseTx> &pBaseTx) {
+    nReceived++;
+    {
+        // the bound is checked and the tx queued under one lock, so that concurrent pushers can not exceed it
+        boost::unique_lock<boost::mutex> lock(mtxQueue);
+        if (queue.size() >= MAX_TX_ADMISSION_QUEUE_SIZE) {
+            nDropped++;
+            return false;
+        }
+
+        {
+            LOCK(cs_vNodes);
+            pFrom->AddRef();
+        }
+        queue.push_back({pFrom, pBaseTx, CPubKey()});
+    }
+    condQueue.notify_one();
+
+    return true;
+}
+
+CTxAdmissionStats CTxAdmissionQueue::GetStats() {
+    CTxAdmissionStats stats;
+    stats.batches  = nBatches;
+    stats.received = nReceived;
+    stats.dropped  = nDropped;
+    stats.accepted = nAccepted;
+    stats.rejected = nRejected;
+    {
+        boost::unique_lock<boost::mutex> lock(mtxQueue);
+        stats.queued = queue.size();
+    }
+    return stats;
+}
+
+bool CTxAdmissionQueue::PopBatch(vector<Item> &batch) {
+    boost::unique_lock<boost::mutex> lock(mtxQueue);
+    while (queue.empty())
+        condQueue.wait(lock);
+
+    // Let a burst build up a bit, so that it is admitted under a single cs_main lock
+    if (queue.size() < TX_ADMISSION_BATCH_SIZE)
+        condQueue.timed_wait(lock, boost::posix_time::milliseconds(TX_ADMISSION_BATCH_WAIT_MS));
+
+    size_t count = std::min<size_t>(queue.size(), TX_ADMISSION_BATCH_SIZE);
+    batch.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        batch.push_back(std::move(queue.front()));
+        queue.pop_front();
+    }
+
+    return !batch.empty();
+}
+
+void CTxAdmissionQueue::ResolvePubKeys(vector<Item> &batch) {
+    LOCK(cs_main);
+    if (!mempool.cw)
+        return;
+
+    bool fRecover = GetFeatureForkVersion(chainActive.Height() + 1) >= MAJOR_VER_R4;
+    for (auto &item : batch) {
+        const CUserID &txUid = item.pBaseTx->txUid;
+        if (fRecover && CPubKey::IsCompactSignature(item.pBaseTx->signature)) {
+            item.fRecover = true;
+        } else if (txUid.is<CPubKey>()) {
+            item.pubKey = txUid.get<CPubKey>();
+        } else if (txUid.is<CRegID>()) {
+            CAccount account;
+            if (mempool.cw->accountCache.GetAccount(txUid, account))
+                item.pubKey = account.owner_pubkey;
+        }
+    }
+}
+
+void CTxAdmissionQueue::VerifyBatch(vector<Item> &batch) {
+    vector<CSigCheck> checks;
+    checks.reserve(batch.size());
+    for (const auto &item : batch) {
+        if (item.fRecover)
+            checks.emplace_back(item.pBaseTx->GetHash(), item.pBaseTx->signature);
+        else if (item.pubKey.IsValid() && !item.pBaseTx->signature.empty())
+            checks.emplace_back(item.pBaseTx->GetHash(), item.pBaseTx->signature, item.pubKey);
+    }
+
+    // The results are not used here, a valid signature lands in the signature cache and
+    // the serial execution in AcceptToMemoryPool() does not need to verify it again.
+    vector<bool> results;
+    sigVerifyPool.VerifyEach(checks, results);
+}
+
+void CTxAdmissionQueue::AdmitBatch(vector<Item> &batch, vector<bool> &accepted) {
+    LOCK(cs_main);
+    for (size_t i = 0; i < batch.size(); i++) {
+        CNode *pFrom      = batch[i].pFrom;
+        CBaseTx *pBaseTx  = batch[i].pBaseTx.get();
+        CInv inv(MSG_TX, pBaseTx->GetHash());
+
+        CValidationState state;
+        if (AcceptToMemoryPool(mempool, state, batch[i].pBaseTx, true)) {
+            accepted[i] = true;
+            mapAlreadyAskedFor.erase(inv);
+            nAccepted++;
+
+            LogPrint(BCLog::NET, "[%d]~ %s %s : accepted %s (poolsz %u)\n", pBaseTx->valid_height,
+                     pFrom->addr.ToString(), pFrom->cleanSubVer, inv.hash.ToString(), mempool.memPoolTxs.size());
+            continue;
+        }
+
+        nRejected++;
+        int32_t nDoS = 0;
+        if (state.IsInvalid(nDoS)) {
+            LogPrint(BCLog::NET, "[%d]~ %s from %s %s not accepted into mempool: %s\n", pBaseTx->valid_height,
+                     inv.hash.ToString(), pFrom->addr.ToString(), pFrom->cleanSubVer, state.GetRejectReason());
+
+            if (!pFrom->fDisconnect)
+                pFrom->PushMessage(NetMsgType::REJECT, string(NetMsgType::TX), state.GetRejectCode(),
+                                   state.GetRejectReason(), inv.hash);
+        }
+    }
+}
+
+void CTxAdmissionQueue::RelayBatch(vector<Item> &batch, const vector<bool> &accepted) {
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (accepted[i])
+            RelayTransaction(batch[i].pBaseTx, batch[i].pBaseTx->GetHash());
+    }
+}
+
+void CTxAdmissionQueue::ReleaseBatch(vector<Item> &batch) {
+    LOCK(cs_vNodes);
+    for (auto &item : batch)
+        item.pFrom->Release();
+}
+
+void CTxAdmissionQueue::ThreadDispatch() {
+    SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
+    while (true) {
+        vector<Item> batch;
+        if (!PopBatch(batch))
+            continue;
+
+        auto bm = MAKE_BENCHMARK("admit tx batch");
+        nBatches++;
+
+        vector<bool> accepted(batch.size(), false);
+        try {
+            ResolvePubKeys(batch);
+            VerifyBatch(batch);
+            AdmitBatch(batch, accepted);
+            RelayBatch(batch, accepted);
+        } catch (...) {
+            ReleaseBatch(batch);
+            throw;
+        }
+        ReleaseBatch(batch);
+
+        LogPrint(BCLog::NET, "admitted tx batch, size=%u, accepted=%u\n", batch.size(),
+                 std::count(accepted.begin(), accepted.end(), true));
+    }
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_TXADMISSION_H
+#define P2P_TXADMISSION_H
+
+#include "entities/key.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+using namespace std;
+
+class CBaseTx;
+class CNode;
+
+/** -txadmission default */
+static const bool DEFAULT_TX_ADMISSION            = true;
+/** Max number of txs taken off the queue and admitted under one cs_main lock */
+static const uint32_t TX_ADMISSION_BATCH_SIZE     = 1000;
+/** How long the dispatcher lingers for a batch to fill up, in milliseconds */
+static const int64_t TX_ADMISSION_BATCH_WAIT_MS   = 10;
+/** Max number of txs waiting for admission, further txs from peers are dropped */
+static const uint32_t MAX_TX_ADMISSION_QUEUE_SIZE = 100000;
+
+struct CTxAdmissionStats {
+    uint64_t batches  = 0;
+    uint64_t received = 0;
+    uint64_t dropped  = 0;  // queue full
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t queued   = 0;  // current queue length
+};
+
+/**
+ * Network transaction admission queue.
+ *
+ * Txs received from all peers are collected into batches. For each batch:
+ *  1. the sender pubkeys are resolved against the mempool view (cs_main, cheap);
+ *     the signers of compact signatures are recovered in stage 2 instead
+ *  2. tx hashes and signatures are checked on the signature verification pool
+ *     (no locks), which warms up the signature cache
+ *  3. the txs are executed serially against the mempool view (cs_main)
+ *  4. accepted txs are relayed to the other peers (no cs_main)
+ */
+class CTxAdmissionQueue {
+public:
+    struct Item {
+        CNode *pFrom;  // referenced while queued
+        std::shared_ptr<CBaseTx> pBaseTx;
+        CPubKey pubKey;  // resolved in stage 1, invalid if it can not be known before execution
+        bool fRecover = false;  // compact signature, its signer is recovered in stage 2
+    };
+
+public:
+    CTxAdmissionQueue(): fRunning(false) {}
+
+    // Start the dispatcher
+    void Start(boost::thread_group &threadGroup);
+    bool IsRunning() const { return fRunning; }
+
+    // Called from the message handler thread, returns false if the tx was dropped
+    bool Push(CNode *pFrom, const std::shared_ptr<CBaseTx> &pBaseTx);
+
+    CTxAdmissionStats GetStats();
+
+    void ThreadDispatch();
+
+private:
+    bool PopBatch(vector<Item> &batch);
+    void ResolvePubKeys(vector<Item> &batch);
+    void VerifyBatch(vector<Item> &batch);
+    void AdmitBatch(vector<Item> &batch, vector<bool> &accepted);
+    void RelayBatch(vector<Item> &batch, const vector<bool> &accepted);
+    void ReleaseBatch(vector<Item> &batch);
+
+private:
+    std::atomic<bool> fRunning;
+
+    boost::mutex mtxQueue;  // taken before cs_vNodes
+    boost::condition_variable condQueue;
+    deque<Item> queue;
+
+    std::atomic<uint64_t> nBatches{0};
+    std::atomic<uint64_t> nReceived{0};
+    std::atomic<uint64_t> nDropped{0};
+    std::atomic<uint64_t> nAccepted{0};
+    std::atomic<uint64_t> nRejected{0};
+};
+
+extern CTxAdmissionQueue txAdmissionQueue;
+
+void StartTxAdmission(boost::thread_group &threadGroup);
+
+#endif  // P2P_TXADMISSION_H
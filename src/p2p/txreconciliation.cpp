@@ -0,0 +1,241 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txreconciliation.h"
+
+#include "crypto/hash.h"
+#include "crypto/siphash.h"
+
+#include <algorithm>
+#include <cassert>
+
+// Finalizer of MurmurHash3, the short ids are uniform already, this only spreads them
+// over the cells differently for every hash
+static uint32_t MixShortId(uint32_t shortId, uint32_t nSeed) {
+    uint32_t h = shortId ^ (nSeed * 0x9e3779b9);
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint64_t MakeCell(uint32_t shortId) {
+    return ((uint64_t)shortId << 32) | MixShortId(shortId, RECON_SKETCH_HASHES);
+}
+
+CReconSketch::CReconSketch(uint32_t nCells) {
+    nCells = std::min(std::max(nCells, RECON_SKETCH_HASHES), MAX_RECON_SKETCH_CELLS);
+    cells.assign(nCells - nCells % RECON_SKETCH_HASHES, 0);
+}
+
+uint32_t CReconSketch::GetCellCount(uint32_t nDiff) {
+    uint64_t nCells = (uint64_t)nDiff * RECON_SKETCH_CELLS_PER_DIFF + RECON_SKETCH_EXTRA_CELLS;
+    // rounded up, the constructor rounds down
+    nCells += RECON_SKETCH_HASHES - 1;
+    return std::min<uint64_t>(nCells, MAX_RECON_SKETCH_CELLS);
+}
+
+bool CReconSketch::IsValid() const {
+    return !cells.empty() && cells.size() <= MAX_RECON_SKETCH_CELLS && cells.size() % RECON_SKETCH_HASHES == 0;
+}
+
+uint32_t CReconSketch::GetCellIndex(uint32_t shortId, uint32_t nHash) const {
+    uint32_t nPart = cells.size() / RECON_SKETCH_HASHES;
+    return nHash * nPart + (uint32_t)(((uint64_t)MixShortId(shortId, nHash) * nPart) >> 32);
+}
+
+void CReconSketch::Add(uint32_t shortId) {
+    uint64_t cell = MakeCell(shortId);
+    for (uint32_t n = 0; n < RECON_SKETCH_HASHES; n++)
+        cells[GetCellIndex(shortId, n)] ^= cell;
+}
+
+void CReconSketch::Merge(const CReconSketch &other) {
+    assert(other.cells.size() == cells.size());
+    for (size_t i = 0; i < cells.size(); i++)
+        cells[i] ^= other.cells[i];
+}
+
+bool CReconSketch::Decode(vector<uint32_t> &shortIds) const {
+    vector<uint64_t> left = cells;
+    auto IsPure = [&left](uint32_t i) {
+        uint32_t shortId = left[i] >> 32;
+        return shortId != 0 && left[i] == MakeCell(shortId);
+    };
+
+    // the cells with a single id, a cell is queued again once taking an id out leaves it so
+    vector<uint32_t> pure;
+    for (uint32_t i = 0; i < left.size(); i++) {
+        if (IsPure(i))
+            pure.push_back(i);
+    }
+
+    while (!pure.empty()) {
+        uint32_t i = pure.back();
+        pure.pop_back();
+        if (!IsPure(i))
+            continue;
+
+        // a difference can not be larger than the cells, a bogus sketch could loop
+        if (shortIds.size() >= left.size())
+            return false;
+
+        uint32_t shortId = left[i] >> 32;
+        shortIds.push_back(shortId);
+        uint64_t cell = left[i];
+        for (uint32_t n = 0; n < RECON_SKETCH_HASHES; n++) {
+            uint32_t nIndex = GetCellIndex(shortId, n);
+            left[nIndex] ^= cell;
+            if (IsPure(nIndex))
+                pure.push_back(nIndex);
+        }
+    }
+
+    return std::all_of(left.begin(), left.end(), [](uint64_t cell) { return cell == 0; });
+}
+
+CTxReconState::CTxReconState(bool fInitiatorIn, uint64_t nLocalSalt, uint64_t nRemoteSalt)
+    : fInitiator(fInitiatorIn), fFlood(false) {
+    // both sides get the same keys
+    CHashWriter hasher(SER_GETHASH, 0);
+    hasher << std::min(nLocalSalt, nRemoteSalt) << std::max(nLocalSalt, nRemoteSalt);
+    uint256 hash = hasher.GetHash();
+    k0           = hash.GetUint64(0);
+    k1           = hash.GetUint64(1);
+}
+
+uint32_t CTxReconState::GetShortId(const uint256 &txid) const {
+    // 0 would not show in a sketch
+    uint32_t shortId = SipHashUint256(k0, k1, txid);
+    return shortId != 0 ? shortId : 1;
+}
+
+bool CTxReconState::AddTx(const uint256 &txid) {
+    if (txs.size() >= MAX_TXRECON_SET_SIZE)
+        return false;
+
+    auto ret = txs.emplace(GetShortId(txid), txid);
+    return ret.second || ret.first->second == txid;
+}
+
+void CTxReconState::RemoveTx(const uint256 &txid) {
+    auto it = txs.find(GetShortId(txid));
+    if (it != txs.end() && it->second == txid)
+        txs.erase(it);
+}
+
+void CTxReconState::TakeSnapshot(int64_t nNow) {
+    snapshot.swap(txs);
+    fPending       = true;
+    nRoundDeadline = nNow + TXRECON_ROUND_TIMEOUT;
+}
+
+void CTxReconState::FailRound(vector<uint256> &announceTxids) {
+    // the difference was larger than expected or the peer did not answer, all our set goes in invs
+    nFailures++;
+    for (const auto &item : snapshot)
+        announceTxids.push_back(item.second);
+    if (fInitiator)
+        q = std::min(std::max(q * 2, RECON_DEFAULT_Q), MAX_RECON_Q);
+}
+
+CReconSketch CTxReconState::MakeSketch(uint32_t nCells) const {
+    CReconSketch sketch(nCells);
+    for (const auto &item : snapshot)
+        sketch.Add(item.first);
+    return sketch;
+}
+
+CReconRequest CTxReconState::MakeRequest(int64_t nNow) {
+    TakeSnapshot(nNow);
+    nNextRequest = nNow + TXRECON_INTERVAL;
+
+    CReconRequest request;
+    request.nSetSize = snapshot.size();
+    request.nQ       = (uint16_t)(q * RECON_Q_PRECISION);
+    return request;
+}
+
+bool CTxReconState::ProcessRequest(const CReconRequest &request, int64_t nNow, CReconSketch &sketch) {
+    if (fInitiator || fPending)
+        return false;
+
+    TakeSnapshot(nNow);
+    uint32_t nLocalSize = snapshot.size();
+    uint32_t nSizeDiff  = nLocalSize > request.nSetSize ? nLocalSize - request.nSetSize : request.nSetSize - nLocalSize;
+    double expectedDiff = nSizeDiff + (double)request.nQ / RECON_Q_PRECISION * std::min(nLocalSize, request.nSetSize) + 1;
+    sketch = MakeSketch(CReconSketch::GetCellCount((uint32_t)std::min<double>(expectedDiff, MAX_RECON_SKETCH_CELLS)));
+    return true;
+}
+
+bool CTxReconState::ProcessSketch(const CReconSketch &sketch, vector<uint256> &announceTxids, CReconDiff &diff) {
+    if (!fInitiator || !fPending)
+        return false;
+
+    fPending = false;
+    nRounds++;
+
+    vector<uint32_t> shortIds;
+    diff.fSuccess = false;
+    if (sketch.IsValid()) {
+        CReconSketch local = MakeSketch(sketch.GetCellCount());
+        local.Merge(sketch);
+        diff.fSuccess = local.Decode(shortIds);
+    }
+    if (diff.fSuccess) {
+        for (auto shortId : shortIds) {
+            auto it = snapshot.find(shortId);
+            if (it != snapshot.end())
+                announceTxids.push_back(it->second);
+            else
+                diff.shortIds.push_back(shortId);
+        }
+
+        // share of the smaller set that differed beyond the set sizes
+        size_t nLocalSize  = snapshot.size();
+        size_t nRemoteSize = nLocalSize - announceTxids.size() + diff.shortIds.size();
+        size_t nMinSize    = std::min(nLocalSize, nRemoteSize);
+        size_t nSizeDiff   = nLocalSize > nRemoteSize ? nLocalSize - nRemoteSize : nRemoteSize - nLocalSize;
+        if (nMinSize > 0)
+            q = std::min((double)(shortIds.size() - nSizeDiff) / nMinSize, MAX_RECON_Q);
+    } else {
+        FailRound(announceTxids);
+    }
+
+    snapshot.clear();
+    return true;
+}
+
+bool CTxReconState::ProcessDiff(const CReconDiff &diff, vector<uint256> &announceTxids) {
+    if (fInitiator || !fPending)
+        return false;
+
+    fPending = false;
+    nRounds++;
+    if (diff.fSuccess) {
+        for (auto shortId : diff.shortIds) {
+            auto it = snapshot.find(shortId);
+            if (it != snapshot.end())
+                announceTxids.push_back(it->second);
+        }
+    } else {
+        FailRound(announceTxids);
+    }
+
+    snapshot.clear();
+    return true;
+}
+
+bool CTxReconState::ExpireRound(int64_t nNow, vector<uint256> &announceTxids) {
+    if (!fPending || nNow < nRoundDeadline)
+        return false;
+
+    fPending = false;
+    nRounds++;
+    FailRound(announceTxids);
+    snapshot.clear();
+    return true;
+}
@@ -0,0 +1,181 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_TXRECONCILIATION_H
+#define P2P_TXRECONCILIATION_H
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/** Tx reconciliation version announced by sendrecon */
+static const uint32_t TXRECON_VERSION                = 1;
+/** Seconds between two reconciliations the initiator starts with a peer */
+static const int64_t TXRECON_INTERVAL                = 4;
+/** Seconds a round waits for the sketch or the reconcildiff, the snapshot goes in invs afterwards */
+static const int64_t TXRECON_ROUND_TIMEOUT           = 10;
+/** Outbound reconciling peers the txs are still flooded to in invs, for a low relay latency */
+static const int32_t TXRECON_FLOOD_OUTBOUND_PEERS    = 2;
+/** Txs queued for the reconciliation with a peer, the ones beyond go in invs */
+static const size_t MAX_TXRECON_SET_SIZE             = 10000;
+
+/** Cells of a sketch, each one a pair of 32 bit xors, per element of the difference it is sized for */
+static const uint32_t RECON_SKETCH_CELLS_PER_DIFF    = 2;
+/** Cells added to every sketch, the small differences decode less often */
+static const uint32_t RECON_SKETCH_EXTRA_CELLS       = 12;
+/** Cells an element is added to, one in each third of the sketch */
+static const uint32_t RECON_SKETCH_HASHES            = 3;
+static const uint32_t MAX_RECON_SKETCH_CELLS         = 3 * 10000;
+
+/** Fixed point precision of q in a reqrecon */
+static const uint16_t RECON_Q_PRECISION              = 1 << 14;
+/** q of the first reconciliation with a peer, and the least after a failed one */
+static const double RECON_DEFAULT_Q                  = 0.25;
+static const double MAX_RECON_Q                      = 2.0;
+
+/**
+ * The reqrecon message, from the initiator of a reconciliation: the size of its set and
+ * q, the share of the smaller set the last difference was beyond the set sizes. The
+ * responder sizes its sketch for |its size - nSetSize| + q * min(its size, nSetSize) + 1.
+ */
+class CReconRequest {
+public:
+    uint32_t nSetSize;
+    uint16_t nQ;
+
+    CReconRequest() : nSetSize(0), nQ(0) {}
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(nSetSize);
+        READWRITE(nQ);
+    )
+};
+
+/**
+ * The sketch message, a set of short ids as an invertible Bloom lookup table.
+ *
+ * A short id is xored into one cell of each third of the sketch, with a checksum of it. A
+ * sketch of a set xored with the sketch of another set of the same size is the sketch of
+ * their symmetric difference: the ids both have cancel out. A cell left with a single id
+ * holds the id and its checksum, the id is taken out of its cells, which may leave other
+ * cells with a single id, until all the cells are empty. The sketch is about twice the
+ * size of the difference times 8 bytes however large the sets are.
+ */
+class CReconSketch {
+public:
+    CReconSketch() {}
+    explicit CReconSketch(uint32_t nCells);
+
+    // Cells of a sketch sized for a difference of nDiff short ids
+    static uint32_t GetCellCount(uint32_t nDiff);
+
+    uint32_t GetCellCount() const { return cells.size(); }
+    bool IsValid() const;
+
+    void Add(uint32_t shortId);
+    // Xor the sketch of the other set in, requires the same cell count
+    void Merge(const CReconSketch &other);
+    // The short ids of the difference, false if they can not all be told apart
+    bool Decode(vector<uint32_t> &shortIds) const;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(cells);
+    )
+
+private:
+    uint32_t GetCellIndex(uint32_t shortId, uint32_t nHash) const;
+
+    vector<uint64_t> cells;  // xor of the short ids in the high half, of their checksums in the low half
+};
+
+/**
+ * The reconcildiff message, from the initiator once it decoded the sketch: the short ids
+ * of the responder it lacks, to be announced in an inv. A sketch that failed to decode
+ * asks for all the set.
+ */
+class CReconDiff {
+public:
+    bool fSuccess;
+    vector<uint32_t> shortIds;
+
+    CReconDiff() : fSuccess(false) {}
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(fSuccess);
+        READWRITE(shortIds);
+    )
+};
+
+/**
+ * Tx announcement by set reconciliation with a peer that sent sendrecon.
+ *
+ * Instead of an inv of 36 bytes per tx for every tx and every peer, the txs for the peer
+ * are queued in a set by a 32 bit short id, SipHash of the txid keyed with the salts both
+ * sides sent in sendrecon. Every TXRECON_INTERVAL seconds the outbound side, the
+ * initiator, sends a reqrecon; the responder answers with a sketch of its set; the
+ * initiator xors in the sketch of its own set and decodes the difference. It announces
+ * the txs the responder lacks in an inv and sends the short ids it lacks itself in a
+ * reconcildiff, the responder announces those. The txs both sides queued, which the
+ * other got from elsewhere meanwhile, cost nothing. Both sets are snapshot when the round
+ * starts, the txs relayed during it wait for the next one. A round that fails, or whose
+ * next message does not come within TXRECON_ROUND_TIMEOUT, announces its snapshot in invs.
+ *
+ * Requires CNode::cs_inventory.
+ */
+class CTxReconState {
+public:
+    const bool fInitiator;
+    // The txs are still flooded to the peer in invs, only the ones beyond the set limit otherwise
+    bool fFlood;
+
+    // Reconciliations done and the ones whose sketch failed to decode
+    uint64_t nRounds   = 0;
+    uint64_t nFailures = 0;
+
+public:
+    CTxReconState(bool fInitiatorIn, uint64_t nLocalSalt, uint64_t nRemoteSalt);
+
+    uint32_t GetShortId(const uint256 &txid) const;
+
+    // Queue a tx for the next reconciliation, false if it is to go in an inv: the set is
+    // full or another tx of the set has its short id
+    bool AddTx(const uint256 &txid);
+    // The peer has the tx, it announced it to us
+    void RemoveTx(const uint256 &txid);
+    size_t GetSetSize() const { return txs.size(); }
+
+    // Initiator: start a reconciliation
+    bool IsRequestDue(int64_t nNow) const { return fInitiator && !fPending && nNow >= nNextRequest; }
+    CReconRequest MakeRequest(int64_t nNow);
+    // Initiator: the txs to announce and the diff to send back, false if no sketch was
+    // expected. An invalid sketch fails the round like one that does not decode
+    bool ProcessSketch(const CReconSketch &sketch, vector<uint256> &announceTxids, CReconDiff &diff);
+
+    // Responder: the sketch of our set, false if a round is pending already
+    bool ProcessRequest(const CReconRequest &request, int64_t nNow, CReconSketch &sketch);
+    // Responder: the txs to announce, false if no diff was expected
+    bool ProcessDiff(const CReconDiff &diff, vector<uint256> &announceTxids);
+
+    // Either side: fail the round pending if the peer did not answer in time, its snapshot to announce
+    bool ExpireRound(int64_t nNow, vector<uint256> &announceTxids);
+
+private:
+    CReconSketch MakeSketch(uint32_t nCells) const;
+    void TakeSnapshot(int64_t nNow);
+    void FailRound(vector<uint256> &announceTxids);
+
+    uint64_t k0, k1;
+    unordered_map<uint32_t, uint256> txs;       // by short id
+    unordered_map<uint32_t, uint256> snapshot;  // the set of the round pending
+    bool fPending          = false;
+    int64_t nRoundDeadline = 0;
+    int64_t nNextRequest   = 0;
+    double q             = RECON_DEFAULT_Q;
+};
+
+#endif  // P2P_TXRECONCILIATION_H
@@ -5,6 +5,8 @@
 
 #include "block.h"
 
+#include "crypto/sha256.h"
+
 #include "entities/account.h"
 #include "tx/blockpricemediantx.h"
 #include "main.h"
@@ -32,13 +34,33 @@ uint256 CBlockHeader::ComputeSignatureHash() const {
     return ss.GetHash();
 }
 
-uint256 CBlock::BuildMerkleTree() const {
-    vMerkleTree.clear();
-    for (const auto& ptx : vptx) {
-        vMerkleTree.push_back(ptx->GetHash());
+uint256 ComputeMerkleTree(vector<uint256> &vMerkleTree) {
+    size_t nLeaves = vMerkleTree.size();
+    size_t nTotal  = nLeaves;
+    for (size_t nSize = nLeaves; nSize > 1; nSize = (nSize + 1) / 2)
+        nTotal += (nSize + 1) / 2;
+    vMerkleTree.reserve(nTotal);
+
+    // The two children of a node are adjacent in vMerkleTree, so every full pair of a level is one 64-byte
+    // input of SHA256D64, which hashes several of them at once. Only an odd last node is hashed with itself.
+    size_t j = 0;
+    for (size_t nSize = nLeaves; nSize > 1; nSize = (nSize + 1) / 2) {
+        size_t nPairs = nSize / 2;
+        size_t nOut   = vMerkleTree.size();
+        vMerkleTree.resize(nOut + (nSize + 1) / 2);
+        SHA256D64(vMerkleTree[nOut].begin(), vMerkleTree[j].begin(), nPairs);
+        if (nSize & 1) {
+            const uint256 &last = vMerkleTree[j + nSize - 1];
+            vMerkleTree[nOut + nPairs] = Hash(BEGIN(last), END(last), BEGIN(last), END(last));
+        }
+        j += nSize;
     }
+    return (vMerkleTree.empty() ? uint256() : vMerkleTree.back());
+}
+
+uint256 ComputeMerkleTreePairwise(vector<uint256> &vMerkleTree) {
     int32_t j = 0;
-    for (int32_t nSize = vptx.size(); nSize > 1; nSize = (nSize + 1) / 2) {
+    for (int32_t nSize = vMerkleTree.size(); nSize > 1; nSize = (nSize + 1) / 2) {
         for (int32_t i = 0; i < nSize; i += 2) {
             int32_t i2 = min(i + 1, nSize - 1);
             vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j + i]), END(vMerkleTree[j + i]),
@@ -49,6 +71,14 @@ uint256 CBlock::BuildMerkleTree() const {
     return (vMerkleTree.empty() ? uint256() : vMerkleTree.back());
 }
 
+uint256 CBlock::BuildMerkleTree() const {
+    vMerkleTree.clear();
+    for (const auto& ptx : vptx) {
+        vMerkleTree.push_back(ptx->GetHash());
+    }
+    return ComputeMerkleTree(vMerkleTree);
+}
+
 vector<uint256> CBlock::GetMerkleBranch(int32_t index) const {
     if (vMerkleTree.empty())
         BuildMerkleTree();
@@ -194,6 +224,43 @@ bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block) {
     return true;
 }
 
+bool ReadRawBlockFromDisk(const CDiskBlockPos &pos, const uint256 &blockHash, CSerializeData &data) {
+    // The block is preceded by the message start and its size, see WriteBlockToDisk()
+    const uint32_t nIndexHeaderSize = MESSAGE_START_SIZE + sizeof(uint32_t);
+    if (pos.nPos < nIndexHeaderSize)
+        return ERRORMSG("ReadRawBlockFromDisk : bad block position %s", pos.ToString());
+
+    CAutoFile filein = CAutoFile(OpenBlockFile(CDiskBlockPos(pos.nFile, pos.nPos - nIndexHeaderSize), true),
+                                 SER_DISK, CLIENT_VERSION);
+    if (!filein)
+        return ERRORMSG("ReadRawBlockFromDisk : OpenBlockFile failed");
+
+    try {
+        MessageStartChars messageStart;
+        uint32_t nSize;
+        filein >> FLATDATA(messageStart) >> nSize;
+        if (memcmp(messageStart, SysCfg().MessageStart(), MESSAGE_START_SIZE) != 0)
+            return ERRORMSG("ReadRawBlockFromDisk : message start mismatch at %s", pos.ToString());
+        if (nSize > MAX_BLOCK_SIZE)
+            return ERRORMSG("ReadRawBlockFromDisk : block size %u too large at %s", nSize, pos.ToString());
+
+        CBlockHeader header;
+        filein >> header;
+        if (header.GetHash() != blockHash)
+            return ERRORMSG("ReadRawBlockFromDisk : GetHash() doesn't match at %s", pos.ToString());
+
+        if (fseek(filein, pos.nPos, SEEK_SET) != 0)
+            return ERRORMSG("ReadRawBlockFromDisk : fseek failed");
+        size_t offset = data.size();
+        data.resize(offset + nSize);
+        filein.read(&data[offset], nSize);
+    } catch (std::exception &e) {
+        return ERRORMSG("Deserialize or I/O error - %s", e.what());
+    }
+
+    return true;
+}
+
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx) {
     auto pBlock = std::make_shared<CBlock>();
     const CBlockIndex* pBlockIndex = chainActive[ txCord.GetHeight() ];
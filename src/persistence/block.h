@@ -452,6 +452,8 @@ struct CBlockLocator {
 bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos);
 bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block);
 bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block);
+// Append the serialized block at pos to data as it is on disk, only its header is deserialized to check the hash
+bool ReadRawBlockFromDisk(const CDiskBlockPos &pos, const uint256 &blockHash, CSerializeData &data);
 
 
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx);
@@ -473,6 +475,15 @@ bool ReadTxFromDisk(const CTxCord txCord, std::shared_ptr<TxType> &pTx) {
 
 bool GetBlockHeader(CBlockIndex *pBlockIndex, CBlockHeader &header);
 
+/**
+ * Appends the inner levels of the merkle tree to vMerkleTree, which holds the leaves on entry,
+ * and returns the root (null for no leaves). Same tree as the pairwise double-SHA256 build.
+ */
+uint256 ComputeMerkleTree(vector<uint256> &vMerkleTree);
+
+/** The same tree built one pair at a time, as CBlock::BuildMerkleTree() did before. Kept as the reference. */
+uint256 ComputeMerkleTreePairwise(vector<uint256> &vMerkleTree);
+
 bool IsGenesisBlock(const CBlock &block);
 bool IsGenesisBlock(CBlockIndex *pBlockIndex);
 
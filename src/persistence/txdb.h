@@ -22,7 +22,7 @@ using namespace json_spirit;
 
 class CTxMemCache {
 public:
-    typedef unordered_map<uint256, bool, CUint256Hasher> TxIdMap;
+    typedef unordered_map<uint256, bool, CSaltedUint256Hasher> TxIdMap;
 public:
     CTxMemCache() : pBase(nullptr) {}
     CTxMemCache(CTxMemCache *pBaseIn) : pBase(pBaseIn) {}
@@ -288,11 +288,11 @@ Object GetTxDetailJSON(const uint256& txid) {
         }
 
         {
-            pBaseTx = mempool.Lookup(txid);
-            if (pBaseTx.get()) {
-                obj = pBaseTx->ToJson(*pCw);
+            auto spMemPoolTx = mempool.Lookup(txid);
+            if (spMemPoolTx) {
+                obj = spMemPoolTx->ToJson(*pCw);
                 CDataStream ds(SER_DISK, CLIENT_VERSION);
-                ds << pBaseTx;
+                ds << spMemPoolTx;
                 obj.push_back(Pair("rawtx", HexStr(ds.begin(), ds.end())));
                 return obj;
             }
@@ -147,6 +147,7 @@ extern Value getcontractassets(const  Array& params, bool fHelp);
 extern Value getfcoingenesistxinfo(const Array& params, bool fHelp);
 extern Value getblockcount(const Array& params, bool fHelp);
 extern Value getrawmempool(const Array& params, bool fHelp);
+extern Value getmempoolstats(const Array& params, bool fHelp);
 extern Value getblock(const Array& params, bool fHelp);
 extern Value verifychain(const Array& params, bool fHelp);
 extern Value getcontractregid(const Array& params, bool fHelp);
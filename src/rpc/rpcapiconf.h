@@ -38,6 +38,7 @@ static const CRPCCommand vRPCCommands[] =
     { "getblockcount",                  &getblockcount,                     true,      true,        false   },
     { "getblock",                       &getblock,                          true,      false,       false   },
     { "getrawmempool",                  &getrawmempool,                     true,      false,       false   },
+    { "getmempoolstats",                &getmempoolstats,                   true,      false,       false   },
     { "verifychain",                    &verifychain,                       true,      false,       false   },
     { "getblockundo",                   &getblockundo,                      true,      false,       false   },
     { "getswapcoindetail",              &getswapcoindetail,                 true,      false,       false   },
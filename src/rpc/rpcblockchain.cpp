@@ -18,6 +18,7 @@
 #include "tx/tx.h"
 #include "tx/coinminttx.h"
 #include "miner/pbftmanager.h"
+#include "p2p/txadmission.h"
 
 using namespace json_spirit;
 using namespace std;
@@ -171,6 +172,189 @@ Value getrawmempool(const Array& params, bool fHelp)
     }
 }
 
+Value getmempoolstats(const Array& params, bool fHelp) {
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getmempoolstats ( \"top_count\" )\n"
+            "\nReturns statistics of the transactions in the memory pool, taken from the counters of the pool\n"
+            "without executing any transaction.\n"
+            "\nArguments:\n"
+            "1.\"top_count\"   (numeric, optional) number of top senders to list, default is 10\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": n,                   (numeric) transaction count\n"
+            "  \"bytes\": n,                  (numeric) total size of the transactions in bytes\n"
+            "  \"tx_types\": {                (json object) counters per transaction type\n"
+            "    \"type\": {\n"
+            "      \"count\": n,              (numeric) transactions in the pool\n"
+            "      \"bytes\": n,              (numeric) size of the transactions in the pool\n"
+            "      \"added\": n,              (numeric) transactions added since startup\n"
+            "      \"removed\": n,            (numeric) transactions removed since startup\n"
+            "      \"check_count\": n,        (numeric) executions in the pool, including the rescans\n"
+            "      \"check_failed\": n,       (numeric) failed executions in the pool\n"
+            "      \"check_time_us\": n,      (numeric) total execution time in microseconds\n"
+            "      \"avg_check_time_us\": n   (numeric) average execution time in microseconds\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"fee_per_kb_histogram\": {   (json object) transactions per declared fee per kb, for each fee symbol\n"
+            "    \"symbol\": [               (json array) fee per kb in sawi of the fee symbol\n"
+            "      { \"max_fee_per_kb\": n, \"count\": n }, ...\n"
+            "    ], ...\n"
+            "  },\n"
+            "  \"age_histogram\": [          (json array) transactions per time in the pool\n"
+            "    { \"max_age_secs\": n, \"count\": n }, ...\n"
+            "  ],\n"
+            "  \"top_senders\": [            (json array) senders with the most transactions in the pool\n"
+            "    { \"addr\": \"addr\", \"count\": n, \"bytes\": n }, ...\n"
+            "  ],\n"
+            "  \"rescan\": {                  (json object) rescans of the pool after the tip changed\n"
+            "    \"count\": n,\n"
+            "    \"last_time_us\": n,\n"
+            "    \"max_time_us\": n,\n"
+            "    \"total_time_us\": n,\n"
+            "    \"last_tx_count\": n,        (numeric) transactions checked by the last rescan\n"
+            "    \"last_removed\": n          (numeric) transactions dropped by the last rescan\n"
+            "  },\n"
+            "  \"admission\": {               (json object) queue of the transactions received from peers\n"
+            "    \"enabled\": true|false,     (boolean) false if -txadmission=0, the other counters stay 0\n"
+            "    \"queued\": n,               (numeric) transactions waiting for admission\n"
+            "    \"received\": n,             (numeric) transactions received since startup\n"
+            "    \"dropped\": n,              (numeric) transactions dropped because the queue was full\n"
+            "    \"accepted\": n,             (numeric) transactions accepted into the pool\n"
+            "    \"rejected\": n,             (numeric) transactions rejected by the pool\n"
+            "    \"batches\": n               (numeric) batches admitted\n"
+            "  }\n"
+            "}\n"
+            "\nExamples\n" +
+            HelpExampleCli("getmempoolstats", "10") + "\nAs json rpc\n" + HelpExampleRpc("getmempoolstats", "10"));
+
+    static const int64_t ageBuckets[] = {60, 300, 600, 1800, 3600, 7200};
+    static const size_t ageBucketCount = sizeof(ageBuckets) / sizeof(ageBuckets[0]) + 1;
+
+    uint32_t topCount = params.size() > 0 ? params[0].get_int() : 10;
+
+    CTxMemPoolStats stats;
+    vector<uint64_t> ageHistogram(ageBucketCount, 0);
+    vector<std::tuple<uint64_t, uint64_t, CKeyID>> senders;  // count, bytes, keyid
+    {
+        LOCK(mempool.cs);
+        stats = mempool.GetStats();
+
+        // the arrival order is the order of the entry times
+        int64_t now   = GetTime();
+        size_t bucket = ageBucketCount - 1;
+        for (const auto &item : mempool.arrivalTxs) {
+            int64_t age = now - mempool.memPoolTxs.at(item.second).GetTime();
+            while (bucket > 0 && age <= ageBuckets[bucket - 1])
+                --bucket;
+            ageHistogram[bucket]++;
+        }
+
+        vector<std::pair<uint64_t, CKeyID>> senderCounts;
+        senderCounts.reserve(mempool.senderTxs.size());
+        for (const auto &item : mempool.senderTxs)
+            senderCounts.emplace_back(item.second.size(), item.first);
+
+        size_t count = std::min<size_t>(topCount, senderCounts.size());
+        std::partial_sort(senderCounts.begin(), senderCounts.begin() + count, senderCounts.end(),
+                          [](const std::pair<uint64_t, CKeyID> &a, const std::pair<uint64_t, CKeyID> &b) {
+                              return a.first > b.first;
+                          });
+        for (size_t i = 0; i < count; i++) {
+            uint64_t bytes = 0;
+            for (const auto &seqTx : mempool.senderTxs.at(senderCounts[i].second))
+                bytes += mempool.memPoolTxs.at(seqTx.second).GetTxSize();
+
+            senders.emplace_back(senderCounts[i].first, bytes, senderCounts[i].second);
+        }
+    }
+
+    Object obj;
+    uint64_t totalCount = 0;
+    uint64_t totalBytes = 0;
+    Object typesObj;
+    for (const auto &item : stats.types) {
+        const CTxMemPoolTypeStats &typeStats = item.second;
+        totalCount += typeStats.count;
+        totalBytes += typeStats.bytes;
+
+        Object typeObj;
+        typeObj.push_back(Pair("count",             typeStats.count));
+        typeObj.push_back(Pair("bytes",             typeStats.bytes));
+        typeObj.push_back(Pair("added",             typeStats.added));
+        typeObj.push_back(Pair("removed",           typeStats.removed));
+        typeObj.push_back(Pair("check_count",       typeStats.checkCount));
+        typeObj.push_back(Pair("check_failed",      typeStats.checkFailed));
+        typeObj.push_back(Pair("check_time_us",     typeStats.checkTimeUs));
+        typeObj.push_back(Pair("avg_check_time_us",
+                               typeStats.checkCount > 0 ? typeStats.checkTimeUs / (int64_t)typeStats.checkCount : 0));
+        typesObj.push_back(Pair(GetTxTypeName(item.first), typeObj));
+    }
+    obj.push_back(Pair("size",      totalCount));
+    obj.push_back(Pair("bytes",     totalBytes));
+    obj.push_back(Pair("tx_types",  typesObj));
+
+    Object feeObj;
+    for (const auto &item : stats.feePerKbHistograms) {
+        Array feeArray;
+        for (size_t i = 0; i < MEMPOOL_FEE_PER_KB_BUCKET_COUNT; i++) {
+            Object bucketObj;
+            if (i < MEMPOOL_FEE_PER_KB_BUCKET_COUNT - 1)
+                bucketObj.push_back(Pair("max_fee_per_kb", MEMPOOL_FEE_PER_KB_BUCKETS[i]));
+            else
+                bucketObj.push_back(Pair("max_fee_per_kb", Value()));
+            bucketObj.push_back(Pair("count", item.second[i]));
+            feeArray.push_back(bucketObj);
+        }
+        feeObj.push_back(Pair(item.first, feeArray));
+    }
+    obj.push_back(Pair("fee_per_kb_histogram", feeObj));
+
+    Array ageArray;
+    for (size_t i = 0; i < ageBucketCount; i++) {
+        Object bucketObj;
+        if (i < ageBucketCount - 1)
+            bucketObj.push_back(Pair("max_age_secs", ageBuckets[i]));
+        else
+            bucketObj.push_back(Pair("max_age_secs", Value()));
+        bucketObj.push_back(Pair("count", ageHistogram[i]));
+        ageArray.push_back(bucketObj);
+    }
+    obj.push_back(Pair("age_histogram", ageArray));
+
+    Array senderArray;
+    for (const auto &sender : senders) {
+        Object senderObj;
+        senderObj.push_back(Pair("addr",    std::get<2>(sender).ToAddress()));
+        senderObj.push_back(Pair("count",   std::get<0>(sender)));
+        senderObj.push_back(Pair("bytes",   std::get<1>(sender)));
+        senderArray.push_back(senderObj);
+    }
+    obj.push_back(Pair("top_senders", senderArray));
+
+    Object rescanObj;
+    rescanObj.push_back(Pair("count",           stats.rescanCount));
+    rescanObj.push_back(Pair("last_time_us",    stats.lastRescanTimeUs));
+    rescanObj.push_back(Pair("max_time_us",     stats.maxRescanTimeUs));
+    rescanObj.push_back(Pair("total_time_us",   stats.totalRescanTimeUs));
+    rescanObj.push_back(Pair("last_tx_count",   stats.lastRescanTxCount));
+    rescanObj.push_back(Pair("last_removed",    stats.lastRescanRemoved));
+    obj.push_back(Pair("rescan", rescanObj));
+
+    CTxAdmissionStats admissionStats = txAdmissionQueue.GetStats();
+    Object admissionObj;
+    admissionObj.push_back(Pair("enabled",  txAdmissionQueue.IsRunning()));
+    admissionObj.push_back(Pair("queued",   admissionStats.queued));
+    admissionObj.push_back(Pair("received", admissionStats.received));
+    admissionObj.push_back(Pair("dropped",  admissionStats.dropped));
+    admissionObj.push_back(Pair("accepted", admissionStats.accepted));
+    admissionObj.push_back(Pair("rejected", admissionStats.rejected));
+    admissionObj.push_back(Pair("batches",  admissionStats.batches));
+    obj.push_back(Pair("admission", admissionObj));
+
+    return obj;
+}
+
 Value getblock(const Array& params, bool fHelp) {
     if (fHelp || params.size() < 1 || params.size() > 3) {
         throw runtime_error(
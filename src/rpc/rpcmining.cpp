@@ -196,6 +196,9 @@ Value getminedblocks(const Array& params, bool fHelp) {
             "    \"blocksize\": n          (numeric) block size (bytes)\n"
             "    \"hash\": xxx             (string) block hash\n"
             "    \"preblockhash\": xxx     (string) pre block hash\n"
+            "    \"template_tx_count\": n  (numeric) transactions packed into the block template before the slot\n"
+            "    \"slot_tx_count\": n      (numeric) transactions packed in the slot\n"
+            "    \"used_time_ms\": n       (numeric) slot time used until the block was signed (ms)\n"
             "  }\n"
             "]\n"
             "\nExamples:\n" +
@@ -221,6 +224,9 @@ Value getminedblocks(const Array& params, bool fHelp) {
         obj.push_back(Pair("block_size",    blockInfo.totalBlockSize));
         obj.push_back(Pair("txid",          blockInfo.hash.ToString()));
         obj.push_back(Pair("preblockhash",  blockInfo.hashPrevBlock.ToString()));
+        obj.push_back(Pair("template_tx_count", (uint64_t)blockInfo.templateTxCount));
+        obj.push_back(Pair("slot_tx_count", (uint64_t)blockInfo.slotTxCount));
+        obj.push_back(Pair("used_time_ms",  blockInfo.usedTimeMs));
         ret.push_back(obj);
     }
 
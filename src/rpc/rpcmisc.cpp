@@ -620,7 +620,7 @@ Value getmemstat(const Array& params, bool fHelp) {
         statObj.push_back(Pair("count", (int64_t)mapBlockIndex.size()));
         uint64_t totalSz = 0;
         if (mapBlockIndex.size() > 0) {
-            const auto &idx = *mapBlockIndex.rbegin()->second;
+            const auto &idx = *mapBlockIndex.begin()->second;
             // need to calc size for each idx?
             totalSz = sizeof(mapBlockIndex) + mapBlockIndex.size() * (sizeof(idx));
         }
@@ -670,23 +670,37 @@ Value getmemstat(const Array& params, bool fHelp) {
     // signatureCache
     {
         Object statObj;
-        uint64_t totalSz = 0;
-        {
-            uint64_t cnt = signatureCache.setValid.size();
-            statObj.push_back(Pair("count", cnt));
-            if (cnt > 0) {
-                const auto &item = signatureCache.setValid.begin();
-                // need to calc size for each idx?
-                totalSz = sizeof(signatureCache) + cnt * (sizeof(item));
-            }
-        }
-        statObj.push_back(Pair("size", SizeToString(totalSz)));
-        statObj.push_back(Pair("size_bytes", totalSz));
+        CSignatureCacheStats stats = signatureCache.GetStats();
+        statObj.push_back(Pair("count", stats.count));
+        statObj.push_back(Pair("capacity", stats.capacity));
+        statObj.push_back(Pair("size", SizeToString(stats.memory)));
+        statObj.push_back(Pair("size_bytes", stats.memory));
+        statObj.push_back(Pair("lookups", stats.lookups));
+        statObj.push_back(Pair("hits", stats.hits));
+        statObj.push_back(Pair("hit_rate", stats.lookups > 0 ? (double)stats.hits / stats.lookups : 0.0));
+        statObj.push_back(Pair("inserts", stats.inserts));
+        statObj.push_back(Pair("evictions", stats.evictions));
+        statObj.push_back(Pair("contentions", stats.contentions));
 
         obj.push_back(Pair("signature_cache", statObj));
 
     }
 
+    // parsed pubkey cache
+    {
+        Object statObj;
+        CPubKeyCacheStats stats = ECC_GetPubKeyCacheStats();
+        uint64_t lookups = stats.hits + stats.misses;
+        statObj.push_back(Pair("count", stats.count));
+        statObj.push_back(Pair("capacity", stats.capacity));
+        statObj.push_back(Pair("hits", stats.hits));
+        statObj.push_back(Pair("misses", stats.misses));
+        statObj.push_back(Pair("hit_rate", lookups > 0 ? (double)stats.hits / lookups : 0.0));
+
+        obj.push_back(Pair("pubkey_cache", statObj));
+
+    }
+
     // mempool;
     {
         Object statObj;
@@ -695,7 +709,7 @@ Value getmemstat(const Array& params, bool fHelp) {
             LOCK(mempool.cs);
             statObj.push_back(Pair("count", (int64_t)mempool.memPoolTxs.size()));
             if (mempool.memPoolTxs.size() > 0) {
-                const auto &item = *mempool.memPoolTxs.rbegin();
+                const auto &item = *mempool.memPoolTxs.begin();
                 // need to calc size for each idx?
                 totalSz = sizeof(mempool.memPoolTxs) + mempool.memPoolTxs.size() * (sizeof(item));
             }
@@ -10,6 +10,7 @@
 #include "netbase.h"
 #include "p2p/protocol.h"
 #include "p2p/node.h"
+#include "p2p/relaycache.h"
 #include "sync.h"
 #include "commons/util/util.h"
 #include "tx/blockrewardtx.h"
@@ -462,7 +463,24 @@ Value getnettotals(const Array& params, bool fHelp) {
             "{\n"
             "  \"totalbytesrecv\": n,   (numeric) Total bytes received\n"
             "  \"totalbytessent\": n,   (numeric) Total bytes sent\n"
-            "  \"timemillis\": t        (numeric) Total cpu time\n"
+            "  \"timemillis\": t,       (numeric) Total cpu time\n"
+            "  \"sendclasses\": {       (object) Messages sent per priority class: consensus, block, tx and addr\n"
+            "    \"consensus\": {\n"
+            "      \"messages\": n,     (numeric) Messages sent\n"
+            "      \"bytes\": n,        (numeric) Bytes sent\n"
+            "      \"avgdelayms\": x,   (numeric) Average time from queued to sent, in milliseconds\n"
+            "      \"maxdelayms\": x    (numeric) Longest time from queued to sent, in milliseconds\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"relaycache\": {        (object) The txs relayed kept for the peers asking for them\n"
+            "    \"entries\": n,        (numeric) Txs kept\n"
+            "    \"bytes\": n,          (numeric) Bytes charged to them\n"
+            "    \"maxbytes\": n,       (numeric) Budget of -maxrelaycache\n"
+            "    \"hits\": n,           (numeric) Requests served from it\n"
+            "    \"misses\": n,         (numeric) Requests for txs not kept\n"
+            "    \"evictions\": n,      (numeric) Txs dropped for the budget before they expired\n"
+            "    \"expirations\": n     (numeric) Txs dropped after 15 minutes\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getnettotals", "") + "\nAs json rpc\n" + HelpExampleRpc("getnettotals", ""));
@@ -471,6 +489,30 @@ Value getnettotals(const Array& params, bool fHelp) {
     obj.push_back(Pair("totalbytesrecv",    CNode::GetTotalBytesRecv()));
     obj.push_back(Pair("totalbytessent",    CNode::GetTotalBytesSent()));
     obj.push_back(Pair("timemillis",        GetTimeMillis()));
+
+    Object sendClasses;
+    for (int32_t i = 0; i < SEND_CLASS_COUNT; i++) {
+        const CSendClassStats &stats = sendClassStats[i];
+        uint64_t nMessages           = stats.nMessages;
+        Object sendClass;
+        sendClass.push_back(Pair("messages",    nMessages));
+        sendClass.push_back(Pair("bytes",       (uint64_t)stats.nBytes));
+        sendClass.push_back(Pair("avgdelayms",  nMessages ? stats.nTotalDelayMicros / 1000.0 / nMessages : 0.0));
+        sendClass.push_back(Pair("maxdelayms",  stats.nMaxDelayMicros / 1000.0));
+        sendClasses.push_back(Pair(GetSendClassName((SendClass)i), sendClass));
+    }
+    obj.push_back(Pair("sendclasses",       sendClasses));
+
+    CRelayCache::Stats relayStats = relayCache.GetStats();
+    Object relay;
+    relay.push_back(Pair("entries",     (uint64_t)relayStats.nEntries));
+    relay.push_back(Pair("bytes",       (uint64_t)relayStats.nBytes));
+    relay.push_back(Pair("maxbytes",    (uint64_t)relayStats.nMaxBytes));
+    relay.push_back(Pair("hits",        relayStats.nHits));
+    relay.push_back(Pair("misses",      relayStats.nMisses));
+    relay.push_back(Pair("evictions",   relayStats.nEvictions));
+    relay.push_back(Pair("expirations", relayStats.nExpirations));
+    obj.push_back(Pair("relaycache",        relay));
     return obj;
 }
 
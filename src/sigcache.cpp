@@ -6,45 +6,147 @@
 
 #include "sigcache.h"
 
-void CSignatureCache::ComputeEntry(uint256& entry, const uint256& sigHash,
+#include "crypto/siphash.h"
+
+void CSignatureCache::Setup(size_t nMaxBytes) {
+    uint256 salt0 = GetRandHash();
+    uint256 salt1 = GetRandHash();
+    k0 = salt0.GetUint64(0);
+    k1 = salt0.GetUint64(1);
+    k2 = salt1.GetUint64(0);
+    k3 = salt1.GetUint64(1);
+
+    size_t nSlotBytes    = sizeof(Slot) + sizeof(uint8_t);
+    uint64_t nBucketsMax = nMaxBytes / nSlotBytes / SIG_CACHE_SHARDS / SIG_CACHE_BUCKET_SLOTS;
+    nBuckets = 0;
+    if (nBucketsMax == 0)
+        return;
+
+    nBuckets = 1;
+    while (nBuckets * 2 <= nBucketsMax)
+        nBuckets *= 2;
+
+    uint64_t nShardSlots = nBuckets * SIG_CACHE_BUCKET_SLOTS;
+    nGenerationSize      = std::max<uint64_t>(nShardSlots / 8, 1);
+    for (auto &shard : shards) {
+        shard.slots.reset(new Slot[nShardSlots]);
+        shard.generations.reset(new uint8_t[nShardSlots]());
+    }
+}
+
+void CSignatureCache::ComputeEntry(uint64_t& tag, uint64_t& check, const uint256& sigHash,
                                    const std::vector<unsigned char>& vchSig,
-                                   const CPubKey& pubKey) {
-    CSHA256()
-        .Write(sigHash.begin(), 32)
-        .Write(&pubKey[0], pubKey.size())
-        .Write(&vchSig[0], vchSig.size())
-        .Finalize(entry.begin());
+                                   const CPubKey& pubKey) const {
+    tag = CSipHasher(k0, k1)
+              .Write(sigHash.begin(), 32)
+              .Write(pubKey.begin(), pubKey.size())
+              .Write(vchSig.data(), vchSig.size())
+              .Finalize();
+    check = CSipHasher(k2, k3)
+                .Write(sigHash.begin(), 32)
+                .Write(pubKey.begin(), pubKey.size())
+                .Write(vchSig.data(), vchSig.size())
+                .Finalize();
+    if (tag == 0)  // reserved for empty slots
+        tag = 1;
 }
 
 bool CSignatureCache::Get(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
                           const CPubKey& pubKey) {
-    uint256 entry;
-    ComputeEntry(entry, sigHash, vchSig, pubKey);
-    std::unique_lock<std::mutex> lock(mtx);
-    return setValid.count(entry);
+    if (nBuckets == 0)
+        return false;
+
+    uint64_t tag, check;
+    ComputeEntry(tag, check, sigHash, vchSig, pubKey);
+
+    Shard &shard = shards[check & (SIG_CACHE_SHARDS - 1)];
+    shard.nLookups.fetch_add(1, std::memory_order_relaxed);
+
+    const Slot *bucket = &shard.slots[(tag & (nBuckets - 1)) * SIG_CACHE_BUCKET_SLOTS];
+    for (uint32_t i = 0; i < SIG_CACHE_BUCKET_SLOTS; i++) {
+        // A slot being overwritten may mix the old and the new entry, which matches
+        // neither unless both 64-bit values collide.
+        if (bucket[i].tag.load(std::memory_order_acquire) == tag &&
+            bucket[i].check.load(std::memory_order_relaxed) == check) {
+            shard.nHits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
 }
 
 void CSignatureCache::Set(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
                           const CPubKey& pubKey) {
-    static int64_t nMaxCacheSize = SysCfg().GetArg("-maxsigcachesize", 50000);
-    if (nMaxCacheSize <= 0) return;
-
-    uint256 entry;
-    ComputeEntry(entry, sigHash, vchSig, pubKey);
-
-    std::unique_lock<std::mutex> lock(mtx);
-
-    while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize) {
-        // Evict a random entry. Random because that helps
-        // foil would-be DoS attackers who might try to pre-generate
-        // and re-use a set of valid signatures just-slightly-greater
-        // than our cache size.
-        UnorderedHashSet::size_type s       = GetRand(setValid.bucket_count());
-        UnorderedHashSet::local_iterator it = setValid.begin(s);
-        if (it != setValid.end(s)) {
-            setValid.erase(*it);
+    if (nBuckets == 0)
+        return;
+
+    uint64_t tag, check;
+    ComputeEntry(tag, check, sigHash, vchSig, pubKey);
+
+    Shard &shard = shards[check & (SIG_CACHE_SHARDS - 1)];
+    std::unique_lock<std::mutex> lock(shard.mtx, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        shard.nContentions.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+    }
+
+    uint64_t first = (tag & (nBuckets - 1)) * SIG_CACHE_BUCKET_SLOTS;
+    uint64_t victim = first;
+    uint8_t victimAge = 0;
+    bool fEmpty = false;
+    for (uint64_t idx = first; idx < first + SIG_CACHE_BUCKET_SLOTS; idx++) {
+        Slot &slot = shard.slots[idx];
+        uint64_t slotTag = slot.tag.load(std::memory_order_relaxed);
+        if (slotTag == tag && slot.check.load(std::memory_order_relaxed) == check)
+            return;  // already cached
+
+        if (fEmpty)
+            continue;
+
+        if (slotTag == 0) {
+            victim = idx;
+            fEmpty = true;
+            continue;
+        }
+
+        // Evict the entry written in the oldest generation, ties go to the first slot
+        uint8_t age = shard.generation - shard.generations[idx];
+        if (age > victimAge || idx == first) {
+            victim = idx;
+            victimAge = age;
         }
     }
 
-    setValid.insert(entry);
+    Slot &slot = shard.slots[victim];
+    slot.tag.store(0, std::memory_order_relaxed);
+    slot.check.store(check, std::memory_order_relaxed);
+    slot.tag.store(tag, std::memory_order_release);
+    shard.generations[victim] = shard.generation;
+
+    if (fEmpty)
+        shard.nCount.fetch_add(1, std::memory_order_relaxed);
+    else
+        shard.nEvictions.fetch_add(1, std::memory_order_relaxed);
+    shard.nInserts.fetch_add(1, std::memory_order_relaxed);
+
+    if (++shard.nGenerationInserts >= nGenerationSize) {
+        shard.generation++;
+        shard.nGenerationInserts = 0;
+    }
+}
+
+CSignatureCacheStats CSignatureCache::GetStats() const {
+    CSignatureCacheStats stats;
+    stats.capacity = nBuckets * SIG_CACHE_BUCKET_SLOTS * SIG_CACHE_SHARDS;
+    stats.memory   = stats.capacity * (sizeof(Slot) + sizeof(uint8_t));
+    for (const auto &shard : shards) {
+        stats.count       += shard.nCount.load(std::memory_order_relaxed);
+        stats.lookups     += shard.nLookups.load(std::memory_order_relaxed);
+        stats.hits        += shard.nHits.load(std::memory_order_relaxed);
+        stats.inserts     += shard.nInserts.load(std::memory_order_relaxed);
+        stats.evictions   += shard.nEvictions.load(std::memory_order_relaxed);
+        stats.contentions += shard.nContentions.load(std::memory_order_relaxed);
+    }
+    return stats;
 }
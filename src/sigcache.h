@@ -7,38 +7,96 @@
 #ifndef COIN_SIGCACHE_H
 #define COIN_SIGCACHE_H
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <vector>
 
 #include "config/chainparams.h"
-#include "crypto/sha256.h"
 #include "entities/key.h"
 #include "commons/random.h"
 #include "commons/uint256.h"
 #include "commons/util/util.h"
 
+/** -maxsigcachesize default, in MB */
+static const int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+/** -maxsigcachesize upper bound, in MB. The option used to be a number of entries (50000) */
+static const int64_t MAX_MAX_SIG_CACHE_SIZE     = 1024;
+/** Number of independently locked shards, must be a power of two */
+static const uint32_t SIG_CACHE_SHARDS          = 16;
+/** An entry may be stored in any slot of its bucket */
+static const uint32_t SIG_CACHE_BUCKET_SLOTS    = 4;
+
+struct CSignatureCacheStats {
+    uint64_t capacity    = 0;  // entries
+    uint64_t count       = 0;
+    uint64_t memory      = 0;  // bytes, allocated up front
+    uint64_t lookups     = 0;
+    uint64_t hits        = 0;
+    uint64_t inserts     = 0;
+    uint64_t evictions   = 0;
+    uint64_t contentions = 0;  // inserts which had to wait for the shard lock
+};
+
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * The memory is allocated once by Setup(). An entry is a pair of 64-bit SipHash
+ * values of (signature hash || public key || signature), salted with a random key
+ * so that peers can not aim at chosen slots. The first value picks the bucket,
+ * the second one the shard.
+ *
+ * Lookups take no lock, the slots are read with atomic loads. Inserts lock their
+ * shard only, and a full bucket evicts the slot written in the oldest generation;
+ * the generation of a shard advances every 1/8 of its capacity of inserts.
  */
 class CSignatureCache {
-public:
-    //! Entries are SHA256(signature hash || public key || signature):
-    UnorderedHashSet setValid;
-    std::mutex mtx;
+private:
+    struct Slot {
+        std::atomic<uint64_t> tag{0};  // 0 = empty
+        std::atomic<uint64_t> check{0};
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::unique_ptr<Slot[]> slots;
+        std::unique_ptr<uint8_t[]> generations;  // generation each slot was written in, guarded by mtx
+        uint8_t generation          = 0;
+        uint32_t nGenerationInserts = 0;
+
+        std::atomic<uint64_t> nCount{0};
+        std::atomic<uint64_t> nLookups{0};
+        std::atomic<uint64_t> nHits{0};
+        std::atomic<uint64_t> nInserts{0};
+        std::atomic<uint64_t> nEvictions{0};
+        std::atomic<uint64_t> nContentions{0};
+    };
 
 public:
     CSignatureCache() {}
     ~CSignatureCache() {}
+
+    // Allocate at most nMaxBytes for the entries, 0 disables the cache. Not thread safe, call it at startup.
+    void Setup(size_t nMaxBytes);
+
     bool Get(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
              const CPubKey& pubKey);
     void Set(const uint256& sigHash, const std::vector<unsigned char>& vchSig,
              const CPubKey& pubKey);
 
+    CSignatureCacheStats GetStats() const;
+
+private:
+    void ComputeEntry(uint64_t& tag, uint64_t& check, const uint256& sigHash,
+                      const std::vector<unsigned char>& vchSig, const CPubKey& pubKey) const;
+
 private:
-    void ComputeEntry(uint256& entry, const uint256& sigHash,
-                      const std::vector<unsigned char>& vchSig, const CPubKey& pubKey);
+    Shard shards[SIG_CACHE_SHARDS];
+    uint64_t nBuckets        = 0;  // per shard, a power of two
+    uint32_t nGenerationSize = 0;
+    uint64_t k0 = 0, k1 = 0, k2 = 0, k3 = 0;
 };
 
-#endif  // COIN_SIGCACHE_H
\ No newline at end of file
+#endif  // COIN_SIGCACHE_H
@@ -0,0 +1,111 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sigverify.h"
+
+#include "main.h"
+
+#include <algorithm>
+#include <thread>
+
+CSigVerifyPool sigVerifyPool;
+
+void StartSigVerifyPool(boost::thread_group &threadGroup) {
+    int32_t numThreads = SysCfg().GetArg("-sigverifythreads", DEFAULT_SIG_VERIFY_THREADS);
+    if (numThreads < 0)
+        numThreads = (int32_t)std::thread::hardware_concurrency() - 1;
+
+    numThreads = std::max(std::min(numThreads, MAX_SIG_VERIFY_THREADS), 0);
+    sigVerifyPool.Start(threadGroup, numThreads);
+}
+
+void CSigVerifyPool::Start(boost::thread_group &threadGroup, int32_t numThreads) {
+    nWorkers = numThreads;
+    for (int32_t i = 0; i < nWorkers; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()>>, "sigverify",
+                                              boost::function<void()>(boost::bind(&CSigVerifyPool::ThreadVerify, this))));
+
+    LogPrint(BCLog::INFO, "signature verification pool started with %d threads\n", nWorkers);
+}
+
+bool CSigVerifyPool::Verify(const std::vector<CSigCheck> &checks) {
+    auto spJob = std::make_shared<Job>(checks, true);
+    Execute(spJob);
+    return !spJob->failed;
+}
+
+void CSigVerifyPool::VerifyEach(const std::vector<CSigCheck> &checks, std::vector<bool> &results) {
+    auto spJob = std::make_shared<Job>(checks, false);
+    Execute(spJob);
+    results.assign(spJob->valid.begin(), spJob->valid.end());
+}
+
+void CSigVerifyPool::Execute(const std::shared_ptr<Job> &spJob) {
+    size_t count = spJob->nCount;
+    bool fShared = nWorkers > 0 && count > 1;
+    if (fShared) {
+        {
+            boost::unique_lock<boost::mutex> lock(mtx);
+            jobs.push_back(spJob);
+        }
+        condJobs.notify_all();
+    }
+
+    Run(*spJob);
+
+    if (fShared) {
+        boost::unique_lock<boost::mutex> lock(mtx);
+        auto it = std::find(jobs.begin(), jobs.end(), spJob);
+        if (it != jobs.end())
+            jobs.erase(it);
+
+        // The workers may still be verifying the last checks they took. The job points to the
+        // checks of the caller, which must outlive it: no interruption until the workers are done.
+        boost::this_thread::disable_interruption noInterrupt;
+        while (spJob->done < count)
+            condDone.wait(lock);
+    }
+}
+
+void CSigVerifyPool::Run(Job &job) {
+    // A worker may get here once the submitter has returned and its checks are gone: the
+    // checks are only read after a not yet taken index is claimed, the submitter then waits.
+    size_t count = job.nCount;
+    for (size_t i = job.next++; i < count; i = job.next++) {
+        if (!job.fStopOnFailure || !job.failed) {
+            const CSigCheck &check = (*job.pChecks)[i];
+            CPubKey recoveredKey;
+            if (check.pubKey.IsEmpty() ? ::RecoverSignature(check.sigHash, check.signature, recoveredKey)
+                                       : ::VerifySignature(check.sigHash, check.signature, check.pubKey))
+                job.valid[i] = true;
+            else
+                job.failed = true;
+        }
+
+        if (++job.done == count) {
+            boost::unique_lock<boost::mutex> lock(mtx);
+            condDone.notify_all();
+        }
+    }
+}
+
+void CSigVerifyPool::ThreadVerify() {
+    while (true) {
+        std::shared_ptr<Job> spJob;
+        {
+            boost::unique_lock<boost::mutex> lock(mtx);
+            while (jobs.empty())
+                condJobs.wait(lock);
+
+            spJob = jobs.front();
+            if (spJob->next >= spJob->nCount) {
+                // all its checks are taken, the submitter waits for the last ones
+                jobs.pop_front();
+                continue;
+            }
+        }
+
+        Run(*spJob);
+    }
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_SIGVERIFY_H
+#define COIN_SIGVERIFY_H
+
+#include "entities/key.h"
+#include "commons/uint256.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+/** -sigverifythreads default, -1 = one less than the number of cores */
+static const int32_t DEFAULT_SIG_VERIFY_THREADS = -1;
+/** Upper bound of the signature verification workers */
+static const int32_t MAX_SIG_VERIFY_THREADS     = 16;
+
+struct CSigCheck {
+    uint256 sigHash;
+    std::vector<uint8_t> signature;
+    CPubKey pubKey;  // empty: the signer of the compact signature is recovered
+
+    CSigCheck() {}
+    CSigCheck(const uint256 &sigHashIn, const std::vector<uint8_t> &signatureIn, const CPubKey &pubKeyIn)
+        : sigHash(sigHashIn), signature(signatureIn), pubKey(pubKeyIn) {}
+    CSigCheck(const uint256 &sigHashIn, const std::vector<uint8_t> &signatureIn)
+        : sigHash(sigHashIn), signature(signatureIn) {}
+};
+
+/**
+ * Fixed pool of signature verification threads, shared by block connection, tx admission
+ * and multi-signature checks.
+ *
+ * The checks of a batch are taken one by one by the idle workers and by the submitting
+ * thread, which works on its own batch too; a batch therefore completes even when there
+ * are no workers or they are all busy. Every check goes through ::VerifySignature(), so
+ * the signature cache is consulted first and valid signatures are added to it; a check
+ * without a pubkey goes through ::RecoverSignature(), which caches the recovered signer.
+ */
+class CSigVerifyPool {
+private:
+    struct Job {
+        const std::vector<CSigCheck> *pChecks;  // of the submitter, only valid while a check is left
+        size_t nCount;                          // pChecks->size(), read without touching the checks
+        bool fStopOnFailure;
+        std::vector<uint8_t> valid;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::atomic<bool> failed{false};
+
+        Job(const std::vector<CSigCheck> &checks, bool fStopOnFailureIn)
+            : pChecks(&checks), nCount(checks.size()), fStopOnFailure(fStopOnFailureIn), valid(nCount, false) {}
+    };
+
+public:
+    // Start numThreads workers, 0 verifies every batch on the submitting thread
+    void Start(boost::thread_group &threadGroup, int32_t numThreads);
+    int32_t GetThreads() const { return nWorkers; }
+
+    // All or nothing, returns true if every signature is valid. Stops at the first invalid one.
+    bool Verify(const std::vector<CSigCheck> &checks);
+    // Checks every signature, results[i] tells whether checks[i] is valid
+    void VerifyEach(const std::vector<CSigCheck> &checks, std::vector<bool> &results);
+
+    void ThreadVerify();
+
+private:
+    void Execute(const std::shared_ptr<Job> &spJob);
+    void Run(Job &job);
+
+private:
+    int32_t nWorkers = 0;
+
+    boost::mutex mtx;
+    boost::condition_variable condJobs;
+    boost::condition_variable condDone;
+    std::deque<std::shared_ptr<Job>> jobs;
+};
+
+extern CSigVerifyPool sigVerifyPool;
+
+void StartSigVerifyPool(boost::thread_group &threadGroup);
+
+#endif  // COIN_SIGVERIFY_H
@@ -0,0 +1,199 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "miner/miner.h"
+#include "tests/mempoolsetup.h"
+#include "tx/blockrewardtx.h"
+
+using namespace std;
+
+// A chain of block indexes long enough for the fuel rate, under the mempool on an in-memory db
+struct BlockTemplateSetup : public MemPoolSetup {
+    vector<uint256> hashes;
+    vector<CBlockIndex> indexes;
+
+    BlockTemplateSetup() {
+        uint32_t count = DEFAULT_BURN_BLOCK_SIZE + 2;
+        int32_t height = SysCfg().GetVer2ForkHeight() + 100;
+        hashes.resize(count);
+        indexes.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            hashes[i]               = GetRandHash();
+            indexes[i].pBlockHash   = &hashes[i];
+            indexes[i].pprev        = i > 0 ? &indexes[i - 1] : nullptr;
+            indexes[i].height       = height - count + 1 + i;
+            indexes[i].nTime        = 1600000000 + i * 3;
+            indexes[i].nFuelRate    = INIT_FUEL_RATE;
+            indexes[i].nFuelFee     = 0;
+        }
+    }
+
+    CBlockIndex *Tip() { return &indexes.back(); }
+
+    std::shared_ptr<CBaseTx> AddTransferTx(const CKey &key, const CKeyID &toKeyId, uint64_t coins) {
+        return MemPoolSetup::AddTransferTx(key, toKeyId, coins, Tip()->height + 1);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(blocktemplate_tests, BlockTemplateSetup)
+
+BOOST_AUTO_TEST_CASE(blocktemplate_match)
+{
+    LOCK2(cs_main, mempool.cs);
+    CBlockTemplate blockTemplate;
+    BOOST_CHECK(blockTemplate.IsNull());
+
+    CRegID minerRegid(100, 1);
+    int64_t slotTime = Tip()->GetBlockTime() + 3;
+    BOOST_CHECK(blockTemplate.Reset(Tip(), slotTime, slotTime, minerRegid));
+    BOOST_CHECK(!blockTemplate.IsNull());
+    BOOST_CHECK_EQUAL(blockTemplate.height, Tip()->height + 1);
+    BOOST_CHECK(blockTemplate.IsMatch(Tip(), slotTime, minerRegid));
+
+    // another slot, miner or tip needs another template
+    BOOST_CHECK(!blockTemplate.IsMatch(Tip(), slotTime + 3, minerRegid));
+    BOOST_CHECK(!blockTemplate.IsMatch(Tip(), slotTime, CRegID(100, 2)));
+    BOOST_CHECK(!blockTemplate.IsMatch(Tip()->pprev, slotTime, minerRegid));
+
+    // resetting to the regid of the template itself keeps it
+    BOOST_CHECK(blockTemplate.Reset(Tip(), slotTime + 3, slotTime + 3, blockTemplate.minerRegid));
+    BOOST_CHECK(blockTemplate.IsMatch(Tip(), slotTime + 3, minerRegid));
+
+    blockTemplate.SetNull();
+    BOOST_CHECK(blockTemplate.IsNull());
+    BOOST_CHECK(!blockTemplate.IsMatch(Tip(), slotTime + 3, minerRegid));
+}
+
+BOOST_AUTO_TEST_CASE(blocktemplate_slot)
+{
+    CBlockTemplate blockTemplate;
+    int64_t slotTime = Tip()->GetBlockTime() + 3;
+    BOOST_CHECK(blockTemplate.SetSlot(Tip(), slotTime));
+    BOOST_CHECK(!blockTemplate.SetSlot(Tip(), slotTime));
+    BOOST_CHECK_EQUAL(blockTemplate.slotHeight, Tip()->height + 1);
+
+    // the duty of the slot is kept across the resets of the template
+    blockTemplate.fSlotChecked = true;
+    blockTemplate.SetNull();
+    BOOST_CHECK(blockTemplate.fSlotChecked);
+
+    // a new slot has to be looked up again
+    BOOST_CHECK(blockTemplate.SetSlot(Tip(), slotTime + 3));
+    BOOST_CHECK(!blockTemplate.fSlotChecked);
+}
+
+BOOST_AUTO_TEST_CASE(blocktemplate_mining_time)
+{
+    LOCK2(cs_main, mempool.cs);
+    CKey key = AddAccount(100 * COIN);
+    AddTransferTx(key, NewKeyId(), COIN);
+
+    CBlockTemplate blockTemplate;
+    CRegID minerRegid(100, 1);
+    int64_t slotTime = Tip()->GetBlockTime() + 3;
+    BOOST_CHECK(blockTemplate.Reset(Tip(), slotTime, slotTime, minerRegid));
+    uint32_t count = 0;
+    BOOST_CHECK(blockTemplate.PackMempoolTxs(0, 0, count));
+    BOOST_CHECK_EQUAL(count, 2U);
+
+    // the miner wakes up a second after the slot, the template of the slot takes its time
+    BOOST_CHECK(blockTemplate.IsMatch(Tip(), slotTime, minerRegid));
+    BOOST_CHECK(blockTemplate.SetBlockTime(slotTime + 1));
+    BOOST_CHECK_EQUAL(blockTemplate.blockTime, (uint32_t)(slotTime + 1));
+
+    // unless a packed tx was executed with the block time of the template
+    blockTemplate.fBlockTimeUsed = true;
+    BOOST_CHECK(blockTemplate.SetBlockTime(slotTime + 1));
+    BOOST_CHECK(!blockTemplate.SetBlockTime(slotTime + 2));
+    BOOST_CHECK_EQUAL(blockTemplate.blockTime, (uint32_t)(slotTime + 1));
+
+    // which a reset starts over
+    BOOST_CHECK(blockTemplate.Reset(Tip(), slotTime, slotTime + 2, minerRegid));
+    BOOST_CHECK(!blockTemplate.fBlockTimeUsed);
+}
+
+BOOST_AUTO_TEST_CASE(blocktemplate_pack)
+{
+    LOCK2(cs_main, mempool.cs);
+    CKey key = AddAccount(100 * COIN);
+    auto spTx1 = AddTransferTx(key, NewKeyId(), COIN);
+
+    CBlockTemplate blockTemplate;
+    CRegID minerRegid(100, 1);
+    BOOST_CHECK(blockTemplate.Reset(Tip(), Tip()->GetBlockTime() + 3, Tip()->GetBlockTime() + 3, minerRegid));
+
+    // the median tx and the mempool tx
+    uint32_t count = 0;
+    BOOST_CHECK(blockTemplate.PackMempoolTxs(0, 0, count));
+    BOOST_CHECK_EQUAL(count, 2U);
+    BOOST_CHECK(!blockTemplate.HasPendingTxs());
+
+    // nothing new to pack
+    BOOST_CHECK(blockTemplate.PackMempoolTxs(0, 0, count));
+    BOOST_CHECK_EQUAL(count, 0U);
+
+    // a tx arriving later is queued and packed, after the earlier tx of its sender
+    auto spTx2 = AddTransferTx(key, NewKeyId(), COIN);
+    BOOST_CHECK(blockTemplate.PackMempoolTxs(0, 0, count));
+    BOOST_CHECK_EQUAL(count, 1U);
+
+    CBlock block;
+    block.vptx.push_back(std::make_shared<CUCoinBlockRewardTx>());
+    blockTemplate.Finalize(block);
+    BOOST_REQUIRE_EQUAL(block.vptx.size(), 4U);
+    BOOST_CHECK(block.vptx[1]->IsPriceMedianTx());
+    BOOST_CHECK(block.vptx[2]->GetHash() == spTx1->GetHash());
+    BOOST_CHECK(block.vptx[3]->GetHash() == spTx2->GetHash());
+    BOOST_CHECK_EQUAL(block.GetHeight(), (uint32_t)Tip()->height + 1);
+    BOOST_CHECK(block.GetPrevBlockHash() == Tip()->GetBlockHash());
+    BOOST_CHECK_EQUAL(block.GetFuelRate(), blockTemplate.fuelRate);
+}
+
+BOOST_AUTO_TEST_CASE(blocktemplate_failed_tx)
+{
+    LOCK2(cs_main, mempool.cs);
+    CKey key = AddAccount(COIN);
+    auto spTx = AddTransferTx(key, NewKeyId(), 10 * COIN);
+
+    CBlockTemplate blockTemplate;
+    BOOST_CHECK(blockTemplate.Reset(Tip(), Tip()->GetBlockTime() + 3, Tip()->GetBlockTime() + 3, CRegID(100, 1)));
+
+    uint32_t count = 0;
+    BOOST_CHECK(blockTemplate.PackMempoolTxs(0, 0, count));
+    BOOST_CHECK_EQUAL(count, 1U);
+    BOOST_CHECK(blockTemplate.failedTxids.count(spTx->GetHash()));
+
+    // a failed tx is not executed again on every update
+    BOOST_CHECK(blockTemplate.PackMempoolTxs(0, 0, count));
+    BOOST_CHECK_EQUAL(count, 0U);
+    BOOST_CHECK(!blockTemplate.HasPendingTxs());
+    BOOST_CHECK(!blockTemplate.txids.count(spTx->GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(blocktemplate_deadline)
+{
+    LOCK2(cs_main, mempool.cs);
+    CKey key = AddAccount(100 * COIN);
+    auto spTx1 = AddTransferTx(key, NewKeyId(), COIN);
+    auto spTx2 = AddTransferTx(key, NewKeyId(), COIN);
+
+    CBlockTemplate blockTemplate;
+    BOOST_CHECK(blockTemplate.Reset(Tip(), Tip()->GetBlockTime() + 3, Tip()->GetBlockTime() + 3, CRegID(100, 1)));
+
+    // the deadline has passed, the txs stay queued for the next step
+    uint32_t count = 0;
+    BOOST_CHECK(blockTemplate.PackMempoolTxs(0, GetTimeMillis() - 1, count));
+    BOOST_CHECK_EQUAL(count, 0U);
+    BOOST_CHECK(blockTemplate.HasPendingTxs());
+
+    // a tx gone from the mempool meanwhile is skipped
+    mempool.Remove(spTx2->GetHash());
+    BOOST_CHECK(blockTemplate.PackMempoolTxs(0, 0, count));
+    BOOST_CHECK_EQUAL(count, 2U);
+    BOOST_CHECK(!blockTemplate.HasPendingTxs());
+    BOOST_CHECK(blockTemplate.txids.count(spTx1->GetHash()));
+    BOOST_CHECK(!blockTemplate.txids.count(spTx2->GetHash()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,189 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "p2p/compactblock.h"
+#include "main.h"
+#include "p2p/chainmessage.h"
+#include "p2p/node.h"
+#include "tx/blockrewardtx.h"
+#include "tx/cointransfertx.h"
+#include "tx/txserializer.h"
+#include "commons/random.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static std::shared_ptr<CBaseTx> MakeTransferTx(uint32_t n) {
+    return std::make_shared<CBaseCoinTransferTx>(CRegID(1000000 + n / 8, n % 8), CRegID(100, 1), 1000 + n % 100,
+                                                  GetRand(1000000) + 1, 10000, "");
+}
+
+static CBlock MakeBlock(const vector<std::shared_ptr<CBaseTx> > &txs) {
+    CBlock block;
+    block.SetHeight(1000);
+    block.SetTime(GetTime());
+    block.SetPrevBlockHash(GetRandHash());
+    block.vptx.push_back(std::make_shared<CBlockRewardTx>(CRegID(100, 1).GetRegIdRaw(), 0, 1000));
+    block.vptx.insert(block.vptx.end(), txs.begin(), txs.end());
+    block.SetMerkleRootHash(block.BuildMerkleTree());
+    return block;
+}
+
+// The compact block as the receiver gets it
+static CCompactBlock RelayCompactBlock(const CBlock &block) {
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CCompactBlock(block, GetRand(std::numeric_limits<uint64_t>::max()));
+    CCompactBlock cmpctblock;
+    ss >> cmpctblock;
+    return cmpctblock;
+}
+
+static vector<std::shared_ptr<CBaseTx> > GetTxs(const CBlock &block, const vector<uint32_t> &indexes) {
+    vector<std::shared_ptr<CBaseTx> > txs;
+    for (auto index : indexes)
+        txs.push_back(block.vptx[index]);
+    return txs;
+}
+
+// The commands of the messages queued to a node without a socket
+static vector<string> PopSentCommands(CNode &node) {
+    vector<string> commands;
+    LOCK(node.cs_vSend);
+    while (!node.vSendMsg.empty()) {
+        const CSerializeData &data = *node.vSendMsg.Front();
+        CDataStream ss(data.begin(), data.end(), SER_NETWORK, PROTOCOL_VERSION);
+        CMessageHeader header;
+        ss >> header;
+        commands.push_back(header.GetCommand());
+        node.vSendMsg.PopFront();
+    }
+    node.nSendSize = 0;
+    return commands;
+}
+
+static int32_t GetMisbehavior(const CNode &node) {
+    CNodeStateStats stats;
+    GetNodeStateStats(node.GetId(), stats);
+    return stats.nMisbehavior;
+}
+
+BOOST_AUTO_TEST_SUITE(compactblock_tests)
+
+BOOST_AUTO_TEST_CASE(compactblock_rebuild)
+{
+    vector<std::shared_ptr<CBaseTx> > txs;
+    for (uint32_t i = 0; i < 100; i++)
+        txs.push_back(MakeTransferTx(i));
+    CBlock block = MakeBlock(txs);
+
+    CCompactBlock cmpctblock = RelayCompactBlock(block);
+    BOOST_CHECK_EQUAL(cmpctblock.prefilledTxs.size(), 1U);
+    BOOST_CHECK_EQUAL(cmpctblock.prefilledTxs[0].index, 0U);
+    BOOST_CHECK_EQUAL(cmpctblock.shortTxIds.size(), 100U);
+
+    CPartialBlock partialBlock;
+    BOOST_CHECK(partialBlock.InitData(cmpctblock) == CPartialBlock::READ_OK);
+    for (const auto &pBaseTx : txs)
+        partialBlock.AddAvailableTx(pBaseTx->GetHash(), pBaseTx);
+    // offered twice, still one claim
+    partialBlock.AddAvailableTx(txs[0]->GetHash(), txs[0]);
+
+    vector<uint32_t> missing;
+    partialBlock.GetMissingIndexes(missing);
+    BOOST_CHECK(missing.empty());
+    BOOST_CHECK_EQUAL(partialBlock.nAvailableTxs, 100U);
+
+    CBlock rebuilt;
+    BOOST_CHECK(partialBlock.FillBlock(rebuilt, {}) == CPartialBlock::READ_OK);
+    BOOST_CHECK(rebuilt.GetHash() == block.GetHash());
+    BOOST_CHECK_EQUAL(rebuilt.vptx.size(), block.vptx.size());
+}
+
+BOOST_AUTO_TEST_CASE(compactblock_bad_data)
+{
+    vector<std::shared_ptr<CBaseTx> > txs;
+    for (uint32_t i = 0; i < 10; i++)
+        txs.push_back(MakeTransferTx(i));
+    CBlock block = MakeBlock(txs);
+
+    CCompactBlock cmpctblock = RelayCompactBlock(block);
+    CPartialBlock partialBlock;
+    BOOST_CHECK(partialBlock.InitData(cmpctblock) == CPartialBlock::READ_OK);
+
+    vector<uint32_t> missing;
+    partialBlock.GetMissingIndexes(missing);
+    BOOST_CHECK_EQUAL(missing.size(), 10U);
+
+    // too few, too many, or the wrong txs
+    CBlock rebuilt;
+    vector<std::shared_ptr<CBaseTx> > missingTxs = GetTxs(block, missing);
+    BOOST_CHECK(partialBlock.FillBlock(rebuilt, vector<std::shared_ptr<CBaseTx> >(missingTxs.begin() + 1,
+                                                                                  missingTxs.end())) ==
+                CPartialBlock::READ_INVALID);
+    missingTxs.push_back(MakeTransferTx(10));
+    BOOST_CHECK(partialBlock.FillBlock(rebuilt, missingTxs) == CPartialBlock::READ_INVALID);
+    missingTxs.pop_back();
+    missingTxs[3] = MakeTransferTx(11);
+    BOOST_CHECK(partialBlock.FillBlock(rebuilt, missingTxs) == CPartialBlock::READ_FAILED);
+
+    // prefilled index out of the block, and twice the same short id
+    CCompactBlock badIndex = cmpctblock;
+    badIndex.prefilledTxs[0].index = badIndex.GetTxCount();
+    BOOST_CHECK(CPartialBlock().InitData(badIndex) == CPartialBlock::READ_INVALID);
+    CCompactBlock dupShortId = cmpctblock;
+    dupShortId.shortTxIds[1] = dupShortId.shortTxIds[0];
+    BOOST_CHECK(CPartialBlock().InitData(dupShortId) == CPartialBlock::READ_FAILED);
+
+    // more txs than a block holds
+    CCompactBlock tooLarge = cmpctblock;
+    for (uint64_t i = tooLarge.GetTxCount(); i <= MAX_CMPCTBLOCK_TXS; i++)
+        tooLarge.shortTxIds.push_back(i);
+    BOOST_CHECK(CPartialBlock().InitData(tooLarge) == CPartialBlock::READ_INVALID);
+    tooLarge.shortTxIds.pop_back();
+    BOOST_CHECK(CPartialBlock().InitData(tooLarge) == CPartialBlock::READ_OK);
+}
+
+// A cmpctblock whose header does not check is dropped before the mempool is scanned and its txs asked for
+BOOST_AUTO_TEST_CASE(compactblock_bad_header)
+{
+    RegisterNodeSignals(GetNodeSignals());
+    struct in_addr ip;
+    ip.s_addr = 0x0100000a;
+    std::unique_ptr<CNode> spNode(new CNode(INVALID_SOCKET, CAddress(CService(CNetAddr(ip), 8920)), "", true));
+    CNode &node   = *spNode;
+    node.nVersion = PROTOCOL_VERSION;
+
+    vector<std::shared_ptr<CBaseTx> > txs;
+    for (uint32_t i = 0; i < 10; i++)
+        txs.push_back(MakeTransferTx(i));
+    auto ProcessCompactBlock = [&node](const CCompactBlock &cmpctblock) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << cmpctblock;
+        ProcessCompactBlockMessage(&node, ss);
+        return PopSentCommands(node);
+    };
+
+    // from the future, not misbehaving on its own
+    CBlock block = MakeBlock(txs);
+    block.SetTime(GetTime() + 3600);
+    BOOST_CHECK(ProcessCompactBlock(CCompactBlock(block, 1)).empty());
+    BOOST_CHECK_EQUAL(GetMisbehavior(node), 0);
+
+    block = MakeBlock(txs);
+    block.SetVersion(CBlockHeader::CURRENT_VERSION + 1);
+    BOOST_CHECK(ProcessCompactBlock(CCompactBlock(block, 1)).empty());
+    BOOST_CHECK_EQUAL(GetMisbehavior(node), 100);
+
+    // the reward tx names the producer whose signature is checked, it must be prefilled first
+    CCompactBlock noReward(MakeBlock(txs), 1);
+    noReward.prefilledTxs.clear();
+    noReward.shortTxIds.push_back(1);
+    BOOST_CHECK(ProcessCompactBlock(noReward).empty());
+    BOOST_CHECK_EQUAL(GetMisbehavior(node), 200);
+
+    spNode.reset();
+    UnregisterNodeSignals(GetNodeSignals());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,73 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TESTS_MEMPOOLSETUP_H
+#define TESTS_MEMPOOLSETUP_H
+
+#include "main.h"
+#include "tx/cointransfertx.h"
+#include "tx/txmempool.h"
+#include <boost/test/unit_test.hpp>
+
+// The mempool on top of an in-memory db, the txs are added as executed already
+struct MemPoolSetup {
+    CCacheDBManager *pSavedCdMan;
+    std::unique_ptr<ECCVerifyHandle> handle;
+
+    MemPoolSetup() {
+        ECC_Start();
+        handle = std::make_unique<ECCVerifyHandle>();
+
+        pSavedCdMan = pCdMan;
+        pCdMan      = new CCacheDBManager(false, true);
+
+        LOCK(mempool.cs);
+        mempool.Clear();
+        mempool.cw = std::make_shared<CCacheWrapper>(pCdMan);
+    }
+
+    ~MemPoolSetup() {
+        {
+            LOCK(mempool.cs);
+            mempool.Clear();
+            mempool.cw.reset();
+        }
+        delete pCdMan;
+        pCdMan = pSavedCdMan;
+
+        handle.reset();
+        ECC_Stop();
+    }
+
+    static CKey NewKey() {
+        CKey key;
+        key.MakeNewKey();
+        return key;
+    }
+
+    static CKeyID NewKeyId() { return NewKey().GetPubKey().GetKeyId(); }
+
+    // A key with an account holding the coins in the db
+    static CKey AddAccount(uint64_t coins) {
+        CKey key = NewKey();
+        CAccount account(key.GetPubKey().GetKeyId(), key.GetPubKey());
+        ReceiptList receipts;
+        BOOST_CHECK(account.OperateBalance(SYMB::WICC, BalanceOpType::ADD_FREE, coins, ReceiptType::TRANSFER_ACTUAL_COINS,
+                                           receipts));
+        BOOST_CHECK(pCdMan->pAccountCache->SaveAccount(account));
+        return key;
+    }
+
+    static std::shared_ptr<CBaseTx> AddTransferTx(const CKey &key, const CKeyID &toKeyId, uint64_t coins,
+                                                  int32_t height) {
+        auto spTx = std::make_shared<CBaseCoinTransferTx>(CUserID(key.GetPubKey()), CUserID(toKeyId), height, coins,
+                                                          COIN / 10, "");
+        BOOST_CHECK(key.Sign(spTx->GetHash(), spTx->signature));
+
+        mempool.AddEntry(spTx->GetHash(), CTxMemPoolEntry(spTx, GetTime(), height));
+        return spTx;
+    }
+};
+
+#endif  // TESTS_MEMPOOLSETUP_H
@@ -0,0 +1,36 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "persistence/block.h"
+#include "crypto/sha256.h"
+#include "commons/random.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static vector<uint256> RandomLeaves(size_t count) {
+    vector<uint256> leaves;
+    leaves.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        leaves.push_back(GetRandHash());
+    return leaves;
+}
+
+BOOST_AUTO_TEST_SUITE(merkle_tests)
+
+BOOST_AUTO_TEST_CASE(merkle_batched_matches_pairwise)
+{
+    SHA256AutoDetect();
+
+    for (size_t count = 0; count < 300; count++) {
+        vector<uint256> leaves   = RandomLeaves(count);
+        vector<uint256> batched  = leaves;
+        vector<uint256> pairwise = leaves;
+
+        BOOST_CHECK(ComputeMerkleTree(batched) == ComputeMerkleTreePairwise(pairwise));
+        BOOST_CHECK(batched == pairwise);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
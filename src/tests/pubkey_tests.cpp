@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "entities/key.h"
+#include "commons/random.h"
 #include <boost/test/unit_test.hpp>
 
 using namespace std;
@@ -39,4 +40,30 @@ BOOST_AUTO_TEST_CASE(pub_key_verify_test)
     ECC_Stop();
 }
 
+BOOST_AUTO_TEST_CASE(pub_key_cache_test)
+{
+    ECC_Start();
+    std::unique_ptr<ECCVerifyHandle> handle = std::make_unique<ECCVerifyHandle>();
+
+    CKey key;
+    key.MakeNewKey();
+    CPubKey pubKey = key.GetPubKey();
+    uint256 hash1  = GetRandHash();
+    uint256 hash2  = GetRandHash();
+    vector<unsigned char> signature;
+    BOOST_CHECK(key.Sign(hash1, signature));
+
+    CPubKeyCacheStats before = ECC_GetPubKeyCacheStats();
+    BOOST_CHECK(pubKey.Verify(hash1, signature));
+    BOOST_CHECK(pubKey.Verify(hash1, signature));
+    CPubKeyCacheStats after = ECC_GetPubKeyCacheStats();
+    BOOST_CHECK(after.hits > before.hits);
+
+    // a cached key must not make a wrong signature pass
+    BOOST_CHECK(!pubKey.Verify(hash2, signature));
+
+    handle.reset();
+    ECC_Stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,137 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "commons/random.h"
+#include "main.h"
+#include "p2p/protocol.h"
+#include "persistence/block.h"
+#include "persistence/disk.h"
+#include "tx/cointransfertx.h"
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+// The block files in a temporary data dir
+struct RawBlockSetup {
+    boost::filesystem::path dataDir;
+
+    RawBlockSetup() {
+        dataDir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        boost::filesystem::create_directories(dataDir);
+        SysCfg().SoftSetArgCover("-datadir", dataDir.string());
+        ClearDatadirCache();
+    }
+
+    ~RawBlockSetup() {
+        CBaseParams::EraseArg("-datadir");
+        ClearDatadirCache();
+        boost::filesystem::remove_all(dataDir);
+    }
+
+    static CBlock NewBlock(uint32_t txCount) {
+        CBlock block;
+        block.SetHeight(100);
+        block.SetPrevBlockHash(GetRandHash());
+        for (uint32_t n = 0; n < txCount; n++)
+            block.vptx.push_back(std::make_shared<CBaseCoinTransferTx>(CRegID(1000 + n, 1), CRegID(100, 1), 90,
+                                                                       GetRand(1000000) + 1, 10000, ""));
+        block.SetMerkleRootHash(block.BuildMerkleTree());
+        return block;
+    }
+
+    // Overwrite the bytes of the block file at nPos
+    static void Corrupt(uint32_t nPos, const void *pData, size_t size) {
+        FILE *file = OpenBlockFile(CDiskBlockPos(0, nPos));
+        BOOST_REQUIRE(file != nullptr);
+        BOOST_CHECK_EQUAL(fwrite(pData, 1, size, file), size);
+        fclose(file);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(rawblock_tests, RawBlockSetup)
+
+BOOST_AUTO_TEST_CASE(rawblock_round_trip)
+{
+    CBlock block1 = NewBlock(10);
+    CBlock block2 = NewBlock(20);
+    CDiskBlockPos pos1(0, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(block1, pos1));
+    CDiskBlockPos pos2(0, pos1.nPos + ::GetSerializeSize(block1, SER_DISK, CLIENT_VERSION));
+    BOOST_REQUIRE(WriteBlockToDisk(block2, pos2));
+
+    // the bytes are appended after what the data holds already, as the block message payload
+    CSerializeData prefix(CMessageHeader::HEADER_SIZE, 'x');
+    for (const auto &item : {make_pair(&block2, pos2), make_pair(&block1, pos1)}) {
+        CBlock block;
+        BOOST_REQUIRE(ReadBlockFromDisk(item.second, block));
+        BOOST_CHECK(block.GetHash() == item.first->GetHash());
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << block;
+
+        CSerializeData data = prefix;
+        BOOST_REQUIRE(ReadRawBlockFromDisk(item.second, item.first->GetHash(), data));
+        BOOST_REQUIRE_EQUAL(data.size(), prefix.size() + ss.size());
+        BOOST_CHECK(std::equal(prefix.begin(), prefix.end(), data.begin()));
+        BOOST_CHECK(std::equal(ss.begin(), ss.end(), data.begin() + prefix.size()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rawblock_bad_position)
+{
+    CBlock block = NewBlock(1);
+    CDiskBlockPos pos(0, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(block, pos));
+
+    // no room for the message start and the size in front of the block
+    CSerializeData data;
+    BOOST_CHECK(!ReadRawBlockFromDisk(CDiskBlockPos(0, MESSAGE_START_SIZE), block.GetHash(), data));
+    // past the end of the file
+    BOOST_CHECK(!ReadRawBlockFromDisk(CDiskBlockPos(0, pos.nPos + 1000000), block.GetHash(), data));
+    // in another file
+    BOOST_CHECK(!ReadRawBlockFromDisk(CDiskBlockPos(1, pos.nPos), block.GetHash(), data));
+    BOOST_CHECK(data.empty());
+}
+
+BOOST_AUTO_TEST_CASE(rawblock_message_start_mismatch)
+{
+    CBlock block = NewBlock(1);
+    CDiskBlockPos pos(0, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(block, pos));
+
+    CSerializeData data;
+    BOOST_CHECK(ReadRawBlockFromDisk(pos, block.GetHash(), data));
+
+    uint8_t byte = SysCfg().MessageStart()[0] ^ 0xff;
+    Corrupt(pos.nPos - MESSAGE_START_SIZE - sizeof(uint32_t), &byte, 1);
+    data.clear();
+    BOOST_CHECK(!ReadRawBlockFromDisk(pos, block.GetHash(), data));
+}
+
+BOOST_AUTO_TEST_CASE(rawblock_size_and_hash_mismatch)
+{
+    CBlock block1 = NewBlock(1);
+    CBlock block2 = NewBlock(1);
+    CDiskBlockPos pos1(0, 0);
+    BOOST_REQUIRE(WriteBlockToDisk(block1, pos1));
+    CDiskBlockPos pos2(0, pos1.nPos + ::GetSerializeSize(block1, SER_DISK, CLIENT_VERSION));
+    BOOST_REQUIRE(WriteBlockToDisk(block2, pos2));
+
+    // the block at the position is not the one asked for
+    CSerializeData data;
+    BOOST_CHECK(!ReadRawBlockFromDisk(pos1, block2.GetHash(), data));
+    BOOST_CHECK(!ReadRawBlockFromDisk(pos2, block1.GetHash(), data));
+
+    // a size larger than a block
+    uint32_t nSize = MAX_BLOCK_SIZE + 1;
+    Corrupt(pos1.nPos - sizeof(uint32_t), &nSize, sizeof(nSize));
+    BOOST_CHECK(!ReadRawBlockFromDisk(pos1, block1.GetHash(), data));
+
+    // a size past the end of the file
+    nSize = ::GetSerializeSize(block2, SER_DISK, CLIENT_VERSION) + 1;
+    Corrupt(pos2.nPos - sizeof(uint32_t), &nSize, sizeof(nSize));
+    BOOST_CHECK(!ReadRawBlockFromDisk(pos2, block2.GetHash(), data));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "p2p/node.h"
+#include "p2p/relaycache.h"
+#include "commons/random.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+// A tx message of nSize bytes of payload
+static CSharedNetMessage MakeTxMessage(size_t nSize) {
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    for (size_t i = 0; i < nSize; i++)
+        ss << (char)GetRand(256);
+    return MakeSharedNetMessage(NetMsgType::TX, ss);
+}
+
+BOOST_AUTO_TEST_SUITE(relaycache_tests)
+
+BOOST_AUTO_TEST_CASE(relaycache_get)
+{
+    CRelayCache cache;
+    CSharedNetMessage spMessage = MakeTxMessage(300);
+    uint256 txid                = GetRandHash();
+    cache.Add(txid, spMessage);
+
+    // the message framed on relay is served as is, to every peer asking
+    BOOST_CHECK(cache.Get(txid) == spMessage);
+    BOOST_CHECK(cache.Get(txid) == spMessage);
+
+    BOOST_CHECK(!cache.Get(GetRandHash()));
+    CRelayCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 1U);
+    BOOST_CHECK_EQUAL(stats.nBytes, spMessage->size() + RELAY_CACHE_ENTRY_OVERHEAD);
+    BOOST_CHECK_EQUAL(stats.nHits, 2U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(relaycache_budget)
+{
+    const size_t nEntrySize = CMessageHeader::HEADER_SIZE + 1000 + RELAY_CACHE_ENTRY_OVERHEAD;
+    CRelayCache cache(nEntrySize * 10);
+    vector<uint256> txids;
+    for (int32_t i = 0; i < 15; i++) {
+        txids.push_back(GetRandHash());
+        cache.Add(txids.back(), MakeTxMessage(1000));
+    }
+
+    // the oldest go first
+    CRelayCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 10U);
+    BOOST_CHECK_EQUAL(stats.nBytes, nEntrySize * 10);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 5U);
+    BOOST_CHECK(!cache.Get(txids[4]));
+    BOOST_CHECK(cache.Get(txids[5]));
+
+    // a smaller budget drops what goes over it
+    cache.SetMaxBytes(nEntrySize * 4);
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 4U);
+    BOOST_CHECK(!cache.Get(txids[10]));
+    BOOST_CHECK(cache.Get(txids[11]));
+}
+
+BOOST_AUTO_TEST_CASE(relaycache_expiry)
+{
+    CRelayCache cache;
+    int64_t nTime = GetTime();
+    SetMockTime(nTime);
+    uint256 oldTxid = GetRandHash();
+    cache.Add(oldTxid, MakeTxMessage(200));
+
+    SetMockTime(nTime + RELAY_CACHE_EXPIRY / 2);
+    uint256 newTxid = GetRandHash();
+    cache.Add(newTxid, MakeTxMessage(200));
+
+    SetMockTime(nTime + RELAY_CACHE_EXPIRY + 1);
+    BOOST_CHECK(!cache.Get(oldTxid));
+    BOOST_CHECK(cache.Get(newTxid));
+
+    cache.Add(GetRandHash(), MakeTxMessage(200));
+    CRelayCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 2U);
+    BOOST_CHECK_EQUAL(stats.nExpirations, 1U);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 0U);
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,225 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "p2p/node.h"
+#include "p2p/sendqueue.h"
+#include <boost/test/unit_test.hpp>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+// A message of the command with a payload of about nSize bytes, its first byte tells it apart
+static CSharedNetMessage MakeMessage(const char *pszCommand, size_t nSize, uint8_t id) {
+    vector<uint8_t> payload(nSize, id);
+    return MakeSharedNetMessage(pszCommand, payload);
+}
+
+static SendClass PopClass(CSendQueue &queue) {
+    SendClass sendClass = queue.FrontClass();
+    queue.PopFront();
+    return sendClass;
+}
+
+BOOST_AUTO_TEST_SUITE(sendqueue_tests)
+
+BOOST_AUTO_TEST_CASE(sendqueue_classes)
+{
+    BOOST_CHECK_EQUAL(GetSendClass(*MakeMessage(NetMsgType::FINALITYBLOCK, 10, 0)), SEND_CONSENSUS);
+    BOOST_CHECK_EQUAL(GetSendClass(*MakeMessage(NetMsgType::VERSION, 10, 0)), SEND_CONSENSUS);
+    BOOST_CHECK_EQUAL(GetSendClass(*MakeMessage(NetMsgType::BLOCK, 10, 0)), SEND_BLOCK);
+    BOOST_CHECK_EQUAL(GetSendClass(*MakeMessage(NetMsgType::CMPCTBLOCK, 10, 0)), SEND_BLOCK);
+    BOOST_CHECK_EQUAL(GetSendClass(*MakeMessage(NetMsgType::TX, 10, 0)), SEND_TX);
+    BOOST_CHECK_EQUAL(GetSendClass(*MakeMessage(NetMsgType::INV, 10, 0)), SEND_TX);
+    BOOST_CHECK_EQUAL(GetSendClass(*MakeMessage("merkleblock", 10, 0)), SEND_TX);
+    BOOST_CHECK_EQUAL(GetSendClass(*MakeMessage(NetMsgType::ADDR, 10, 0)), SEND_ADDR);
+}
+
+BOOST_AUTO_TEST_CASE(sendqueue_consensus_first)
+{
+    CSendQueue queue;
+    for (uint8_t i = 0; i < 10; i++)
+        queue.Push(MakeMessage(NetMsgType::TX, 1000, i), SEND_TX);
+    queue.Push(MakeMessage(NetMsgType::BLOCK, 1000000, 0), SEND_BLOCK);
+
+    // a tx picked but not started yet goes after a consensus message queued since
+    const CSharedNetMessage spFront = queue.Front();
+    BOOST_CHECK_EQUAL(queue.FrontClass(), SEND_TX);
+    queue.Push(MakeMessage(NetMsgType::CONFIRMBLOCK, 100, 0), SEND_CONSENSUS);
+    BOOST_CHECK_EQUAL(PopClass(queue), SEND_CONSENSUS);
+    BOOST_CHECK(queue.Front() == spFront);
+
+    // a started tx is not preempted
+    queue.StartFront();
+    queue.Push(MakeMessage(NetMsgType::FINALITYBLOCK, 100, 0), SEND_CONSENSUS);
+    BOOST_CHECK(queue.Front() == spFront);
+    queue.PopFront();
+
+    BOOST_CHECK_EQUAL(PopClass(queue), SEND_CONSENSUS);
+    BOOST_CHECK_EQUAL(queue.size(), 10U);
+    BOOST_CHECK_EQUAL(queue.GetClassSize(SEND_CONSENSUS), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(sendqueue_upload_limiter)
+{
+    CUploadLimiter limiter;
+    BOOST_CHECK(!limiter.IsLimited());
+    BOOST_CHECK_EQUAL(limiter.GetAllowance(5000), 5000U);
+
+    // a second of upload to start with
+    limiter.SetRate(1000);
+    BOOST_CHECK(limiter.IsLimited());
+    BOOST_CHECK_EQUAL(limiter.GetAllowance(5000), 1000U);
+    BOOST_CHECK_EQUAL(limiter.GetAllowance(100), 100U);
+
+    // used up, and more: nothing until it refills
+    limiter.Consume(2000);
+    BOOST_CHECK_EQUAL(limiter.GetAllowance(5000), 0U);
+
+    limiter.SetRate(0);
+    BOOST_CHECK(!limiter.IsLimited());
+    BOOST_CHECK_EQUAL(limiter.GetAllowance(5000), 5000U);
+}
+
+BOOST_AUTO_TEST_CASE(sendqueue_capped_send)
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    std::unique_ptr<CNode> pNode(new CNode(fds[0], CAddress(), "", true));
+
+    // the upload cap is used up
+    uploadLimiter.SetRate(1000);
+    uploadLimiter.Consume(2000);
+
+    CSharedNetMessage spTx       = MakeMessage(NetMsgType::TX, 100, 1);
+    CSharedNetMessage spConfirm  = MakeMessage(NetMsgType::CONFIRMBLOCK, 100, 2);
+    CSharedNetMessage spFinality = MakeMessage(NetMsgType::FINALITYBLOCK, 100, 3);
+    vector<char> received(1000);
+    {
+        LOCK(pNode->cs_vSend);
+        pNode->PushSharedMessage(spTx, SEND_TX);
+        BOOST_CHECK(pNode->IsSendHeldBack());
+        BOOST_CHECK_EQUAL(pNode->nSendOffset, 0U);
+
+        // a consensus message queued after the held back tx goes out
+        pNode->PushSharedMessage(spConfirm, SEND_CONSENSUS);
+        BOOST_CHECK(!pNode->IsSendHeldBack());
+        pNode->SocketSendData();
+        BOOST_CHECK_EQUAL(pNode->vSendMsg.size(), 1U);
+        BOOST_CHECK(pNode->IsSendHeldBack());
+    }
+    BOOST_REQUIRE_EQUAL(recv(fds[1], received.data(), received.size(), 0), (ssize_t)spConfirm->size());
+    BOOST_CHECK(std::equal(spConfirm->begin(), spConfirm->end(), received.begin()));
+
+    // once some bytes of the tx went out, it is finished first
+    uploadLimiter.SetRate(1000);
+    {
+        LOCK(pNode->cs_vSend);
+        uploadLimiter.Consume(1000 - 10);
+        pNode->SocketSendData();
+        BOOST_CHECK(pNode->nSendOffset > 0 && pNode->nSendOffset < spTx->size());
+        uploadLimiter.Consume(2000);
+        pNode->PushSharedMessage(spFinality, SEND_CONSENSUS);
+        BOOST_CHECK(pNode->IsSendHeldBack());
+        BOOST_CHECK(pNode->vSendMsg.Front() == spTx);
+    }
+
+    uploadLimiter.SetRate(0);
+    {
+        LOCK(pNode->cs_vSend);
+        pNode->SocketSendData();
+        BOOST_CHECK(pNode->vSendMsg.empty());
+    }
+    close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(sendqueue_unread_peer)
+{
+    RegisterNodeSignals(GetNodeSignals());
+    SysCfg().SoftSetArgCover("-maxsendbuffer", "10");
+
+    // the peer never reads the pongs queued for it once the socket buffer is full
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    int nBufSize = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &nBufSize, sizeof(nBufSize));
+    std::unique_ptr<CNode> pNode(new CNode(fds[0], CAddress(), "", true));
+    pNode->nVersion = PROTOCOL_VERSION;
+
+    const uint32_t nPings = 5000;
+    LOCK(pNode->cs_vRecvMsg);
+    for (uint64_t nonce = 0; nonce < nPings; nonce++) {
+        CSharedNetMessage spPing = MakeSharedNetMessage(NetMsgType::PING, nonce);
+        bool fComplete           = false;
+        BOOST_REQUIRE(pNode->ReceiveMsgBytes(&(*spPing)[0], spPing->size(), fComplete));
+        BOOST_REQUIRE(fComplete);
+    }
+
+    // the pings stop being answered once the send buffer is full, whatever the class of the replies
+    for (uint32_t n = 0; n < nPings; n++)
+        GetNodeSignals().ProcessMessages(pNode.get());
+    size_t nPongSize = MakeSharedNetMessage(NetMsgType::PONG, (uint64_t)0)->size();
+    BOOST_CHECK(!pNode->fDisconnect);
+    BOOST_CHECK(pNode->IsSendBufferFull());
+    BOOST_CHECK(pNode->nSendSize < SendBufferSize() + nPongSize);
+    BOOST_CHECK_EQUAL(pNode->vSendMsg.GetClassSize(SEND_CONSENSUS), pNode->nSendSize);
+    BOOST_CHECK(!pNode->vRecvMsg.empty());
+
+    // once the peer read them, the next pings are answered
+    {
+        LOCK(pNode->cs_vSend);
+        while (!pNode->vSendMsg.empty())
+            pNode->vSendMsg.PopFront();
+        pNode->nSendSize   = 0;
+        pNode->nSendOffset = 0;
+    }
+    size_t nWaiting = pNode->vRecvMsg.size();
+    GetNodeSignals().ProcessMessages(pNode.get());
+    BOOST_CHECK_EQUAL(pNode->vRecvMsg.size(), nWaiting - 1);
+
+    close(fds[1]);
+    CBaseParams::EraseArg("-maxsendbuffer");
+}
+
+BOOST_AUTO_TEST_CASE(sendqueue_weights)
+{
+    CSendQueue queue;
+    const size_t nSize = 10000;
+    for (uint8_t i = 0; i < 200; i++) {
+        queue.Push(MakeMessage(NetMsgType::BLOCK, nSize, i), SEND_BLOCK);
+        queue.Push(MakeMessage(NetMsgType::TX, nSize, i), SEND_TX);
+        queue.Push(MakeMessage(NetMsgType::ADDR, nSize, i), SEND_ADDR);
+    }
+
+    // while all of them have messages queued the classes get 4:2:1 of the bytes, in order
+    size_t counts[SEND_CLASS_COUNT] = {};
+    uint8_t next[SEND_CLASS_COUNT]  = {};
+    for (int32_t n = 0; n < 280; n++) {
+        SendClass sendClass = queue.FrontClass();
+        BOOST_CHECK_EQUAL((uint8_t)(*queue.Front())[CMessageHeader::HEADER_SIZE + 3], next[sendClass]++);
+        queue.PopFront();
+        counts[sendClass]++;
+    }
+    BOOST_CHECK_EQUAL(counts[SEND_CONSENSUS], 0U);
+    BOOST_CHECK(counts[SEND_BLOCK] >= 155 && counts[SEND_BLOCK] <= 165);
+    BOOST_CHECK(counts[SEND_TX] >= 75 && counts[SEND_TX] <= 85);
+    BOOST_CHECK(counts[SEND_ADDR] >= 35 && counts[SEND_ADDR] <= 45);
+
+    // an idle class leaves its share to the others
+    while (queue.GetClassSize(SEND_BLOCK) > 0)
+        PopClass(queue);
+    size_t nTx = 0, nAddr = 0;
+    for (int32_t n = 0; n < 30; n++)
+        (PopClass(queue) == SEND_TX ? nTx : nAddr)++;
+    BOOST_CHECK(nTx >= 18 && nTx <= 22);
+    BOOST_CHECK_EQUAL(nTx + nAddr, 30U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
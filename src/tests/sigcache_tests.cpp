@@ -0,0 +1,161 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sigcache.h"
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+using namespace std;
+
+struct SigCacheEntry {
+    uint256 sigHash;
+    vector<unsigned char> signature;
+};
+
+static vector<SigCacheEntry> MakeEntries(size_t count) {
+    vector<SigCacheEntry> entries(count);
+    for (auto &entry : entries) {
+        entry.sigHash = GetRandHash();
+        uint256 rand  = GetRandHash();
+        entry.signature.assign(rand.begin(), rand.end());
+    }
+    return entries;
+}
+
+// The cache does not check the key, any compressed key bytes will do
+static CPubKey MakePubKey() {
+    uint256 rand = GetRandHash();
+    vector<uint8_t> vch(1, 0x02);
+    vch.insert(vch.end(), rand.begin(), rand.end());
+    return CPubKey(vch);
+}
+
+// Bytes for nBuckets buckets in each shard
+static size_t GetCacheBytes(size_t nBuckets) {
+    return nBuckets * SIG_CACHE_SHARDS * SIG_CACHE_BUCKET_SLOTS * (sizeof(uint64_t) * 2 + sizeof(uint8_t));
+}
+
+BOOST_AUTO_TEST_SUITE(sigcache_tests)
+
+BOOST_AUTO_TEST_CASE(sigcache_get_set)
+{
+    CSignatureCache cache;
+    cache.Setup(GetCacheBytes(64));
+    BOOST_CHECK_EQUAL(cache.GetStats().capacity, 64U * SIG_CACHE_SHARDS * SIG_CACHE_BUCKET_SLOTS);
+
+    CPubKey pubKey = MakePubKey();
+    vector<SigCacheEntry> entries = MakeEntries(2);
+    const auto &entry = entries[0];
+    BOOST_CHECK(!cache.Get(entry.sigHash, entry.signature, pubKey));
+    cache.Set(entry.sigHash, entry.signature, pubKey);
+    BOOST_CHECK(cache.Get(entry.sigHash, entry.signature, pubKey));
+
+    // any part of the entry differs
+    BOOST_CHECK(!cache.Get(entries[1].sigHash, entry.signature, pubKey));
+    BOOST_CHECK(!cache.Get(entry.sigHash, entries[1].signature, pubKey));
+    BOOST_CHECK(!cache.Get(entry.sigHash, entry.signature, MakePubKey()));
+
+    // set twice, stored once
+    cache.Set(entry.sigHash, entry.signature, pubKey);
+    CSignatureCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.count, 1U);
+    BOOST_CHECK_EQUAL(stats.inserts, 1U);
+    BOOST_CHECK_EQUAL(stats.lookups, 5U);
+    BOOST_CHECK_EQUAL(stats.hits, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(sigcache_hit)
+{
+    CSignatureCache cache;
+    cache.Setup(GetCacheBytes(64));
+
+    // a hit does not erase the entry, the signature of a mempool tx is checked again with its block
+    CPubKey pubKey = MakePubKey();
+    vector<SigCacheEntry> entries = MakeEntries(1);
+    cache.Set(entries[0].sigHash, entries[0].signature, pubKey);
+    BOOST_CHECK(cache.Get(entries[0].sigHash, entries[0].signature, pubKey));
+    BOOST_CHECK(cache.Get(entries[0].sigHash, entries[0].signature, pubKey));
+    BOOST_CHECK_EQUAL(cache.GetStats().hits, 2U);
+    BOOST_CHECK_EQUAL(cache.GetStats().count, 1U);
+}
+
+BOOST_AUTO_TEST_CASE(sigcache_disabled)
+{
+    CSignatureCache cache;
+    cache.Setup(0);
+
+    CPubKey pubKey = MakePubKey();
+    vector<SigCacheEntry> entries = MakeEntries(1);
+    cache.Set(entries[0].sigHash, entries[0].signature, pubKey);
+    BOOST_CHECK(!cache.Get(entries[0].sigHash, entries[0].signature, pubKey));
+    BOOST_CHECK_EQUAL(cache.GetStats().capacity, 0U);
+    BOOST_CHECK_EQUAL(cache.GetStats().inserts, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(sigcache_eviction)
+{
+    // one bucket in each shard, the generation advances on every insert, so a full bucket
+    // evicts the entry set first
+    CSignatureCache cache;
+    cache.Setup(GetCacheBytes(1));
+    uint64_t capacity = SIG_CACHE_SHARDS * SIG_CACHE_BUCKET_SLOTS;
+    BOOST_REQUIRE_EQUAL(cache.GetStats().capacity, capacity);
+
+    CPubKey pubKey = MakePubKey();
+    vector<SigCacheEntry> entries = MakeEntries(1000);
+    for (const auto &entry : entries)
+        cache.Set(entry.sigHash, entry.signature, pubKey);
+
+    CSignatureCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.count, capacity);
+    BOOST_CHECK_EQUAL(stats.inserts, entries.size());
+    BOOST_CHECK_EQUAL(stats.evictions, entries.size() - capacity);
+
+    // the cache is full of the latest entries
+    uint64_t hits = 0;
+    for (const auto &entry : entries)
+        hits += cache.Get(entry.sigHash, entry.signature, pubKey);
+    BOOST_CHECK_EQUAL(hits, capacity);
+    BOOST_CHECK(cache.Get(entries.back().sigHash, entries.back().signature, pubKey));
+    for (size_t i = 0; i < 100; i++)
+        BOOST_CHECK(!cache.Get(entries[i].sigHash, entries[i].signature, pubKey));
+}
+
+BOOST_AUTO_TEST_CASE(sigcache_concurrent)
+{
+    CSignatureCache cache;
+    cache.Setup(GetCacheBytes(4096));
+
+    CPubKey pubKey = MakePubKey();
+    const size_t nThreads = 8;
+    vector<vector<SigCacheEntry>> threadEntries;
+    for (size_t i = 0; i < nThreads; i++)
+        threadEntries.push_back(MakeEntries(2000));
+
+    // every thread sets its entries and reads them and the ones of the others back
+    std::atomic<uint64_t> misses{0};
+    boost::thread_group threadGroup;
+    for (size_t i = 0; i < nThreads; i++) {
+        threadGroup.create_thread([&, i]() {
+            for (const auto &entry : threadEntries[i]) {
+                cache.Set(entry.sigHash, entry.signature, pubKey);
+                if (!cache.Get(entry.sigHash, entry.signature, pubKey))
+                    misses++;
+            }
+            for (const auto &entries : threadEntries) {
+                for (const auto &entry : entries)
+                    cache.Get(entry.sigHash, entry.signature, pubKey);
+            }
+        });
+    }
+    threadGroup.join_all();
+
+    BOOST_CHECK_EQUAL(misses.load(), 0U);
+    CSignatureCacheStats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.inserts, nThreads * 2000);
+    BOOST_CHECK_EQUAL(stats.lookups, nThreads * 2000 + nThreads * nThreads * 2000);
+    BOOST_CHECK_EQUAL(stats.count + stats.evictions, stats.inserts);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
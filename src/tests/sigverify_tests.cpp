@@ -0,0 +1,98 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sigverify.h"
+#include "main.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static vector<CSigCheck> MakeChecks(size_t count) {
+    vector<CSigCheck> checks;
+    for (size_t i = 0; i < count; i++) {
+        CKey key;
+        key.MakeNewKey();
+        uint256 hash = GetRandHash();
+        vector<unsigned char> signature;
+        BOOST_CHECK(key.Sign(hash, signature));
+        checks.emplace_back(hash, signature, key.GetPubKey());
+    }
+    return checks;
+}
+
+BOOST_AUTO_TEST_SUITE(sigverify_tests)
+
+BOOST_AUTO_TEST_CASE(sigverify_batch)
+{
+    ECC_Start();
+    std::unique_ptr<ECCVerifyHandle> handle = std::make_unique<ECCVerifyHandle>();
+
+    boost::thread_group threadGroup;
+    CSigVerifyPool pool;
+    pool.Start(threadGroup, 4);
+
+    vector<CSigCheck> checks = MakeChecks(64);
+    BOOST_CHECK(pool.Verify(checks));
+    BOOST_CHECK(pool.Verify(vector<CSigCheck>()));
+
+    checks[37].sigHash = GetRandHash();
+    BOOST_CHECK(!pool.Verify(checks));
+
+    vector<bool> results;
+    pool.VerifyEach(checks, results);
+    BOOST_CHECK(results.size() == checks.size());
+    for (size_t i = 0; i < results.size(); i++)
+        BOOST_CHECK(results[i] == (i != 37));
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    handle.reset();
+    ECC_Stop();
+}
+
+BOOST_AUTO_TEST_CASE(sigverify_compact)
+{
+    ECC_Start();
+    std::unique_ptr<ECCVerifyHandle> handle = std::make_unique<ECCVerifyHandle>();
+
+    CKey key, otherKey;
+    key.MakeNewKey();
+    otherKey.MakeNewKey();
+    uint256 hash = GetRandHash();
+
+    vector<unsigned char> derSig, compactSig;
+    BOOST_CHECK(key.Sign(hash, derSig));
+    BOOST_CHECK(key.SignCompact(hash, compactSig));
+    BOOST_CHECK(!CPubKey::IsCompactSignature(derSig));
+    BOOST_CHECK(CPubKey::IsCompactSignature(compactSig));
+
+    CPubKey recoveredKey;
+    BOOST_CHECK(RecoverSignature(hash, compactSig, recoveredKey));
+    BOOST_CHECK(recoveredKey == key.GetPubKey());
+    BOOST_CHECK(!RecoverSignature(hash, derSig, recoveredKey));
+
+    BOOST_CHECK(VerifyCompactSignature(hash, compactSig, key.GetPubKey()));
+    BOOST_CHECK(!VerifyCompactSignature(hash, compactSig, otherKey.GetPubKey()));
+    BOOST_CHECK(!VerifyCompactSignature(GetRandHash(), compactSig, key.GetPubKey()));
+    // the DER path never takes a compact signature
+    BOOST_CHECK(!VerifySignature(hash, compactSig, key.GetPubKey()));
+
+    // a check without pubkey recovers the signer
+    boost::thread_group threadGroup;
+    CSigVerifyPool pool;
+    pool.Start(threadGroup, 2);
+    vector<CSigCheck> checks = {CSigCheck(hash, compactSig), CSigCheck(hash, derSig, key.GetPubKey())};
+    BOOST_CHECK(pool.Verify(checks));
+    checks.emplace_back(hash, derSig);
+    BOOST_CHECK(!pool.Verify(checks));
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    handle.reset();
+    ECC_Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,130 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "tests/mempoolsetup.h"
+
+#include <numeric>
+
+using namespace std;
+
+// The txs of the senders, which are known to the mempool view or not
+struct TxMemPoolSetup : public MemPoolSetup {
+    // A sender known to the mempool view, or not
+    CKey NewSender(bool fKnown) { return fKnown ? AddAccount(0) : NewKey(); }
+
+    std::shared_ptr<CBaseTx> AddTx(const CKey &key) { return AddTransferTx(key, NewKeyId(), COIN, 100); }
+
+    static vector<uint256> GetAncestors(const std::shared_ptr<CBaseTx> &spTx) {
+        vector<std::shared_ptr<const CBaseTx> > ancestors;
+        mempool.GetSenderAncestors(spTx->GetHash(), ancestors);
+
+        vector<uint256> txids;
+        for (const auto &spAncestor : ancestors)
+            txids.push_back(spAncestor->GetHash());
+        return txids;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(txmempool_tests, TxMemPoolSetup)
+
+BOOST_AUTO_TEST_CASE(txmempool_ancestors)
+{
+    CKey keyA = NewSender(true);
+    CKey keyB = NewSender(true);
+    auto spA1 = AddTx(keyA);
+    auto spB1 = AddTx(keyB);
+    auto spA2 = AddTx(keyA);
+    auto spA3 = AddTx(keyA);
+
+    LOCK(mempool.cs);
+    BOOST_CHECK_EQUAL(mempool.Size(), 4U);
+    BOOST_CHECK_EQUAL(mempool.arrivalTxs.size(), 4U);
+    BOOST_CHECK_EQUAL(mempool.senderTxs.size(), 2U);
+
+    // the earlier txs of the same sender, in arrival order
+    BOOST_CHECK(GetAncestors(spA3) == vector<uint256>({spA1->GetHash(), spA2->GetHash()}));
+    BOOST_CHECK(GetAncestors(spA2) == vector<uint256>({spA1->GetHash()}));
+    BOOST_CHECK(GetAncestors(spA1).empty());
+    BOOST_CHECK(GetAncestors(spB1).empty());
+
+    // the sequences follow the arrival order
+    BOOST_CHECK(mempool.memPoolTxs.at(spA1->GetHash()).GetSequence() < mempool.memPoolTxs.at(spB1->GetHash()).GetSequence());
+    BOOST_CHECK(mempool.memPoolTxs.at(spB1->GetHash()).GetSequence() < mempool.memPoolTxs.at(spA2->GetHash()).GetSequence());
+    BOOST_CHECK_EQUAL(mempool.GetLastSequence(), mempool.memPoolTxs.at(spA3->GetHash()).GetSequence());
+}
+
+BOOST_AUTO_TEST_CASE(txmempool_unknown_sender)
+{
+    CKey key  = NewSender(false);
+    auto spA1 = AddTx(key);
+    auto spA2 = AddTx(key);
+
+    // the txs are kept, out of the sender chains
+    LOCK(mempool.cs);
+    BOOST_CHECK_EQUAL(mempool.Size(), 2U);
+    BOOST_CHECK(mempool.senderTxs.empty());
+    BOOST_CHECK(mempool.memPoolTxs.at(spA2->GetHash()).GetSenderKeyId().IsNull());
+    BOOST_CHECK(GetAncestors(spA2).empty());
+}
+
+BOOST_AUTO_TEST_CASE(txmempool_remove_mid_chain)
+{
+    CKey key  = NewSender(true);
+    auto spA1 = AddTx(key);
+    auto spA2 = AddTx(key);
+    auto spA3 = AddTx(key);
+    uint64_t sequence2 = mempool.memPoolTxs.at(spA2->GetHash()).GetSequence();
+    // counted since startup, the other cases removed txs before
+    uint64_t nRemoved = mempool.GetStats().types[BCOIN_TRANSFER_TX].removed;
+
+    list<std::shared_ptr<const CBaseTx> > removed;
+    mempool.Remove(spA2.get(), removed);
+    BOOST_REQUIRE_EQUAL(removed.size(), 1U);
+    BOOST_CHECK(removed.front()->GetHash() == spA2->GetHash());
+
+    // the chain of the sender goes on without it
+    LOCK(mempool.cs);
+    BOOST_CHECK(!mempool.Exists(spA2->GetHash()));
+    BOOST_CHECK(!mempool.arrivalTxs.count(sequence2));
+    BOOST_CHECK_EQUAL(mempool.senderTxs.at(key.GetPubKey().GetKeyId()).size(), 2U);
+    BOOST_CHECK(GetAncestors(spA3) == vector<uint256>({spA1->GetHash()}));
+
+    CTxMemPoolStats stats = mempool.GetStats();
+    BOOST_CHECK_EQUAL(stats.types[BCOIN_TRANSFER_TX].count, 2U);
+    BOOST_CHECK_EQUAL(stats.types[BCOIN_TRANSFER_TX].removed, nRemoved + 1);
+
+    // the fee histogram of the fee symbol of the txs only
+    BOOST_REQUIRE_EQUAL(stats.feePerKbHistograms.size(), 1U);
+    const vector<uint64_t> &histogram = stats.feePerKbHistograms[SYMB::WICC];
+    BOOST_CHECK_EQUAL(std::accumulate(histogram.begin(), histogram.end(), (uint64_t)0), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(txmempool_remove_for_block)
+{
+    CKey keyA = NewSender(true);
+    CKey keyB = NewSender(true);
+    auto spA1 = AddTx(keyA);
+    auto spB1 = AddTx(keyB);
+    auto spA2 = AddTx(keyA);
+
+    // the txs of a connected block leave, a tx of the block unknown to the mempool is ignored
+    CKey keyC = NewSender(true);
+    auto spC1 = std::make_shared<CBaseCoinTransferTx>(CUserID(keyC.GetPubKey()), CUserID(keyA.GetPubKey().GetKeyId()),
+                                                      100, COIN, COIN / 10, "");
+    mempool.RemoveForBlock({spA1, spB1, spC1});
+
+    LOCK(mempool.cs);
+    BOOST_CHECK_EQUAL(mempool.Size(), 1U);
+    BOOST_CHECK(mempool.Exists(spA2->GetHash()));
+    BOOST_CHECK_EQUAL(mempool.arrivalTxs.size(), 1U);
+    BOOST_CHECK(!mempool.senderTxs.count(keyB.GetPubKey().GetKeyId()));
+    BOOST_CHECK(GetAncestors(spA2).empty());
+
+    mempool.RemoveForBlock({spA2});
+    BOOST_CHECK_EQUAL(mempool.Size(), 0U);
+    BOOST_CHECK(mempool.arrivalTxs.empty());
+    BOOST_CHECK(mempool.senderTxs.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,295 @@
+// Copyright (c) 2017-2020 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "p2p/txreconciliation.h"
+#include "main.h"
+#include "net.h"
+#include "p2p/chainmessage.h"
+#include "p2p/node.h"
+#include "commons/random.h"
+#include "crypto/hash.h"
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <unordered_set>
+
+using namespace std;
+
+static uint256 MakeTxid(uint32_t n) { return Hash(BEGIN(n), END(n)); }
+
+// The messages queued to a node without a socket, by command
+static vector<pair<string, CDataStream> > PopSentMessages(CNode &node) {
+    vector<pair<string, CDataStream> > messages;
+    LOCK(node.cs_vSend);
+    while (!node.vSendMsg.empty()) {
+        const CSerializeData &data = *node.vSendMsg.Front();
+        CDataStream ss(data.begin(), data.end(), SER_NETWORK, PROTOCOL_VERSION);
+        CMessageHeader header;
+        ss >> header;
+        messages.emplace_back(header.GetCommand(), ss);
+        node.vSendMsg.PopFront();
+    }
+    node.nSendSize = 0;
+    return messages;
+}
+
+static vector<CInv> GetSentInv(const vector<pair<string, CDataStream> > &messages) {
+    vector<CInv> vInv;
+    for (auto message : messages) {
+        if (message.first == NetMsgType::INV) {
+            vector<CInv> v;
+            message.second >> v;
+            vInv.insert(vInv.end(), v.begin(), v.end());
+        }
+    }
+    return vInv;
+}
+
+static bool HasSent(const vector<pair<string, CDataStream> > &messages, const string &command) {
+    return any_of(messages.begin(), messages.end(),
+                  [&command](const pair<string, CDataStream> &message) { return message.first == command; });
+}
+
+BOOST_AUTO_TEST_SUITE(txreconciliation_tests)
+
+BOOST_AUTO_TEST_CASE(txrecon_sketch)
+{
+    std::mt19937 rng(1);
+    vector<uint32_t> onlyA, onlyB;
+    CReconSketch sketchA(CReconSketch::GetCellCount(35)), sketchB(CReconSketch::GetCellCount(35));
+    for (int32_t i = 0; i < 1000; i++) {
+        uint32_t shortId = rng() | 1;
+        sketchA.Add(shortId);
+        sketchB.Add(shortId);
+    }
+    for (int32_t i = 0; i < 20; i++) {
+        onlyA.push_back(rng() | 1);
+        sketchA.Add(onlyA.back());
+    }
+    for (int32_t i = 0; i < 15; i++) {
+        onlyB.push_back(rng() | 1);
+        sketchB.Add(onlyB.back());
+    }
+
+    // what both have cancels out
+    sketchA.Merge(sketchB);
+    vector<uint32_t> shortIds;
+    BOOST_CHECK(sketchA.Decode(shortIds));
+    vector<uint32_t> expected = onlyA;
+    expected.insert(expected.end(), onlyB.begin(), onlyB.end());
+    sort(shortIds.begin(), shortIds.end());
+    sort(expected.begin(), expected.end());
+    BOOST_CHECK(shortIds == expected);
+
+    // too small for the difference
+    CReconSketch small(CReconSketch::GetCellCount(1));
+    for (auto shortId : expected)
+        small.Add(shortId);
+    shortIds.clear();
+    BOOST_CHECK(!small.Decode(shortIds));
+    BOOST_CHECK_EQUAL(small.GetCellCount() % RECON_SKETCH_HASHES, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(txrecon_round)
+{
+    CTxReconState initiator(true, 1111, 2222), responder(false, 2222, 1111);
+    BOOST_CHECK_EQUAL(initiator.GetShortId(MakeTxid(0)), responder.GetShortId(MakeTxid(0)));
+
+    // 500 txs queued on both sides, 30 on the initiator only, 10 on the responder only
+    for (uint32_t n = 0; n < 500; n++) {
+        BOOST_CHECK(initiator.AddTx(MakeTxid(n)));
+        BOOST_CHECK(responder.AddTx(MakeTxid(n)));
+    }
+    for (uint32_t n = 500; n < 530; n++)
+        initiator.AddTx(MakeTxid(n));
+    for (uint32_t n = 530; n < 540; n++)
+        responder.AddTx(MakeTxid(n));
+    // the peer announced it meanwhile
+    responder.RemoveTx(MakeTxid(535));
+
+    BOOST_CHECK(initiator.IsRequestDue(100));
+    CReconRequest request = initiator.MakeRequest(100);
+    BOOST_CHECK(!initiator.IsRequestDue(100 + TXRECON_INTERVAL - 1));
+    BOOST_CHECK_EQUAL(request.nSetSize, 530U);
+
+    CReconSketch sketch;
+    BOOST_CHECK(responder.ProcessRequest(request, 100, sketch));
+    BOOST_CHECK(!responder.ProcessRequest(request, 100, sketch));
+    // relayed during the round, it waits for the next one
+    responder.AddTx(MakeTxid(1000));
+
+    vector<uint256> initiatorTxids, responderTxids;
+    CReconDiff diff;
+    BOOST_CHECK(initiator.ProcessSketch(sketch, initiatorTxids, diff));
+    BOOST_CHECK(diff.fSuccess);
+    BOOST_CHECK_EQUAL(initiatorTxids.size(), 30U);
+    BOOST_CHECK_EQUAL(diff.shortIds.size(), 9U);
+    BOOST_CHECK(responder.ProcessDiff(diff, responderTxids));
+    BOOST_CHECK_EQUAL(responderTxids.size(), 9U);
+    BOOST_CHECK(count(responderTxids.begin(), responderTxids.end(), MakeTxid(530)) == 1);
+    BOOST_CHECK(count(responderTxids.begin(), responderTxids.end(), MakeTxid(535)) == 0);
+
+    BOOST_CHECK_EQUAL(initiator.GetSetSize(), 0U);
+    BOOST_CHECK_EQUAL(responder.GetSetSize(), 1U);
+    BOOST_CHECK(!initiator.ProcessSketch(sketch, initiatorTxids, diff));
+}
+
+BOOST_AUTO_TEST_CASE(txrecon_round_failed)
+{
+    CTxReconState initiator(true, 1111, 2222), responder(false, 2222, 1111);
+    for (uint32_t n = 0; n < 20; n++) {
+        initiator.AddTx(MakeTxid(n));
+        responder.AddTx(MakeTxid(n + 10));
+    }
+
+    // an invalid sketch ends the round, the snapshot goes in invs and the responder is told
+    CReconRequest request = initiator.MakeRequest(100);
+    vector<uint256> txids;
+    CReconDiff diff;
+    BOOST_CHECK(initiator.ProcessSketch(CReconSketch(), txids, diff));
+    BOOST_CHECK(!diff.fSuccess);
+    BOOST_CHECK_EQUAL(txids.size(), 20U);
+    BOOST_CHECK_EQUAL(initiator.nFailures, 1U);
+    BOOST_CHECK(initiator.IsRequestDue(100 + TXRECON_INTERVAL));
+
+    // the responder never gets the diff, neither side waits on it for ever
+    CReconSketch sketch;
+    BOOST_CHECK(responder.ProcessRequest(request, 100, sketch));
+    txids.clear();
+    BOOST_CHECK(!responder.ExpireRound(100 + TXRECON_ROUND_TIMEOUT - 1, txids));
+    BOOST_CHECK(responder.ExpireRound(100 + TXRECON_ROUND_TIMEOUT, txids));
+    BOOST_CHECK_EQUAL(txids.size(), 20U);
+    BOOST_CHECK(!responder.ProcessDiff(diff, txids));
+    BOOST_CHECK(responder.ProcessRequest(request, 200, sketch));
+
+    // nor on a sketch that never comes
+    initiator.AddTx(MakeTxid(100));
+    initiator.MakeRequest(200);
+    BOOST_CHECK(!initiator.IsRequestDue(200 + TXRECON_ROUND_TIMEOUT));
+    txids.clear();
+    BOOST_CHECK(initiator.ExpireRound(200 + TXRECON_ROUND_TIMEOUT, txids));
+    BOOST_CHECK(txids.size() == 1 && txids[0] == MakeTxid(100));
+    BOOST_CHECK(initiator.IsRequestDue(200 + TXRECON_ROUND_TIMEOUT));
+    BOOST_CHECK(!initiator.ExpireRound(300, txids));
+}
+
+BOOST_AUTO_TEST_CASE(txrecon_sketch_bogus)
+{
+    // the largest difference a sketch takes, peeled a cell at a time
+    std::mt19937 rng(2);
+    uint32_t nDiff = MAX_RECON_SKETCH_CELLS / RECON_SKETCH_CELLS_PER_DIFF * 8 / 10;
+    CReconSketch sketch(MAX_RECON_SKETCH_CELLS);
+    set<uint32_t> expected;
+    while (expected.size() < nDiff) {
+        uint32_t shortId = rng() | 1;
+        if (expected.insert(shortId).second)
+            sketch.Add(shortId);
+    }
+    vector<uint32_t> shortIds;
+    BOOST_CHECK(sketch.Decode(shortIds));
+    BOOST_CHECK(set<uint32_t>(shortIds.begin(), shortIds.end()) == expected);
+
+    // every cell holds the same id, each one looks like a single id that is not there
+    CReconSketch single(RECON_SKETCH_HASHES);
+    single.Add(12345);
+    CDataStream ss(SER_NETWORK, 0);
+    ss << single;
+    vector<uint64_t> cells;
+    ss >> cells;
+    CDataStream ssBogus(SER_NETWORK, 0);
+    ssBogus << vector<uint64_t>(MAX_RECON_SKETCH_CELLS, cells[0]);
+    CReconSketch bogus;
+    ssBogus >> bogus;
+    BOOST_CHECK(bogus.IsValid());
+    shortIds.clear();
+    BOOST_CHECK(!bogus.Decode(shortIds));
+    BOOST_CHECK(shortIds.size() <= MAX_RECON_SKETCH_CELLS);
+}
+
+BOOST_AUTO_TEST_CASE(txrecon_messages)
+{
+    RegisterNodeSignals(GetNodeSignals());
+    int64_t nStartTime = GetTime();
+    SetMockTime(nStartTime);
+
+    // outbound peers, the first ones still get the txs flooded
+    vector<unique_ptr<CNode> > nodes;
+    for (uint32_t i = 0; i < TXRECON_FLOOD_OUTBOUND_PEERS + 2; i++) {
+        struct in_addr ip;
+        ip.s_addr = 0x0100000a + (i << 24);
+        nodes.emplace_back(new CNode(INVALID_SOCKET, CAddress(CService(CNetAddr(ip), 8920)), "", i == 0));
+        nodes.back()->nVersion = PROTOCOL_VERSION;
+    }
+    {
+        LOCK(cs_vNodes);
+        for (auto &spNode : nodes)
+            vNodes.push_back(spNode.get());
+    }
+    for (auto &spNode : nodes) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << TXRECON_VERSION << GetRand(std::numeric_limits<uint64_t>::max());
+        ProcessSendReconMessage(spNode.get(), ss);
+        BOOST_CHECK(spNode->pTxRecon);
+    }
+    CNode &responder = *nodes.front();
+    CNode &initiator = *nodes.back();
+    BOOST_CHECK(!responder.pTxRecon->fInitiator && !responder.pTxRecon->fFlood);
+    int32_t nFlooded = count_if(nodes.begin(), nodes.end(), [](const unique_ptr<CNode> &spNode) {
+        return spNode->pTxRecon->fFlood;
+    });
+    BOOST_CHECK_EQUAL(nFlooded, TXRECON_FLOOD_OUTBOUND_PEERS);
+    BOOST_CHECK(initiator.pTxRecon->fInitiator && !initiator.pTxRecon->fFlood);
+
+    // the initiator starts a round, an invalid sketch ends it: the set goes in an inv and the responder is told
+    for (uint32_t n = 0; n < 5; n++)
+        initiator.PushInventory(CInv(MSG_TX, MakeTxid(n)));
+    GetNodeSignals().SendMessages(&initiator, false);
+    auto messages = PopSentMessages(initiator);
+    BOOST_CHECK(HasSent(messages, NetMsgType::REQRECON));
+    BOOST_CHECK(GetSentInv(messages).empty());
+
+    CDataStream ssSketch(SER_NETWORK, PROTOCOL_VERSION);
+    ssSketch << CReconSketch();
+    ProcessSketchMessage(&initiator, ssSketch);
+    messages = PopSentMessages(initiator);
+    BOOST_CHECK(HasSent(messages, NetMsgType::RECONCILDIFF));
+    BOOST_CHECK_EQUAL(GetSentInv(messages).size(), 5U);
+    {
+        LOCK(initiator.cs_inventory);
+        BOOST_CHECK_EQUAL(initiator.pTxRecon->nFailures, 1U);
+    }
+
+    // the responder answers a request, the diff never comes and its set goes in an inv
+    for (uint32_t n = 0; n < 3; n++)
+        responder.PushInventory(CInv(MSG_TX, MakeTxid(n)));
+    GetNodeSignals().SendMessages(&responder, false);
+    BOOST_CHECK(GetSentInv(PopSentMessages(responder)).empty());
+    CDataStream ssRequest(SER_NETWORK, PROTOCOL_VERSION);
+    ssRequest << CReconRequest();
+    ProcessReqReconMessage(&responder, ssRequest);
+    BOOST_CHECK(HasSent(PopSentMessages(responder), NetMsgType::SKETCH));
+
+    SetMockTime(nStartTime + TXRECON_ROUND_TIMEOUT - 1);
+    GetNodeSignals().SendMessages(&responder, false);
+    BOOST_CHECK(GetSentInv(PopSentMessages(responder)).empty());
+    SetMockTime(nStartTime + TXRECON_ROUND_TIMEOUT);
+    GetNodeSignals().SendMessages(&responder, false);
+    BOOST_CHECK_EQUAL(GetSentInv(PopSentMessages(responder)).size(), 3U);
+
+    {
+        LOCK(cs_vNodes);
+        for (auto &spNode : nodes)
+            vNodes.erase(find(vNodes.begin(), vNodes.end(), spNode.get()));
+    }
+    nodes.clear();
+    SetMockTime(0);
+    UnregisterNodeSignals(GetNodeSignals());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
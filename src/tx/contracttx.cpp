@@ -107,7 +107,7 @@ bool CLuaContractDeployTx::ExecuteTx(CTxExecuteContext &context) {
     return true;
 }
 
-uint64_t CLuaContractDeployTx::GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t nFuelRate) {
+uint64_t CLuaContractDeployTx::GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t nFuelRate) const {
     uint64_t minFee = 0;
     if (!GetTxMinFee(cw, nTxType, height, fee_symbol, minFee)) {
         LogPrint(BCLog::ERROR, "get min_fee failed! fee_symbol=%s\n", fee_symbol);
@@ -305,7 +305,7 @@ bool CUniversalContractDeployTx::ExecuteTx(CTxExecuteContext &context) {
     return true;
 }
 
-uint64_t CUniversalContractDeployTx::GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t nFuelRate) {
+uint64_t CUniversalContractDeployTx::GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t nFuelRate) const {
     uint64_t minFee = 0;
     if (!GetTxMinFee(cw, nTxType, height, fee_symbol, minFee)) {
         LogPrint(BCLog::ERROR, "get min_fee failed! fee_symbol=%s\n", fee_symbol);
@@ -40,7 +40,7 @@ public:
     }
 
     virtual std::shared_ptr<CBaseTx> GetNewInstance() const { return std::make_shared<CLuaContractDeployTx>(*this); }
-    virtual uint64_t GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t fuelRate);
+    virtual uint64_t GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t fuelRate) const;
     virtual string ToString(CAccountDBCache &accountView);
     virtual Object ToJson(CCacheWrapper &cw) const;
 
@@ -115,7 +115,7 @@ public:
     }
 
     virtual std::shared_ptr<CBaseTx> GetNewInstance() const { return std::make_shared<CUniversalContractDeployTx>(*this); }
-    virtual uint64_t GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t fuelRate);
+    virtual uint64_t GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t fuelRate) const;
     virtual string ToString(CAccountDBCache &accountView);
     virtual Object ToJson(CCacheWrapper &cw) const;
 
@@ -83,7 +83,7 @@ bool CBaseTx::IsValidHeight(int32_t nCurrHeight, int32_t nTxCacheHeight) const {
     return (valid_height <= nCurrHeight + halfRange) && (valid_height >= nCurrHeight - halfRange);
 }
 
-uint64_t CBaseTx::GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t fuelRate) {
+uint64_t CBaseTx::GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t fuelRate) const {
     return (fuel == 0 || fuelRate == 0) ? 0 : std::ceil(fuel / 100.0f) * fuelRate;
 }
 
@@ -390,7 +390,10 @@ bool CBaseTx::CheckTxAvailableFromVer(CTxExecuteContext &context, FeatureForkVer
 
 bool CBaseTx::VerifySignature(CTxExecuteContext &context, const CPubKey &pubkey) {
     uint256 sighash = GetHash();
-    if (!::VerifySignature(sighash, signature, pubkey))
+    bool valid = (GetFeatureForkVersion(context.height) >= MAJOR_VER_R4 && CPubKey::IsCompactSignature(signature))
+                    ? ::VerifyCompactSignature(sighash, signature, pubkey)
+                    : ::VerifySignature(sighash, signature, pubkey);
+    if (!valid)
         return context.pState->DoS(100, ERRORMSG("%s, tx signature error", BASE_TX_TITLE), REJECT_INVALID, "bad-tx-signature");
 
     return true;
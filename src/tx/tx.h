@@ -173,7 +173,7 @@ public:
 
     virtual uint32_t GetSerializeSize(int32_t nType, int32_t nVersion) const { return 0; }
 
-    virtual uint64_t GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t nFuelRate);
+    virtual uint64_t GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t nFuelRate) const;
     virtual double GetPriority() const {
         return TRANSACTION_PRIORITY_CEILING / GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
     }
@@ -195,22 +195,22 @@ public:
 
     bool IsValidHeight(int32_t nCurHeight, int32_t nTxCacheHeight) const;
 
-    bool IsBlockRewardTx()  { return nTxType == BLOCK_REWARD_TX || nTxType == UCOIN_BLOCK_REWARD_TX; }
-    bool IsPriceMedianTx()  { return nTxType == PRICE_MEDIAN_TX; }
-    bool IsPriceFeedTx()    { return nTxType == PRICE_FEED_TX; }
-    bool IsCoinMintTx()     { return nTxType == UCOIN_MINT_TX; }
-    bool IsRelayForbidden() { return kForbidRelayTxSet.count(nTxType) > 0; }
+    bool IsBlockRewardTx() const  { return nTxType == BLOCK_REWARD_TX || nTxType == UCOIN_BLOCK_REWARD_TX; }
+    bool IsPriceMedianTx() const  { return nTxType == PRICE_MEDIAN_TX; }
+    bool IsPriceFeedTx() const    { return nTxType == PRICE_FEED_TX; }
+    bool IsCoinMintTx() const     { return nTxType == UCOIN_MINT_TX; }
+    bool IsRelayForbidden() const { return kForbidRelayTxSet.count(nTxType) > 0; }
 
     const string& GetTxTypeName() const { return ::GetTxTypeName(nTxType); }
 
 
 public:
-    static unsigned int GetSerializePtrSize(const std::shared_ptr<CBaseTx> &pBaseTx, int nType, int nVersion){
+    static unsigned int GetSerializePtrSize(const std::shared_ptr<const CBaseTx> &pBaseTx, int nType, int nVersion){
         return pBaseTx->GetSerializeSize(nType, nVersion) + 1;
     }
 
     template<typename Stream>
-    static void SerializePtr(Stream& os, const std::shared_ptr<CBaseTx> &pBaseTx, int nType, int nVersion);
+    static void SerializePtr(Stream& os, const std::shared_ptr<const CBaseTx> &pBaseTx, int nType, int nVersion);
 
     template<typename Stream>
     static void UnserializePtr(Stream& is, std::shared_ptr<CBaseTx> &pBaseTx, int nType, int nVersion);
@@ -18,23 +18,25 @@ CTxMemPoolEntry::CTxMemPoolEntry() {
 
     nTime   = 0;
     height = 0;
+
+    nSequence = 0;
 }
 
-CTxMemPoolEntry::CTxMemPoolEntry(CBaseTx *pBaseTx, int64_t time, uint32_t height) : nTime(time), height(height) {
-    pTx       = pBaseTx->GetNewInstance();
+CTxMemPoolEntry::CTxMemPoolEntry(const std::shared_ptr<CBaseTx> &pTxIn, int64_t time, uint32_t height)
+    : pTx(pTxIn), nTime(time), height(height), nSequence(0) {
+    txid      = pTx->GetHash();
     nFees     = pTx->GetFees();
     nTxSize   = ::GetSerializeSize(*pTx, SER_NETWORK, PROTOCOL_VERSION);
     dPriority = pTx->GetPriority();
 }
 
-CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry &other) {
-    this->pTx       = other.pTx->GetNewInstance();
-    this->nFees     = other.nFees;
-    this->nTxSize   = other.nTxSize;
-    this->dPriority = other.dPriority;
+size_t CTxMemPoolEntry::GetFeePerKbBucket() const {
+    uint64_t feePerKb = nTxSize > 0 ? std::get<1>(nFees) * 1000 / nTxSize : 0;
+    size_t bucket     = 0;
+    while (bucket < MEMPOOL_FEE_PER_KB_BUCKET_COUNT - 1 && feePerKb > MEMPOOL_FEE_PER_KB_BUCKETS[bucket])
+        ++bucket;
 
-    this->nTime  = other.nTime;
-    this->height = other.height;
+    return bucket;
 }
 
 CTxMemPool::CTxMemPool() {
@@ -42,15 +44,58 @@ CTxMemPool::CTxMemPool() {
     // accepting transactions becomes O(N^2) where N is the number
     // of transactions in the pool
     fSanityCheck         = false;
+    nSequence            = 0;
+}
+
+void CTxMemPool::AddToIndexes(CTxMemPoolEntry &entry) {
+    entry.nSequence = ++nSequence;
+    arrivalTxs.emplace(entry.nSequence, entry.txid);
+
+    // The tx has been executed in the mempool view, so that its sender account can be found there
+    // even when the tx registers it.
+    CAccount account;
+    if (cw && cw->accountCache.GetAccount(entry.pTx->txUid, account)) {
+        entry.senderKeyId = account.keyid;
+        senderTxs[entry.senderKeyId].emplace(entry.nSequence, entry.txid);
+    }
+
+    CTxMemPoolTypeStats &typeStats = stats.types[entry.pTx->nTxType];
+    typeStats.count++;
+    typeStats.bytes += entry.nTxSize;
+    typeStats.added++;
+    stats.GetFeePerKbHistogram(std::get<0>(entry.nFees))[entry.GetFeePerKbBucket()]++;
 }
 
-void CTxMemPool::Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive) {
+CTxMemPool::TxMap::iterator CTxMemPool::EraseEntry(TxMap::iterator it) {
+    const CTxMemPoolEntry &entry = it->second;
+    arrivalTxs.erase(entry.nSequence);
+
+    CTxMemPoolTypeStats &typeStats = stats.types[entry.pTx->nTxType];
+    typeStats.count--;
+    typeStats.bytes -= entry.nTxSize;
+    typeStats.removed++;
+    stats.GetFeePerKbHistogram(std::get<0>(entry.nFees))[entry.GetFeePerKbBucket()]--;
+
+    if (!entry.senderKeyId.IsNull()) {
+        auto senderIt = senderTxs.find(entry.senderKeyId);
+        if (senderIt != senderTxs.end()) {
+            senderIt->second.erase(entry.nSequence);
+            if (senderIt->second.empty())
+                senderTxs.erase(senderIt);
+        }
+    }
+
+    return memPoolTxs.erase(it);
+}
+
+void CTxMemPool::Remove(CBaseTx *pBaseTx, list<std::shared_ptr<const CBaseTx> > &removed, bool fRecursive) {
     // Remove transaction from memory pool
     LOCK(cs);
     uint256 txid = pBaseTx->GetHash();
-    if (memPoolTxs.count(txid)) {
-        removed.push_front(std::shared_ptr<CBaseTx>(memPoolTxs[txid].GetTransaction()));
-        memPoolTxs.erase(txid);
+    auto it = memPoolTxs.find(txid);
+    if (it != memPoolTxs.end()) {
+        removed.push_front(it->second.GetTransaction());
+        EraseEntry(it);
         EraseTransactionFromWallet(txid);
     }
 }
@@ -59,38 +104,71 @@ void CTxMemPool::Remove(const uint256 &txid) {
     LOCK(cs);
     auto it = memPoolTxs.find(txid);
     if (it != memPoolTxs.end()) {
-        memPoolTxs.erase(it);
+        EraseEntry(it);
         EraseTransactionFromWallet(txid);
     }
 }
 
-bool CTxMemPool::AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state) {
+void CTxMemPool::RemoveForBlock(const vector<std::shared_ptr<CBaseTx> > &vptx) {
+    LOCK(cs);
+    for (const auto &pTx : vptx) {
+        auto it = memPoolTxs.find(pTx->GetHash());
+        if (it != memPoolTxs.end())
+            EraseEntry(it);
+    }
+}
+
+bool CTxMemPool::AddUnchecked(const uint256 &txid, CBaseTx &tx, const CTxMemPoolEntry &entry, CValidationState &state) {
     // Add to memory pool without checking anything.
     // Used by main.cpp AcceptToMemoryPool(), which DOES
     // all the appropriate checks.
     LOCK(cs);
     {
-        if (!CheckTxInMemPool(txid, entry, state, memPoolTxs.size()))
+        if (!CheckTxInMemPool(txid, tx, state, memPoolTxs.size()))
             return false;
 
-        memPoolTxs.insert(make_pair(txid, entry));
+        AddEntry(txid, entry);
     }
     return true;
 }
 
+void CTxMemPool::AddEntry(const uint256 &txid, const CTxMemPoolEntry &entry) {
+    LOCK(cs);
+    auto ret = memPoolTxs.emplace(txid, entry);
+    AddToIndexes(ret.first->second);
+
+    // the block template queues the new tx
+    WakeBlockTemplate();
+}
+
 void CTxMemPool::QueryHash(vector<uint256> &txids) {
     LOCK(cs);
 
     txids.clear();
     txids.reserve(memPoolTxs.size());
-    for (typename map<uint256, CTxMemPoolEntry>::iterator mi = memPoolTxs.begin(); mi != memPoolTxs.end(); ++mi) {
+    for (TxMap::iterator mi = memPoolTxs.begin(); mi != memPoolTxs.end(); ++mi) {
         txids.push_back((*mi).first);
     }
 }
 
-bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &memPoolEntry, CValidationState &state, int32_t index,
+bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, CBaseTx &tx, CValidationState &state, int32_t index,
                                   bool bRehearsalExecute) {
     auto bm = MAKE_BENCHMARK("execute tx in mempool");
+    int64_t startTimeUs = GetTimeMicros();
+    bool ret            = ExecuteTxInMemPool(txid, tx, state, index, bRehearsalExecute);
+
+    LOCK(cs);
+    CTxMemPoolTypeStats &typeStats = stats.types[tx.nTxType];
+    typeStats.checkCount++;
+    typeStats.checkTimeUs += GetTimeMicros() - startTimeUs;
+    if (!ret)
+        typeStats.checkFailed++;
+
+    return ret;
+}
+
+bool CTxMemPool::ExecuteTxInMemPool(const uint256 &txid, CBaseTx &tx, CValidationState &state, int32_t index,
+                                    bool bRehearsalExecute) {
     CBlockIndex *pTip =  chainActive.Tip();
     if (pTip == nullptr)
         throw runtime_error("CheckTxInMemPool:: ChainActive.Tip() is null");
@@ -98,7 +176,6 @@ bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &me
     HeightType newHeight = pTip->height + 1;
     // not within valid height
     static int validHeight = SysCfg().GetTxCacheHeight();
-    auto &tx = *memPoolEntry.GetTransaction();
     if (!tx.IsValidHeight(newHeight, validHeight)) {
         LogPrint(BCLog::INFO, "valid_height(%d) of txid %s is invalid! new_height=%d\n", tx.valid_height, txid.GetHex(), newHeight);
         return state.Invalid(false, REJECT_INVALID, "tx-invalid-height");
@@ -138,26 +215,51 @@ void CTxMemPool::SetMemPoolCache() {
 
 void CTxMemPool::ReScanMemPoolTx() {
     auto bm = MAKE_BENCHMARK("rescan all tx in mempool");
-    cw.reset(new CCacheWrapper(pCdMan));
+    int64_t startTimeUs = GetTimeMicros();
 
-    LOCK(cs);
+    LOCK2(cs_main, cs);
+    cw.reset(new CCacheWrapper(pCdMan));
     CValidationState state;
-    int index = 0;
-    for (map<uint256, CTxMemPoolEntry>::iterator iterTx = memPoolTxs.begin(); iterTx != memPoolTxs.end(); ++index) {
-        if (!CheckTxInMemPool(iterTx->first, iterTx->second, state, index, true)) {
-            uint256 txid = iterTx->first;
-            iterTx       = memPoolTxs.erase(iterTx++);
+    int index        = 0;
+    uint64_t removed = 0;
+    // Re-execute in arrival order, a tx is checked after the earlier txs of the same sender it may depend on
+    for (auto arrivalIt = arrivalTxs.begin(); arrivalIt != arrivalTxs.end(); ++index) {
+        uint256 txid = arrivalIt->second;
+        ++arrivalIt;
+
+        // The tx is executed in place, it rewrites the memory only fields of the tx, which the holders of the
+        // shared tx do not read but under cs_main or cs, the serialized fields are never changed
+        auto iterTx = memPoolTxs.find(txid);
+        if (!CheckTxInMemPool(txid, *iterTx->second.pTx, state, index, true)) {
+            EraseEntry(iterTx);
             EraseTransactionFromWallet(txid);
-            continue;
+            ++removed;
         }
-        ++iterTx;
     }
+
+    int64_t timeUs = GetTimeMicros() - startTimeUs;
+    stats.rescanCount++;
+    stats.lastRescanTimeUs  = timeUs;
+    stats.maxRescanTimeUs   = std::max(stats.maxRescanTimeUs, timeUs);
+    stats.totalRescanTimeUs += timeUs;
+    stats.lastRescanTxCount = index;
+    stats.lastRescanRemoved = removed;
 }
 
 void CTxMemPool::Clear() {
     LOCK(cs);
 
+    for (const auto &item : memPoolTxs) {
+        CTxMemPoolTypeStats &typeStats = stats.types[item.second.pTx->nTxType];
+        typeStats.removed++;
+        typeStats.count = 0;
+        typeStats.bytes = 0;
+    }
+    stats.feePerKbHistograms.clear();
+
     memPoolTxs.clear();
+    arrivalTxs.clear();
+    senderTxs.clear();
     cw.reset(new CCacheWrapper(pCdMan));
 }
 
@@ -171,10 +273,30 @@ bool CTxMemPool::Exists(const uint256 txid) {
     return ((memPoolTxs.count(txid) != 0));
 }
 
-std::shared_ptr<CBaseTx> CTxMemPool::Lookup(const uint256 txid) const {
+std::shared_ptr<const CBaseTx> CTxMemPool::Lookup(const uint256 txid) const {
     LOCK(cs);
-    typename map<uint256, CTxMemPoolEntry>::const_iterator i = memPoolTxs.find(txid);
+    TxMap::const_iterator i = memPoolTxs.find(txid);
     if (i == memPoolTxs.end())
-        return std::shared_ptr<CBaseTx>();
+        return std::shared_ptr<const CBaseTx>();
     return i->second.GetTransaction();
-}
\ No newline at end of file
+}
+
+CTxMemPoolStats CTxMemPool::GetStats() const {
+    LOCK(cs);
+    return stats;
+}
+
+void CTxMemPool::GetSenderAncestors(const uint256 &txid, vector<std::shared_ptr<const CBaseTx> > &ancestors) const {
+    LOCK(cs);
+    auto it = memPoolTxs.find(txid);
+    if (it == memPoolTxs.end() || it->second.senderKeyId.IsNull())
+        return;
+
+    auto senderIt = senderTxs.find(it->second.senderKeyId);
+    if (senderIt == senderTxs.end())
+        return;
+
+    const auto &chain = senderIt->second;
+    for (auto chainIt = chain.begin(); chainIt != chain.end() && chainIt->first < it->second.nSequence; ++chainIt)
+        ancestors.push_back(memPoolTxs.at(chainIt->second).GetTransaction());
+}
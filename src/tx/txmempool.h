@@ -7,6 +7,7 @@
 #ifndef COIN_TXMEMPOOL_H
 #define COIN_TXMEMPOOL_H
 
+#include "config/txbase.h"
 #include "entities/account.h"
 #include "persistence/cachewrapper.h"
 #include "sync.h"
@@ -14,6 +15,8 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 using namespace std;
 
@@ -21,12 +24,52 @@ class CValidationState;
 class CBaseTx;
 class uint256;
 
+/** Upper bounds of the fee per kb histogram buckets (sawi/kb), the last bucket takes the rest */
+static const uint64_t MEMPOOL_FEE_PER_KB_BUCKETS[] = {10000, 100000, 500000, 1000000, 2000000, 5000000, 10000000,
+                                                      100000000};
+static const size_t MEMPOOL_FEE_PER_KB_BUCKET_COUNT =
+    sizeof(MEMPOOL_FEE_PER_KB_BUCKETS) / sizeof(MEMPOOL_FEE_PER_KB_BUCKETS[0]) + 1;
+
+struct CTxMemPoolTypeStats {
+    uint64_t count        = 0;  // txs in the mempool
+    uint64_t bytes        = 0;  // serialized size of the txs in the mempool
+    uint64_t added        = 0;  // txs added since startup
+    uint64_t removed      = 0;  // txs removed since startup
+    uint64_t checkCount   = 0;  // CheckTxInMemPool() calls, including the rescans
+    uint64_t checkFailed  = 0;
+    int64_t checkTimeUs   = 0;  // time spent in CheckTxInMemPool()
+};
+
+/*
+ * Counters kept up to date on the admission and removal paths of the mempool
+ */
+struct CTxMemPoolStats {
+    map<TxType, CTxMemPoolTypeStats> types;
+    // Txs per fee per kb bucket, for each fee symbol, the fees of different symbols can not be compared
+    map<TokenSymbol, vector<uint64_t>> feePerKbHistograms;
+
+    uint64_t rescanCount       = 0;
+    int64_t lastRescanTimeUs   = 0;
+    int64_t maxRescanTimeUs    = 0;
+    int64_t totalRescanTimeUs  = 0;
+    uint64_t lastRescanTxCount = 0;  // txs checked by the last rescan
+    uint64_t lastRescanRemoved = 0;  // txs dropped by the last rescan
+
+    vector<uint64_t> &GetFeePerKbHistogram(const TokenSymbol &feeSymbol) {
+        vector<uint64_t> &histogram = feePerKbHistograms[feeSymbol];
+        if (histogram.empty())
+            histogram.assign(MEMPOOL_FEE_PER_KB_BUCKET_COUNT, 0);
+        return histogram;
+    }
+};
+
 /*
  * CTxMemPool stores these:
  */
 class CTxMemPoolEntry {
 private:
-    std::shared_ptr<CBaseTx> pTx;
+    std::shared_ptr<CBaseTx> pTx;             // Shared as const with the relay, wallet and miner, executed by the mempool only
+    uint256 txid;                             // Cached to avoid rehashing
     std::pair<TokenSymbol, uint64_t> nFees;  // Cached to avoid expensive parent-transaction lookups
     uint32_t nTxSize;                     // Cached to avoid recomputing tx size
     double dPriority;                     // Cached to avoid recomputing priority
@@ -34,12 +77,18 @@ private:
     int64_t nTime;     // Local time when entering the mempool
     uint32_t height;  // Chain height when entering the mempool
 
+    uint64_t nSequence;   // Arrival order in the mempool, set by CTxMemPool
+    CKeyID senderKeyId;   // Sender account of the tx, null if unknown, set by CTxMemPool
+
+    friend class CTxMemPool;
+
 public:
-    CTxMemPoolEntry(CBaseTx *ptx, int64_t time, uint32_t height);
+    CTxMemPoolEntry(const std::shared_ptr<CBaseTx> &pTxIn, int64_t time, uint32_t height);
     CTxMemPoolEntry();
-    CTxMemPoolEntry(const CTxMemPoolEntry &other);
 
-    std::shared_ptr<CBaseTx> GetTransaction() const { return pTx; }
+    std::shared_ptr<const CBaseTx> GetTransaction() const { return pTx; }
+
+    inline const uint256 &GetHash() const { return txid; }
 
     inline std::pair<TokenSymbol, uint64_t> GetFees() const { return nFees; }
     inline uint32_t GetTxSize() const { return nTxSize; }
@@ -47,6 +96,12 @@ public:
 
     inline int64_t GetTime() const { return nTime; }
     inline uint32_t GetHeight() const { return height; }
+
+    inline uint64_t GetSequence() const { return nSequence; }
+    inline const CKeyID &GetSenderKeyId() const { return senderKeyId; }
+
+    // Index of the fee per kb histogram bucket, by the fees declared in the tx, in the unit of its fee symbol
+    size_t GetFeePerKbBucket() const;
 };
 
 /*
@@ -61,20 +116,31 @@ public:
  */
 class CTxMemPool {
 public:
+    typedef unordered_map<uint256, CTxMemPoolEntry, CSaltedUint256Hasher> TxMap;
+
     mutable CCriticalSection cs;
-    map<uint256, CTxMemPoolEntry > memPoolTxs;
+    TxMap memPoolTxs;
+    // All txs in arrival order, which is the order they have been executed in the mempool view
+    map<uint64_t, uint256> arrivalTxs;
+    // Txs of each sender in arrival order, a tx may depend on the earlier txs of the same sender
+    unordered_map<CKeyID, map<uint64_t, uint256>, CSaltedKeyIDHasher> senderTxs;
     std::shared_ptr<CCacheWrapper> cw;
+    CTxMemPoolStats stats;
 
 public:
     CTxMemPool();
 
 public:
     void SetSanityCheck(bool fSanityCheckIn) { fSanityCheck = fSanityCheckIn; }
-    bool AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state);
-    void Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive = false);
+    // Execute the tx of the entry in the mempool view and add it, only the rescans execute it again
+    bool AddUnchecked(const uint256 &txid, CBaseTx &tx, const CTxMemPoolEntry &entry, CValidationState &state);
+    // Add an entry whose tx has been executed in the mempool view
+    void AddEntry(const uint256 &txid, const CTxMemPoolEntry &entry);
+    void Remove(CBaseTx *pBaseTx, list<std::shared_ptr<const CBaseTx> > &removed, bool fRecursive = false);
     void Remove(const uint256 &txid);
+    void RemoveForBlock(const vector<std::shared_ptr<CBaseTx> > &vptx);
     void QueryHash(vector<uint256> &txids);
-    bool CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state, int32_t index,
+    bool CheckTxInMemPool(const uint256 &txid, CBaseTx &tx, CValidationState &state, int32_t index,
                           bool bRehearsalExecute = true);
     void SetMemPoolCache();
     void ReScanMemPoolTx();
@@ -82,10 +148,22 @@ public:
 
     uint64_t Size();
     bool Exists(const uint256 txid);
-    std::shared_ptr<CBaseTx> Lookup(const uint256 txid) const;
+    std::shared_ptr<const CBaseTx> Lookup(const uint256 txid) const;
+    CTxMemPoolStats GetStats() const;
+    // Arrival order of the last tx added, it only grows
+    uint64_t GetLastSequence() const { return nSequence; }
+    // Get the earlier txs of the same sender, in arrival order
+    void GetSenderAncestors(const uint256 &txid, vector<std::shared_ptr<const CBaseTx> > &ancestors) const;
+
+private:
+    bool ExecuteTxInMemPool(const uint256 &txid, CBaseTx &tx, CValidationState &state, int32_t index,
+                            bool bRehearsalExecute);
+    void AddToIndexes(CTxMemPoolEntry &entry);
+    TxMap::iterator EraseEntry(TxMap::iterator it);
 
 private:
     bool fSanityCheck; // Normally false, true if -checkmempool or -regtest
+    uint64_t nSequence;
 };
 
 
@@ -30,7 +30,7 @@
 using namespace std;
 
 template<typename Stream>
-void CBaseTx::SerializePtr(Stream& os, const std::shared_ptr<CBaseTx> &pBaseTx, int serType, int version) {
+void CBaseTx::SerializePtr(Stream& os, const std::shared_ptr<const CBaseTx> &pBaseTx, int serType, int version) {
 
     // if (!pBaseTx) {
     //     throw runtime_error(strprintf("%s(), unsupport null tx type to serialize",
@@ -12,6 +12,7 @@
 #include "miner/miner.h"
 #include "persistence/contractdb.h"
 #include "persistence/txdb.h"
+#include "sigverify.h"
 #include "config/version.h"
 
 #include "wasm/wasm_context.hpp"
@@ -103,6 +104,8 @@ CUniversalTx::get_accounts_from_signatures(CCacheWrapper& database, std::vector
     TxID signature_hash = GetHash();
 
     set<uint64_t> signed_users;
+    vector<CSigCheck> checks;
+    checks.reserve(signatures.size());
 
     auto spPayer = sp_tx_account;
 
@@ -131,15 +134,21 @@ CUniversalTx::get_accounts_from_signatures(CCacheWrapper& database, std::vector
                       "pubkey of account=%s is invalid", wasm::name(s.account).to_string() )
 
 
-        CHAIN_ASSERT( ::VerifySignature(signature_hash, s.signature, spAccount->owner_pubkey),
-                      wasm_chain::unsatisfied_authorization,
-                      "can not verify signature '%s bye public key '%s' and hash '%s' ",
-                      to_hex(s.signature), spAccount->owner_pubkey.ToString(), signature_hash.ToString() )
-
+        checks.emplace_back(signature_hash, s.signature, spAccount->owner_pubkey);
         authorization_accounts.push_back(s.account);
 
     }
 
+    if (!sigVerifyPool.Verify(checks)) {
+        // find the bad one for the error, the valid ones are in the signature cache by now
+        for (const auto &check : checks) {
+            CHAIN_ASSERT( ::VerifySignature(check.sigHash, check.signature, check.pubKey),
+                          wasm_chain::unsatisfied_authorization,
+                          "can not verify signature '%s bye public key '%s' and hash '%s' ",
+                          to_hex(check.signature), check.pubKey.ToString(), check.sigHash.ToString() )
+        }
+    }
+
     //append payer
     authorization_accounts.push_back(spPayer->regid.GetIntValue());
 
@@ -926,7 +926,7 @@ int32_t ExGetTxContractFunc(lua_State *L) {
 
     LogPrint(BCLog::LUAVM, "ExGetTxContractFunc, hash: %s\n", hash.GetHex().c_str());
 
-    std::shared_ptr<CBaseTx> pBaseTx;
+    std::shared_ptr<const CBaseTx> pBaseTx;
     int32_t len = 0;
     if (hash == pVmRunEnv->GetCurTxHash()) {
         const string &curTxArguments = pVmRunEnv->GetTxContract();
@@ -934,11 +934,11 @@ int32_t ExGetTxContractFunc(lua_State *L) {
         len = RetRstToLua(L, curTxArguments, false);
     } else if (GetTransaction(pBaseTx, hash, pVmRunEnv->GetCw()->blockCache, false)) {
         if (pBaseTx->nTxType == LCONTRACT_INVOKE_TX) {
-            CLuaContractInvokeTx *tx = static_cast<CLuaContractInvokeTx *>(pBaseTx.get());
+            const CLuaContractInvokeTx *tx = static_cast<const CLuaContractInvokeTx *>(pBaseTx.get());
             LUA_BurnFuncData(L, FUEL_CALL_GetTxContract, tx->arguments.size(), 32, FUEL_DATA32_GetTxContract, BURN_VER_R2);
             len = RetRstToLua(L, tx->arguments, false);
         } else if (pBaseTx->nTxType == UCONTRACT_INVOKE_TX) {
-            CUniversalContractInvokeTx *tx = static_cast<CUniversalContractInvokeTx *>(pBaseTx.get());
+            const CUniversalContractInvokeTx *tx = static_cast<const CUniversalContractInvokeTx *>(pBaseTx.get());
             LUA_BurnFuncData(L, FUEL_CALL_GetTxContract, tx->arguments.size(), 32, FUEL_DATA32_GetTxContract, BURN_VER_R2);
             len = RetRstToLua(L, tx->arguments, false);
         } else {
@@ -1002,18 +1002,18 @@ int32_t ExGetTxRegIDFunc(lua_State *L) {
     LogPrint(BCLog::LUAVM,"ExGetTxRegIDFunc, hash: %s\n", hash.GetHex().c_str());
 
     LUA_BurnFuncCall(L, FUEL_CALL_GetTxRegID, BURN_VER_R2);
-    std::shared_ptr<CBaseTx> pBaseTx;
+    std::shared_ptr<const CBaseTx> pBaseTx;
     int32_t len = 0;
     if (GetTransaction(pBaseTx, hash, pVmRunEnv->GetCw()->blockCache, false)) {
         if (pBaseTx->nTxType == BCOIN_TRANSFER_TX) {
-            CBaseCoinTransferTx *tx = static_cast<CBaseCoinTransferTx*>(pBaseTx.get());
+            const CBaseCoinTransferTx *tx = static_cast<const CBaseCoinTransferTx *>(pBaseTx.get());
             if (!tx->txUid.is<CRegID>())
                 return RetFalse("ExGetTxRegIDFunc, txUid is not CRegID type");
 
             vector<uint8_t> item = tx->txUid.get<CRegID>().GetRegIdRaw();
             len = RetRstToLua(L, item);
         } else if (pBaseTx->nTxType == LCONTRACT_INVOKE_TX) {
-            CLuaContractInvokeTx *tx = static_cast<CLuaContractInvokeTx*>(pBaseTx.get());
+            const CLuaContractInvokeTx *tx = static_cast<const CLuaContractInvokeTx *>(pBaseTx.get());
             if (!tx->txUid.is<CRegID>())
                 return RetFalse("ExGetTxRegIDFunc, txUid is not CRegID type");
 
@@ -224,8 +224,10 @@ bool CWallet::CommitTx(CBaseTx *pTx, CValidationState &state) {
 
     string wasm_execute_success_return;
 
+    // the only copy of the tx, shared by the mempool, the wallet and the relay
+    std::shared_ptr<CBaseTx> spTx = pTx->GetNewInstance();
     {
-        if (!::AcceptToMemoryPool(mempool, state, pTx, true)) {
+        if (!::AcceptToMemoryPool(mempool, state, spTx, true)) {
             // This must not fail. The transaction has already been signed and recorded.
             LogPrint(BCLog::RPCCMD, "CommitTx() : invalid transaction %s\n", state.GetRejectReason());
             return false;
@@ -235,7 +237,7 @@ bool CWallet::CommitTx(CBaseTx *pTx, CValidationState &state) {
     }
 
     uint256 txid        = pTx->GetHash();
-    unconfirmedTx[txid] = pTx->GetNewInstance();
+    unconfirmedTx[txid] = spTx;
     bool fWriteSuccess  = CWalletDB(strWalletFile).WriteUnconfirmedTx(txid, unconfirmedTx[txid]);
 
     if (!fWriteSuccess) {
@@ -243,7 +245,7 @@ bool CWallet::CommitTx(CBaseTx *pTx, CValidationState &state) {
                             REJECT_INVALID, "save-tx-to-wallet-error");
     }
 
-    ::RelayTransaction(pTx, txid);
+    ::RelayTransaction(spTx, txid);
     return true;
 }
 
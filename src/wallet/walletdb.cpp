@@ -418,7 +418,7 @@ void ThreadRelayTx(CWallet* pWallet) {
         }
         for (auto item : relayTxMap) {
             if (mempool.Exists(item.first)) {
-                RelayTransaction(item.second.get(), item.first);
+                RelayTransaction(item.second, item.first);
                 LogPrint(BCLog::NET, "ThreadRelayTx resend tx hash:%s time:%ld\n", item.first.GetHex(), GetTime());
             }
         }